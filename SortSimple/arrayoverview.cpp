@@ -0,0 +1,167 @@
+#include "arrayoverview.h"
+#include <QMouseEvent>
+#include <QPainter>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kMinVisible = 16;  // Deepest zoom, in elements
+
+QColor tagColor(TraceTag tag)
+{
+    switch (tag)
+    {
+    case TagPivot:
+        return QColor("orange");
+    case TagBucket:
+        return QColor("teal");
+    case TagRun:
+        return QColor("olive");
+    case TagBlock:
+        return QColor("cyan");
+    case TagEqual:
+        return QColor("pink");
+    case TagHeap:
+        return QColor("slateblue");
+    default:
+        return QColor("purple");
+    }
+}
+
+} // namespace
+
+ArrayOverview::ArrayOverview(QWidget *parent) : QWidget(parent)
+{
+    setMinimumHeight(200);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void ArrayOverview::setTree(const ColumnTree *newTree)
+{
+    tree = newTree;
+    clearMark();
+    if (tree && tree->size() > 0)
+    {
+        ColumnSummary all = tree->query(0, tree->size());
+        lowest = all.minValue;
+        highest = all.maxValue;
+    }
+    setView(0, tree ? double(tree->size()) : 0);
+}
+
+void ArrayOverview::setRecent(std::uint32_t stamp)
+{
+    recent = stamp;
+    update();
+}
+
+void ArrayOverview::setMark(TraceTag tag, std::size_t first, std::size_t last)
+{
+    markTag = tag;
+    markFirst = first;
+    markLast = last;
+}
+
+void ArrayOverview::clearMark()
+{
+    markFirst = 1;
+    markLast = 0;
+}
+
+void ArrayOverview::setView(double first, double visible)
+{
+    double n = tree ? double(tree->size()) : 0;
+    viewSize = std::clamp(visible, std::min(n, kMinVisible), n);
+    viewFirst = std::clamp(first, 0.0, n - viewSize);
+    update();
+}
+
+void ArrayOverview::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#16213e"));
+    if (!tree || tree->size() == 0 || width() <= 0)
+    {
+        return;
+    }
+
+    // Only the visible range is summarized: one tree query per column
+    std::size_t first = static_cast<std::size_t>(viewFirst);
+    std::size_t last = std::min(tree->size(), first + static_cast<std::size_t>(std::ceil(viewSize)));
+    std::size_t width = static_cast<std::size_t>(this->width());
+    columns.resize(width);
+    tree->columns(first, last, width, columns.data());
+
+    if (markFirst <= markLast && markLast >= first && markFirst < last)
+    {
+        double perPixel = double(last - first) / width;
+        double left = (std::max(markFirst, first) - first) / perPixel;
+        double right = (std::min(markLast + 1, last) - first) / perPixel;
+        QColor shade = tagColor(markTag);
+        shade.setAlpha(70);
+        painter.fillRect(QRectF(left, 0, std::max(1.0, right - left), height()), shade);
+    }
+
+    double span = std::max(1.0, double(highest) - double(lowest));
+    auto yOf = [&](int value) { return height() - 1 - (double(value) - lowest) / span * (height() - 1); };
+    QPen idle(QColor("#3a86ff"));
+    QPen touched(QColor("red"));
+    QPen sorted(QColor("#2a9d8f"));
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        const ColumnSummary &c = columns[x];
+        painter.setPen(c.touched >= recent ? touched : c.sorted ? sorted : idle);
+        painter.drawLine(QPointF(x + 0.5, yOf(c.maxValue)), QPointF(x + 0.5, yOf(c.minValue)));
+    }
+
+    painter.setPen(QColor(255, 255, 255, 200));
+    painter.drawText(rect().adjusted(8, 4, -8, -4), Qt::AlignTop | Qt::AlignLeft,
+                     QString("elements %1 to %2 of %3, %4 per column")
+                         .arg(first)
+                         .arg(last - 1)
+                         .arg(tree->size())
+                         .arg(double(last - first) / width, 0, 'f', 1));
+}
+
+void ArrayOverview::wheelEvent(QWheelEvent *event)
+{
+    if (!tree || width() <= 0)
+    {
+        return;
+    }
+    // Keep the element under the cursor where it is
+    double fraction = event->position().x() / width();
+    double anchor = viewFirst + fraction * viewSize;
+    double visible = viewSize * std::pow(0.8, event->angleDelta().y() / 120.0);
+    visible = std::max(visible, std::min(double(tree->size()), kMinVisible));
+    setView(anchor - fraction * visible, visible);
+    event->accept();
+}
+
+void ArrayOverview::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::RightButton && editRequested && tree && tree->size() > 0 && width() > 0)
+    {
+        double at = viewFirst + event->position().x() / width() * viewSize;
+        editRequested(std::min(tree->size() - 1, static_cast<std::size_t>(std::max(0.0, at))),
+                      event->modifiers() & Qt::ShiftModifier);
+        return;
+    }
+    dragX = event->pos().x();
+    dragFirst = viewFirst;
+}
+
+void ArrayOverview::mouseMoveEvent(QMouseEvent *event)
+{
+    if ((event->buttons() & Qt::LeftButton) && width() > 0)
+    {
+        setView(dragFirst - double(event->pos().x() - dragX) / width() * viewSize, viewSize);
+    }
+}
+
+void ArrayOverview::mouseDoubleClickEvent(QMouseEvent *)
+{
+    setView(0, tree ? double(tree->size()) : 0);
+}
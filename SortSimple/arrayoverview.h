@@ -0,0 +1,52 @@
+#ifndef ARRAYOVERVIEW_H
+#define ARRAYOVERVIEW_H
+
+#include "columntree.h"
+#include <QWidget>
+#include <functional>
+
+// Draws an array too long for one bar per element: each pixel column is a
+// line from the smallest to the largest value it covers, red if anything in
+// it was touched in the latest frame and green if what it covers is already
+// in order. Columns come from a ColumnTree, so a
+// frame costs O(width log n) at any zoom. The wheel zooms around the cursor,
+// dragging pans, and a double click shows the whole array again. A right
+// click asks for an edit of the element under the cursor through
+// editRequested, with `many` set if Shift was held.
+class ArrayOverview : public QWidget
+{
+public:
+    explicit ArrayOverview(QWidget *parent = nullptr);
+
+    void setTree(const ColumnTree *tree);   // Also resets the zoom
+    void setRecent(std::uint32_t stamp);     // Columns touched at `stamp` or later are highlighted
+    void setMark(TraceTag tag, std::size_t first, std::size_t last);  // Shaded range, inclusive
+    void clearMark();
+
+    std::function<void(std::size_t index, bool many)> editRequested;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    void setView(double first, double visible);
+
+    const ColumnTree *tree = nullptr;
+    int lowest = 0;       // Value range mapped to the height
+    int highest = 0;
+    double viewFirst = 0; // First element shown, and how many
+    double viewSize = 0;
+    std::uint32_t recent = 1;
+    TraceTag markTag = TagRange;
+    std::size_t markFirst = 1;
+    std::size_t markLast = 0;
+    int dragX = 0;
+    double dragFirst = 0;
+    std::vector<ColumnSummary> columns;
+};
+
+#endif // ARRAYOVERVIEW_H
@@ -0,0 +1,235 @@
+#include "batchsort.h"
+#include "cpufeatures.h"
+#include "sortnetwork.h"
+#include <algorithm>
+#include <vector>
+
+#if SORT_HAVE_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Pair
+{
+    std::uint8_t i;
+    std::uint8_t j;
+};
+
+// Portable version: block[row * lanes + lane], one lane at a time
+void sortGroupsScalar(int *values, std::size_t count, std::size_t length, const Pair *network, std::size_t size,
+                      std::size_t lanes)
+{
+    std::vector<int> block(length * lanes);
+    for (std::size_t first = 0; first < count; first += lanes)
+    {
+        std::size_t used = std::min(lanes, count - first);
+        int *group = values + first * length;
+        for (std::size_t lane = 0; lane < used; ++lane)
+        {
+            for (std::size_t row = 0; row < length; ++row)
+            {
+                block[row * lanes + lane] = group[lane * length + row];
+            }
+        }
+        for (std::size_t c = 0; c < size; ++c)
+        {
+            int *x = &block[network[c].i * lanes];
+            int *y = &block[network[c].j * lanes];
+            for (std::size_t l = 0; l < used; ++l)
+            {
+                int a = x[l];
+                int b = y[l];
+                x[l] = a < b ? a : b;
+                y[l] = a < b ? b : a;
+            }
+        }
+        for (std::size_t lane = 0; lane < used; ++lane)
+        {
+            for (std::size_t row = 0; row < length; ++row)
+            {
+                group[lane * length + row] = block[row * lanes + lane];
+            }
+        }
+    }
+}
+
+#if SORT_HAVE_X86
+
+// Transposes an 8x8 tile of ints held as 8 rows; applying it twice is a no-op
+SORT_TARGET_AVX2 inline void transpose8x8(__m256i *r)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// Vectors registers per row: 1 for 8 lanes, 2 for 16. block[row * Vectors + v]
+// holds lanes 8v..8v+7 of a row. Lengths that are a multiple of 8 move
+// between layouts with 8x8 register transposes; the rest go element-wise.
+template <std::size_t Vectors>
+SORT_TARGET_AVX2 void sortGroupsAvx2(int *values, std::size_t count, std::size_t length, const Pair *network,
+                                     std::size_t size)
+{
+    constexpr std::size_t lanes = Vectors * 8;
+    __m256i block[kMaxBatchLength * Vectors];
+    alignas(32) int rows[kMaxBatchLength * lanes] = {};  // Element-wise staging for untiled lengths
+    const bool tiled = length % 8 == 0;
+    for (std::size_t first = 0; first < count; first += lanes)
+    {
+        std::size_t used = std::min(lanes, count - first);
+        int *group = values + first * length;
+
+        if (tiled)
+        {
+            for (std::size_t v = 0; v < Vectors; ++v)
+            {
+                for (std::size_t row = 0; row < length; row += 8)
+                {
+                    __m256i tile[8];
+                    for (std::size_t l = 0; l < 8; ++l)
+                    {
+                        std::size_t lane = v * 8 + l;
+                        tile[l] = lane < used
+                                      ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(group + lane * length + row))
+                                      : _mm256_setzero_si256();
+                    }
+                    transpose8x8(tile);
+                    for (std::size_t k = 0; k < 8; ++k)
+                    {
+                        block[(row + k) * Vectors + v] = tile[k];
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (std::size_t lane = 0; lane < used; ++lane)
+            {
+                for (std::size_t row = 0; row < length; ++row)
+                {
+                    rows[row * lanes + lane] = group[lane * length + row];
+                }
+            }
+            for (std::size_t k = 0; k < length * Vectors; ++k)
+            {
+                block[k] = _mm256_load_si256(reinterpret_cast<const __m256i *>(rows) + k);
+            }
+        }
+
+        for (std::size_t c = 0; c < size; ++c)
+        {
+            __m256i *x = block + network[c].i * Vectors;
+            __m256i *y = block + network[c].j * Vectors;
+            for (std::size_t v = 0; v < Vectors; ++v)
+            {
+                __m256i a = x[v];
+                __m256i b = y[v];
+                x[v] = _mm256_min_epi32(a, b);
+                y[v] = _mm256_max_epi32(a, b);
+            }
+        }
+
+        if (tiled)
+        {
+            for (std::size_t v = 0; v < Vectors; ++v)
+            {
+                for (std::size_t row = 0; row < length; row += 8)
+                {
+                    __m256i tile[8];
+                    for (std::size_t k = 0; k < 8; ++k)
+                    {
+                        tile[k] = block[(row + k) * Vectors + v];
+                    }
+                    transpose8x8(tile);
+                    for (std::size_t l = 0; l < 8 && v * 8 + l < used; ++l)
+                    {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(group + (v * 8 + l) * length + row), tile[l]);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (std::size_t k = 0; k < length * Vectors; ++k)
+            {
+                _mm256_store_si256(reinterpret_cast<__m256i *>(rows) + k, block[k]);
+            }
+            for (std::size_t lane = 0; lane < used; ++lane)
+            {
+                for (std::size_t row = 0; row < length; ++row)
+                {
+                    group[lane * length + row] = rows[row * lanes + lane];
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+void sortBatch(int *values, std::size_t count, std::size_t length, std::size_t lanes)
+{
+    if (length < 2 || count == 0)
+    {
+        return;
+    }
+    if (length > kMaxBatchLength)
+    {
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            std::sort(values + k * length, values + (k + 1) * length);
+        }
+        return;
+    }
+
+    std::vector<Pair> network;
+    visitBatcherNetwork(length, [&network](std::size_t i, std::size_t j, std::size_t) {
+        network.push_back({static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(j)});
+    });
+
+    lanes = lanes > 8 ? 16 : 8;
+#if SORT_HAVE_X86
+    if (cpuHasAvx2())
+    {
+        if (lanes == 16)
+        {
+            sortGroupsAvx2<2>(values, count, length, network.data(), network.size());
+        }
+        else
+        {
+            sortGroupsAvx2<1>(values, count, length, network.data(), network.size());
+        }
+        return;
+    }
+#endif
+    sortGroupsScalar(values, count, length, network.data(), network.size(), lanes);
+}
+
+const char *batchSortIsa()
+{
+    return cpuHasAvx2() ? "AVX2" : "portable";
+}
@@ -0,0 +1,19 @@
+#ifndef BATCHSORT_H
+#define BATCHSORT_H
+
+#include <cstddef>
+
+constexpr std::size_t kMaxBatchLength = 64;
+
+// Sorts `count` independent arrays of `length` ints stored back to back
+// (array k is values[k * length, (k + 1) * length)). Groups of `lanes`
+// arrays (8 or 16) are transposed into a block with one row per position,
+// so every comparator of the length's sorting network becomes a vector
+// min/max across the whole group. Lengths above kMaxBatchLength fall back
+// to sorting each array on its own.
+void sortBatch(int *values, std::size_t count, std::size_t length, std::size_t lanes = 16);
+
+// Instruction set the block kernel runs with on this machine, for reports
+const char *batchSortIsa();
+
+#endif // BATCHSORT_H
@@ -0,0 +1,1650 @@
+// Console benchmark for the sorting kernels. Run with no arguments for every
+// section, or name the sections to run, e.g. `SortSimpleBench strings`.
+#include "batchsort.h"
+#include "bitonicmerge.h"
+#include "cachesim.h"
+#include "classicsorts.h"
+#include "clustersort.h"
+#include "collation.h"
+#include "columntree.h"
+#include "countingsort.h"
+#include "cpufeatures.h"
+#include "csvsort.h"
+#include "editsort.h"
+#include "heapsort.h"
+#include "inputloader.h"
+#include "inputprofile.h"
+#include "mergesort.h"
+#include "perfcounters.h"
+#include "quicksort.h"
+#include "radixsort.h"
+#include "sortedness.h"
+#include "sortnetwork.h"
+#include "streamsort.h"
+#include "stringsort.h"
+#include "topk.h"
+#include "tracecache.h"
+#include "tuning.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+// Counts heap allocations so kernels that promise not to allocate can be checked.
+// The deletes stay out of line so GCC does not pair the inlined free() with
+// the replaced operator new and warn about a mismatch.
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+static std::atomic<std::size_t> allocationCount{0};
+
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+BENCH_NOINLINE void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+BENCH_NOINLINE void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Best of `repeats` runs in milliseconds; `setup` restores the input and is not timed
+double timeBest(int repeats, const std::function<void()> &setup, const std::function<void()> &run)
+{
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r)
+    {
+        setup();
+        auto start = Clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+void printRow(const char *name, std::size_t n, double ms)
+{
+    std::printf("  %-28s %10.2f ms  %8.1f M/s\n", name, ms, n / ms / 1e3);
+}
+
+// One untimed setup, then `run` between start() and stop() of the counters
+PerfSample measure(PerfCounters &counters, const std::function<void()> &setup, const std::function<void()> &run)
+{
+    setup();
+    counters.start();
+    run();
+    counters.stop();
+    return counters.sample();
+}
+
+void printPerfHeader(const PerfCounters &counters)
+{
+    if (!counters.errorString().empty())
+    {
+        std::printf("  (%s%s)\n", counters.errorString().c_str(),
+                    counters.available() ? "; missing counters show as -" : "; time only");
+    }
+    std::printf("  %-28s %10s %8s %7s %7s %5s", "", "ms", "M/s", "cyc/el", "ins/el", "IPC");
+    for (int e = PerfBranchMisses; e < PerfEventCount; ++e)
+    {
+        std::printf(" %13s", perfEventName(PerfEvent(e)));
+    }
+    std::printf("\n");
+}
+
+// Counters are shown per element so rows of different sizes compare
+void printPerfRow(const char *name, std::size_t n, const PerfSample &s)
+{
+    std::printf("  %-28s %10.2f %8.1f", name, s.milliseconds, n / s.milliseconds / 1e3);
+    auto cell = [&](PerfEvent e, int width) {
+        if (s.has(e))
+        {
+            std::printf(" %*.3f", width, s.perElement(e, n));
+        }
+        else
+        {
+            std::printf(" %*s", width, "-");
+        }
+    };
+    cell(PerfCycles, 7);
+    cell(PerfInstructions, 7);
+    if (s.ipc() > 0)
+    {
+        std::printf(" %5.2f", s.ipc());
+    }
+    else
+    {
+        std::printf(" %5s", "-");
+    }
+    for (int e = PerfBranchMisses; e < PerfEventCount; ++e)
+    {
+        cell(PerfEvent(e), 13);
+    }
+    std::printf("\n");
+}
+
+// Identifiers and slash-separated paths with long shared prefixes, which is
+// what our real data looks like and what defeats a plain byte-wise compare
+std::vector<std::string> makeKeys(std::size_t n, std::mt19937 &rng)
+{
+    static const char *dirs[] = {"src", "include", "lib", "tests", "docs", "tools"};
+    static const char *words[] = {"user", "account", "session", "index", "buffer", "render",
+                                  "widget", "config", "cache", "stream", "parser", "model"};
+    std::uniform_int_distribution<int> dir(0, 5), word(0, 11), num(0, 99999), kind(0, 1);
+
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        std::string s;
+        if (kind(rng))
+        {
+            s = std::string(dirs[dir(rng)]) + "/" + words[word(rng)] + "/" + words[word(rng)] +
+                "_" + std::to_string(num(rng)) + ".cpp";
+        }
+        else
+        {
+            s = std::string(words[word(rng)]) + words[word(rng)] + "Handler" + std::to_string(num(rng));
+        }
+        keys.push_back(std::move(s));
+    }
+    return keys;
+}
+
+void benchStrings(std::size_t n)
+{
+    std::printf("strings: %zu identifiers and paths\n", n);
+    std::mt19937 rng(42);
+    std::vector<std::string> keys = makeKeys(n, rng);
+
+    std::vector<std::string> work;
+    double ms = timeBest(3, [&] { work = keys; }, [&] { std::sort(work.begin(), work.end()); });
+    printRow("std::sort<std::string>", n, ms);
+
+    StringArena arena;
+    std::size_t bytes = 0;
+    for (const std::string &s : keys)
+    {
+        bytes += s.size();
+    }
+    arena.reserve(keys.size(), bytes);
+    for (const std::string &s : keys)
+    {
+        arena.add(s);
+    }
+    const std::vector<StringRef> initial = makeStringRefs(arena);
+    std::vector<StringRef> refs;
+
+    auto check = [&](const char *name) {
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            if (arena.view(arena.idOf(refs[k])) != work[k])
+            {
+                std::printf("  %s: MISMATCH at %zu\n", name, k);
+                return;
+            }
+        }
+    };
+
+    ms = timeBest(3, [&] { refs = initial; }, [&] { multikeyQuicksort(arena, refs); });
+    printRow("multikey quicksort (arena)", n, ms);
+    check("multikey quicksort");
+
+    ms = timeBest(3, [&] { refs = initial; }, [&] { msdRadixSort(arena, refs); });
+    printRow("MSD radix sort (arena)", n, ms);
+    check("MSD radix sort");
+}
+
+std::vector<int> randomInts(std::size_t n, std::uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<int> values(n);
+    for (int &v : values)
+    {
+        v = static_cast<int>(rng());
+    }
+    return values;
+}
+
+// Sorted data with 1% of the elements moved to random places
+std::vector<int> nearlySortedInts(std::size_t n, std::uint32_t seed)
+{
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    std::mt19937 rng(seed);
+    for (std::size_t k = 0; k < n / 100; ++k)
+    {
+        std::swap(values[rng() % n], values[rng() % n]);
+    }
+    return values;
+}
+
+void benchMerge(std::size_t n)
+{
+    std::printf("merge: %zu ints\n", n);
+    const std::pair<const char *, std::vector<int>> inputs[] = {
+        {"random", randomInts(n, 1)},
+        {"nearly sorted", nearlySortedInts(n, 2)},
+    };
+    MergeWorkspace workspace;
+    workspace.reserve(n);
+    std::vector<int> work;
+    work.reserve(n);
+
+    for (const auto &input : inputs)
+    {
+        std::printf(" %s\n", input.first);
+        auto setup = [&] { work.assign(input.second.begin(), input.second.end()); };
+
+        double ms = timeBest(3, setup, [&] { std::stable_sort(work.begin(), work.end()); });
+        printRow("std::stable_sort", n, ms);
+
+        std::size_t allocations = 0;
+        ms = timeBest(3, setup, [&] {
+            std::size_t before = allocationCount;
+            bottomUpMergeSort(work.data(), work.size(), workspace);
+            allocations = allocationCount - before;
+        });
+        printRow("bottomUpMergeSort", n, ms);
+        std::printf("  %-28s %10zu\n", "  heap allocations per sort", allocations);
+        if (!std::is_sorted(work.begin(), work.end()))
+        {
+            std::printf("  bottomUpMergeSort: NOT SORTED\n");
+        }
+    }
+}
+
+// Every kernel on inputs of different shapes, with the automatic choice marked
+void benchAuto(std::size_t n)
+{
+    std::printf("auto: %zu ints per input, * marks the automatic choice\n", n);
+    std::vector<int> fewValues = randomInts(n, 3);
+    for (int &v : fewValues)
+    {
+        v = static_cast<int>(static_cast<unsigned>(v) % 1000);
+    }
+    const std::pair<const char *, std::vector<int>> inputs[] = {
+        {"random", randomInts(n, 1)},
+        {"nearly sorted", nearlySortedInts(n, 2)},
+        {"values 0..999", fewValues},
+    };
+    const SortKernel kernels[] = {SortKernel::BottomUpMerge, SortKernel::LsdRadix, SortKernel::CountingSort,
+                                  SortKernel::StdSort};
+
+    std::vector<int> work;
+    for (const auto &input : inputs)
+    {
+        auto start = Clock::now();
+        KernelChoice choice = recommendKernel(profileInput(input.second.data(), n));
+        double profileMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::printf(" %s (profiled in %.2f ms)\n", input.first, profileMs);
+        for (SortKernel kernel : kernels)
+        {
+            double ms = timeBest(3, [&] { work = input.second; }, [&] { runKernel(kernel, work.data(), n); });
+            std::string label = std::string(kernel == choice.kernel ? "* " : "  ") + kernelName(kernel);
+            printRow(label.c_str(), n, ms);
+        }
+    }
+}
+
+// Integer text parsing against a plain byte scan of the same buffer, which is
+// the bandwidth the parser should approach
+void benchLoad(std::size_t n)
+{
+    std::printf("load: %zu newline-separated integers\n", n);
+    std::mt19937 rng(7);
+    std::string text;
+    text.reserve(n * 12);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        text += std::to_string(static_cast<std::int32_t>(rng()));
+        text += '\n';
+    }
+    auto printBytes = [&](const char *name, double ms) {
+        std::printf("  %-28s %10.2f ms  %8.0f MB/s\n", name, ms, text.size() / ms / 1e3);
+    };
+
+    volatile std::size_t sink = 0;
+    double ms = timeBest(3, [] {}, [&] {
+        sink = static_cast<std::size_t>(std::accumulate(text.begin(), text.end(), 0));
+    });
+    printBytes("byte scan (bandwidth)", ms);
+
+    std::vector<std::int32_t> values;
+    ms = timeBest(3, [] {}, [&] {
+        values.clear();
+        const char *p = text.data();
+        char *next = nullptr;
+        for (long v = std::strtol(p, &next, 10); next != p; v = std::strtol(p, &next, 10))
+        {
+            values.push_back(static_cast<std::int32_t>(v));
+            p = next;
+        }
+    });
+    printBytes("strtol loop", ms);
+
+    ms = timeBest(3, [] {}, [&] { parseTextIntegers(text.data(), text.size(), values, nullptr, 1); });
+    printBytes("parseTextIntegers, 1 thread", ms);
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    ms = timeBest(3, [] {}, [&] { parseTextIntegers(text.data(), text.size(), values); });
+    std::string label = "parseTextIntegers, " + std::to_string(threads) + " threads";
+    printBytes(label.c_str(), ms);
+}
+
+// Traces each kernel into the cache simulator without storing the trace, and
+// reports how fast the simulator consumes events alongside the miss rates
+void benchCache(std::size_t quadraticN, std::size_t n)
+{
+    std::printf("cache: desktop hierarchy, %zu ints for quadratic kernels, %zu for the rest\n", quadraticN, n);
+    using Kernel = std::function<void(int *, std::size_t, StreamingTrace &)>;
+    MergeWorkspace workspace;
+    std::vector<int> aux;
+    const std::pair<const char *, Kernel> kernels[] = {
+        {"Bubble Sort", [](int *a, std::size_t m, StreamingTrace &t) { bubbleSort(a, m, t); }},
+        {"Selection Sort", [](int *a, std::size_t m, StreamingTrace &t) { selectionSort(a, m, t); }},
+        {"Insertion Sort", [](int *a, std::size_t m, StreamingTrace &t) { insertionSort(a, m, t); }},
+        {"Quick Sort (Lomuto)", [](int *a, std::size_t m, StreamingTrace &t) { lomutoQuicksort(a, m, t); }},
+        {"Bottom-Up Merge Sort", [&](int *a, std::size_t m, StreamingTrace &t) {
+             bottomUpMergeSort(a, m, workspace, t);
+         }},
+        {"LSD Radix Sort", [&](int *a, std::size_t m, StreamingTrace &t) {
+             aux.resize(m);
+             lsdRadixSort(a, m, aux.data(), t);
+         }},
+    };
+
+    std::printf("  %-22s %10s %9s", "kernel", "events", "M ev/s");
+    for (const CacheLevelConfig &level : CacheConfig::desktop().levels)
+    {
+        std::printf(" %7s", (level.name + " miss").c_str());
+    }
+    std::printf("\n");
+    for (std::size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+    {
+        std::size_t size = k < 3 ? quadraticN : n;
+        std::vector<int> work = randomInts(size, 11);
+        CacheSimulator simulator(CacheConfig::desktop(), size, sizeof(int));
+        auto start = Clock::now();
+        {
+            StreamingTrace trace(simulator);
+            kernels[k].second(work.data(), size, trace);
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::printf("  %-22s %10llu %9.1f", kernels[k].first,
+                    static_cast<unsigned long long>(simulator.eventCount()), simulator.eventCount() / ms / 1e3);
+        for (const CacheLevelStats &level : simulator.stats())
+        {
+            std::printf(" %6.2f%%", level.missRate() * 100.0);
+        }
+        std::printf("\n");
+    }
+}
+
+// Hardware counters per element around each kernel, on random and sorted input
+void benchPerf(std::size_t n)
+{
+    std::printf("perf: %zu ints, counters per element\n", n);
+    PerfCounters counters;
+    printPerfHeader(counters);
+    std::vector<int> sorted(n);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    const std::pair<const char *, std::vector<int>> inputs[] = {
+        {"random", randomInts(n, 1)},
+        {"sorted", sorted},
+    };
+    const SortKernel kernels[] = {SortKernel::BottomUpMerge, SortKernel::LsdRadix, SortKernel::CountingSort,
+                                  SortKernel::StdSort};
+
+    std::vector<int> work;
+    for (const auto &input : inputs)
+    {
+        std::printf(" %s\n", input.first);
+        for (SortKernel kernel : kernels)
+        {
+            PerfSample s = measure(counters, [&] { work = input.second; }, [&] { runKernel(kernel, work.data(), n); });
+            printPerfRow(kernelName(kernel), n, s);
+        }
+    }
+}
+
+// Branchy against branchless partitioning. Random input makes every Hoare
+// comparison a coin flip for the predictor; sorted input is predictable, so
+// the block scheme has less to win there.
+void benchPartition(std::size_t n)
+{
+    std::printf("partition: %zu ints, counters per element\n", n);
+    PerfCounters counters;
+    printPerfHeader(counters);
+    std::vector<int> sorted(n);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    const std::pair<const char *, std::vector<int>> inputs[] = {
+        {"random", randomInts(n, 1)},
+        {"sorted", sorted},
+    };
+    QuicksortOptions hoare;
+    hoare.partition = PartitionScheme::Hoare;
+    QuicksortOptions block;
+
+    std::vector<int> work;
+    for (const auto &input : inputs)
+    {
+        std::printf(" %s\n", input.first);
+        auto setup = [&] { work = input.second; };
+        if (std::strcmp(input.first, "random") == 0)
+        {
+            // Last-element pivot, as in the GUI; quadratic on sorted input
+            printPerfRow("Lomuto (classic)", n, measure(counters, setup, [&] {
+                NullTrace none;
+                lomutoQuicksort(work.data(), n, none);
+            }));
+        }
+        printPerfRow("Hoare partition", n, measure(counters, setup, [&] { quicksort(work.data(), n, hoare); }));
+        printPerfRow("Block partition", n, measure(counters, setup, [&] { quicksort(work.data(), n, block); }));
+        printPerfRow("std::sort", n, measure(counters, setup, [&] { std::sort(work.begin(), work.end()); }));
+        if (!std::is_sorted(work.begin(), work.end()))
+        {
+            std::printf("  NOT SORTED\n");
+        }
+    }
+}
+
+// Few distinct keys: plain partitions against grouping the pivot's copies
+// and the three-way partition
+void benchDuplicates(std::size_t n)
+{
+    std::printf("duplicates: %zu ints\n", n);
+    std::vector<int> work;
+    for (std::size_t distinct : {std::size_t(2), std::size_t(16), std::size_t(1000), n})
+    {
+        std::printf(" %zu distinct values\n", distinct);
+        std::vector<int> input = randomInts(n, 6);
+        for (int &v : input)
+        {
+            v = static_cast<int>(static_cast<unsigned>(v) % distinct);
+        }
+        auto reset = [&] { work = input; };
+        for (PartitionScheme scheme : {PartitionScheme::Hoare, PartitionScheme::Block})
+        {
+            const char *name = scheme == PartitionScheme::Hoare ? "Hoare" : "block";
+            for (bool group : {false, true})
+            {
+                QuicksortOptions options;
+                options.partition = scheme;
+                options.groupDuplicates = group;
+                double ms = timeBest(3, reset, [&] { quicksort(work.data(), n, options); });
+                printRow((std::string(name) + (group ? ", grouping duplicates" : ", plain")).c_str(), n, ms);
+            }
+        }
+        QuicksortOptions threeWay;
+        threeWay.partition = PartitionScheme::ThreeWay;
+        double ms = timeBest(3, reset, [&] { quicksort(work.data(), n, threeWay); });
+        printRow("three-way", n, ms);
+        ms = timeBest(3, reset, [&] { std::sort(work.begin(), work.end()); });
+        printRow("std::sort", n, ms);
+    }
+}
+
+// Every pivot strategy on inputs chosen to hurt one of them. Killer inputs
+// come from McIlroy's adversary: "median-of-3 killer" targets median of
+// three with the other options at their defaults, "own adversary" the
+// strategy in that row. The small run has the
+// depth limit off to show which strategies go quadratic; the large one
+// has it on, as in production.
+void benchPivots(std::size_t small, std::size_t n)
+{
+    const PivotStrategy strategies[] = {PivotStrategy::Last, PivotStrategy::Random, PivotStrategy::MedianOfThree,
+                                        PivotStrategy::Ninther, PivotStrategy::MedianOfMedians};
+    const char *inputNames[] = {"random", "sorted", "reverse", "organ pipe", "median-of-3 killer", "own adversary"};
+    std::vector<int> work;
+    for (std::size_t size : {small, n})
+    {
+        bool limited = size == n;
+        std::printf("pivots: %zu ints, depth limit %s, ms\n", size, limited ? "on" : "off");
+        std::printf("  %-20s", "");
+        for (const char *name : inputNames)
+        {
+            std::printf(" %19s", name);
+        }
+        std::printf("\n");
+
+        std::vector<int> sorted(size);
+        std::iota(sorted.begin(), sorted.end(), 0);
+        std::vector<int> organPipe(size);
+        for (std::size_t k = 0; k < size; ++k)
+        {
+            organPipe[k] = static_cast<int>(std::min(k, size - 1 - k));
+        }
+        QuicksortOptions killerTarget;
+        killerTarget.pivot = PivotStrategy::MedianOfThree;
+        killerTarget.depthLimit = limited;
+        std::vector<int> inputs[] = {randomInts(size, 7), sorted, std::vector<int>(sorted.rbegin(), sorted.rend()),
+                                     organPipe, quicksortAdversary(size, killerTarget), {}};
+
+        for (PivotStrategy strategy : strategies)
+        {
+            QuicksortOptions options;
+            options.pivot = strategy;
+            options.depthLimit = limited;
+            inputs[5] = quicksortAdversary(size, options);
+            std::printf("  %-20s", pivotStrategyName(strategy));
+            for (const std::vector<int> &input : inputs)
+            {
+                double ms = timeBest(limited ? 3 : 1, [&] { work = input; }, [&] { quicksort(work.data(), size, options); });
+                std::printf(" %19.2f", ms);
+                if (!std::is_sorted(work.begin(), work.end()))
+                {
+                    std::printf(" NOT SORTED");
+                }
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+// Heap arity against throughput and cache behaviour: counters around the
+// untraced sort at n, and the desktop cache model on a traced run at
+// traceN, which is smaller so the simulation stays quick
+void benchHeap(std::size_t traceN, std::size_t n)
+{
+    const unsigned arities[] = {2, 4, 8};
+    std::printf("heap: %zu ints, counters per element\n", n);
+    PerfCounters counters;
+    printPerfHeader(counters);
+    const std::vector<int> input = randomInts(n, 14);
+    std::vector<int> work;
+    for (unsigned arity : arities)
+    {
+        std::string name = std::to_string(arity) + "-ary heap sort";
+        printPerfRow(name.c_str(), n, measure(counters, [&] { work = input; }, [&] { heapSort(work.data(), n, arity); }));
+        if (!std::is_sorted(work.begin(), work.end()))
+        {
+            std::printf("  NOT SORTED\n");
+        }
+    }
+    printPerfRow("std::sort", n, measure(counters, [&] { work = input; }, [&] { std::sort(work.begin(), work.end()); }));
+
+    std::printf(" simulated desktop cache, %zu ints\n", traceN);
+    std::printf("  %-22s %10s %9s", "kernel", "events", "access/el");
+    for (const CacheLevelConfig &level : CacheConfig::desktop().levels)
+    {
+        std::printf(" %7s %9s", (level.name + " miss").c_str(), "misses/el");
+    }
+    std::printf("\n");
+    for (unsigned arity : arities)
+    {
+        std::vector<int> traced = randomInts(traceN, 14);
+        CacheSimulator simulator(CacheConfig::desktop(), traceN, sizeof(int));
+        {
+            StreamingTrace trace(simulator);
+            heapSortRange(traced.data(), 0, traceN, trace, arity);
+        }
+        std::vector<CacheLevelStats> levels = simulator.stats();
+        std::printf("  %-22s %10llu %9.1f", (std::to_string(arity) + "-ary heap sort").c_str(),
+                    static_cast<unsigned long long>(simulator.eventCount()), double(levels[0].accesses) / traceN);
+        for (const CacheLevelStats &level : levels)
+        {
+            std::printf(" %6.2f%% %9.2f", level.missRate() * 100.0, double(level.misses) / traceN);
+        }
+        std::printf("\n");
+    }
+}
+
+// Counts the comparisons and moves of a traced run
+class WorkCounter : public TraceSink
+{
+public:
+    void consume(const TraceEvent *events, std::size_t count) override
+    {
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            compares += events[k].type == TraceEvent::Compare;
+            moves += events[k].type == TraceEvent::Swap || events[k].type == TraceEvent::Write;
+        }
+    }
+
+    std::uint64_t compares = 0;
+    std::uint64_t moves = 0;
+};
+
+// Top-k, partial sort and nth element against a full sort of the same input:
+// time, and comparisons plus moves from a traced run, both as a share of
+// the full sort's. The heap modes are only run for small k, where they fit.
+void benchTopK(std::size_t n)
+{
+    std::printf("topk: %zu ints\n", n);
+    const std::vector<int> input = randomInts(n, 15);
+    std::vector<int> work;
+    auto reset = [&] { work = input; };
+
+    using Traced = std::function<void(int *, std::size_t, StreamingTrace &)>;
+    auto traceWork = [&](const Traced &run) {
+        work = input;
+        WorkCounter counter;
+        {
+            StreamingTrace trace(counter);
+            run(work.data(), n, trace);
+        }
+        return counter.compares + counter.moves;
+    };
+
+    double fullMs = timeBest(3, reset, [&] { quicksort(work.data(), n); });
+    std::uint64_t fullWork = traceWork([](int *a, std::size_t m, StreamingTrace &t) { quicksort(a, m, t); });
+    std::printf("  %-28s %10.2f ms %12llu compares+moves\n", "full quicksort", fullMs,
+                static_cast<unsigned long long>(fullWork));
+
+    for (std::size_t k : {std::size_t(10), std::size_t(1000), std::size_t(100000), n / 2})
+    {
+        std::printf(" k = %zu\n", k);
+        auto row = [&](const char *name, double ms, std::uint64_t ops) {
+            std::printf("  %-28s %10.2f ms %6.1f%% of the time", name, ms, 100.0 * ms / fullMs);
+            if (ops)
+            {
+                std::printf(" %6.1f%% of the work", 100.0 * ops / fullWork);
+            }
+            std::printf("\n");
+        };
+        auto check = [&](const char *name, bool sortedPrefix) {
+            std::vector<int> prefix(work.begin(), work.begin() + k);
+            if (!sortedPrefix)
+            {
+                std::sort(prefix.begin(), prefix.end());
+            }
+            std::vector<int> expected = input;
+            std::nth_element(expected.begin(), expected.begin() + k - 1, expected.end());
+            std::sort(expected.begin(), expected.begin() + k);
+            if (!std::equal(prefix.begin(), prefix.end(), expected.begin()))
+            {
+                std::printf("  %s: WRONG ANSWER\n", name);
+            }
+        };
+
+        NullTrace none;
+        double ms = timeBest(3, reset, [&] { partialQuicksort(work.data(), n, k, none); });
+        check("partial quicksort", true);
+        row("partial quicksort", ms, traceWork([k](int *a, std::size_t m, StreamingTrace &t) {
+                partialQuicksort(a, m, k, t);
+            }));
+        ms = timeBest(3, reset, [&] { nthElement(work.data(), n, k - 1, none); });
+        check("introselect (nth element)", false);
+        row("introselect (nth element)", ms, traceWork([k](int *a, std::size_t m, StreamingTrace &t) {
+                nthElement(a, m, k - 1, t);
+            }));
+        if (k <= n / 100)
+        {
+            ms = timeBest(3, reset, [&] { heapSelect(work.data(), n, k, none); });
+            check("bounded heap, top-k", false);
+            row("bounded heap, top-k", ms, traceWork([k](int *a, std::size_t m, StreamingTrace &t) {
+                    heapSelect(a, m, k, t);
+                }));
+            ms = timeBest(3, reset, [&] { heapPartialSort(work.data(), n, k, none); });
+            check("bounded heap, partial sort", true);
+            row("bounded heap, partial sort", ms, traceWork([k](int *a, std::size_t m, StreamingTrace &t) {
+                    heapPartialSort(a, m, k, t);
+                }));
+            std::vector<int> streamed;
+            ms = timeBest(3, [] {}, [&] {
+                StreamingTopK top(k);
+                for (std::size_t p = 0; p < n; p += 65536)
+                {
+                    top.push(input.data() + p, std::min<std::size_t>(65536, n - p));
+                }
+                streamed = top.sorted();
+            });
+            work = streamed;
+            work.resize(n);
+            check("streaming top-k", true);
+            row("streaming top-k, 64K pieces", ms, 0);
+            ms = timeBest(3, reset, [&] { std::partial_sort(work.begin(), work.begin() + k, work.end()); });
+            row("std::partial_sort", ms, 0);
+        }
+        ms = timeBest(3, reset, [&] { std::nth_element(work.begin(), work.begin() + k - 1, work.end()); });
+        row("std::nth_element", ms, 0);
+    }
+}
+
+// Sorting networks against insertion sort, alone on many small arrays and
+// as the base case of the quick and merge kernels
+void benchNetwork(std::size_t n)
+{
+    std::printf("network: %zu ints\n", n);
+    const std::vector<int> input = randomInts(n, 5);
+    std::vector<int> work;
+    auto reset = [&] { work = input; };
+
+    for (std::size_t size : {8, 16, 32})
+    {
+        std::printf(" %zu-element arrays\n", size);
+        double ms = timeBest(3, reset, [&] {
+            for (std::size_t k = 0; k + size <= n; k += size)
+            {
+                insertionSort(work.data() + k, size);
+            }
+        });
+        printRow("insertion sort", n, ms);
+        ms = timeBest(3, reset, [&] {
+            for (std::size_t k = 0; k + size <= n; k += size)
+            {
+                std::sort(work.data() + k, work.data() + k + size);
+            }
+        });
+        printRow("std::sort", n, ms);
+        ms = timeBest(3, reset, [&] {
+            for (std::size_t k = 0; k + size <= n; k += size)
+            {
+                sortSmall(work.data() + k, size);
+            }
+        });
+        printRow("sorting network", n, ms);
+    }
+
+    std::printf(" base case of whole sorts\n");
+    for (SmallSort small : {SmallSort::Insertion, SmallSort::Network})
+    {
+        const char *suffix = small == SmallSort::Network ? "network" : "insertion";
+        QuicksortOptions quick;
+        quick.smallSort = small;
+        double ms = timeBest(3, reset, [&] { quicksort(work.data(), n, quick); });
+        printRow((std::string("block quicksort, ") + suffix).c_str(), n, ms);
+
+        MergeSortOptions merge;
+        merge.smallSort = small;
+        MergeWorkspace workspace;
+        workspace.reserve(n);
+        NullTrace none;
+        ms = timeBest(3, reset, [&] { bottomUpMergeSort(work.data(), n, workspace, none, merge); });
+        printRow((std::string("bottom-up merge, ") + suffix).c_str(), n, ms);
+    }
+}
+
+// Many independent tiny arrays: one scalar sort per array against the
+// transposed batch kernel that runs 8 or 16 of them per vector instruction
+void benchBatch(std::size_t n)
+{
+    std::printf("batch: %zu ints split into small arrays, block kernel uses %s\n", n, batchSortIsa());
+    const std::vector<int> input = randomInts(n, 8);
+    std::vector<int> work;
+    auto reset = [&] { work = input; };
+
+    for (std::size_t length : {8, 16, 32, 64})
+    {
+        std::size_t count = n / length;
+        std::printf(" %zu arrays of %zu\n", count, length);
+        double ms = timeBest(3, reset, [&] {
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                std::sort(work.data() + k * length, work.data() + (k + 1) * length);
+            }
+        });
+        printRow("std::sort per array", n, ms);
+        ms = timeBest(3, reset, [&] {
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                insertionSort(work.data() + k * length, length);
+            }
+        });
+        printRow("insertion sort per array", n, ms);
+        if (length <= kMaxNetworkSize)
+        {
+            ms = timeBest(3, reset, [&] {
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    sortSmall(work.data() + k * length, length);
+                }
+            });
+            printRow("scalar network per array", n, ms);
+        }
+        ms = timeBest(3, reset, [&] { sortBatch(work.data(), count, length, 8); });
+        printRow("batch, 8 lanes", n, ms);
+        ms = timeBest(3, reset, [&] { sortBatch(work.data(), count, length, 16); });
+        printRow("batch, 16 lanes", n, ms);
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            if (!std::is_sorted(work.data() + k * length, work.data() + (k + 1) * length))
+            {
+                std::printf("  batch: NOT SORTED\n");
+                break;
+            }
+        }
+    }
+}
+
+// Merge kernels on two sorted halves, in GB/s of input merged, and inside
+// bottom-up merge sort
+void benchSimdMerge(std::size_t n)
+{
+    std::printf("simdmerge: %zu ints, AVX2 %s\n", n, cpuHasAvx2() ? "available" : "unavailable (scalar fallback)");
+    std::vector<int> input = randomInts(n, 12);
+    std::sort(input.begin(), input.begin() + n / 2);
+    std::sort(input.begin() + n / 2, input.end());
+    std::vector<int> out(n);
+    const MergeKernel kernels[] = {MergeKernel::Scalar, MergeKernel::Bitonic8, MergeKernel::Bitonic16};
+
+    for (MergeKernel kernel : kernels)
+    {
+        double ms = timeBest(5, [] {}, [&] {
+            mergeSorted(input.data(), n / 2, input.data() + n / 2, n - n / 2, out.data(), kernel);
+        });
+        std::printf("  %-28s %10.2f ms  %8.2f GB/s\n", (std::string("merge, ") + mergeKernelName(kernel)).c_str(), ms,
+                    n * sizeof(int) / ms / 1e6);
+    }
+    if (!std::is_sorted(out.begin(), out.end()))
+    {
+        std::printf("  merge: NOT SORTED\n");
+    }
+
+    const std::vector<int> unsorted = randomInts(n, 13);
+    std::vector<int> work;
+    MergeWorkspace workspace;
+    workspace.reserve(n);
+    for (MergeKernel kernel : kernels)
+    {
+        MergeSortOptions options;
+        options.mergeKernel = kernel;
+        NullTrace none;
+        double ms = timeBest(3, [&] { work = unsorted; }, [&] {
+            bottomUpMergeSort(work.data(), n, workspace, none, options);
+        });
+        printRow((std::string("merge sort, ") + mergeKernelName(kernel)).c_str(), n, ms);
+    }
+}
+
+// Integer-only kernels on keys from a narrow range: 0..65535, where counting
+// sort applies, and 0..n/2, too wide for its table, where bucket sort does.
+// Comparison sorts and radix sort are the baselines.
+void benchCounting(std::size_t n)
+{
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("counting: %zu ints, %u threads\n", n, cores);
+    std::vector<int> work;
+    std::vector<int> aux(n);
+    for (std::uint64_t span : {std::uint64_t(65536), std::uint64_t(n / 2)})
+    {
+        std::printf(" keys 0..%llu\n", static_cast<unsigned long long>(span - 1));
+        std::vector<int> input = randomInts(n, 14);
+        for (int &v : input)
+        {
+            v = static_cast<int>(static_cast<unsigned>(v) % span);
+        }
+        auto reset = [&] { work = input; };
+        if (span <= kMaxCountingSpan)
+        {
+            double ms = timeBest(3, reset, [&] { countingSort(work.data(), n, 1); });
+            printRow("counting sort, 1 thread", n, ms);
+            ms = timeBest(3, reset, [&] { countingSort(work.data(), n, cores); });
+            printRow("counting sort", n, ms);
+            std::printf("  %-28s %10.1f KB\n", "counting sort extra memory", span * cores * sizeof(std::size_t) / 1024.0);
+        }
+        double ms = timeBest(3, reset, [&] { bucketSort(work.data(), n, cores); });
+        printRow("bucket sort", n, ms);
+        if (!std::is_sorted(work.begin(), work.end()))
+        {
+            std::printf("  bucket sort: NOT SORTED\n");
+        }
+        ms = timeBest(3, reset, [&] { lsdRadixSort(work.data(), n, aux.data()); });
+        printRow("LSD radix sort", n, ms);
+        QuicksortOptions threeWay;
+        threeWay.partition = PartitionScheme::ThreeWay;
+        ms = timeBest(1, reset, [&] { quicksort(work.data(), n, threeWay); });
+        printRow("three-way quicksort", n, ms);
+        ms = timeBest(1, reset, [&] { std::sort(work.begin(), work.end()); });
+        printRow("std::sort", n, ms);
+    }
+}
+
+// Applies a kernel's trace to a ColumnTree as the GUI does, with a new
+// stamp every `perFrame` events
+class ColumnTreeSink : public TraceSink
+{
+public:
+    ColumnTreeSink(ColumnTree &tree, std::size_t perFrame) : tree(tree), perFrame(perFrame) {}
+
+    void consume(const TraceEvent *events, std::size_t count) override
+    {
+        tree.apply(events, count, stamp);
+        total += count;
+        sinceStamp += count;
+        if (sinceStamp >= perFrame)
+        {
+            ++stamp;
+            sinceStamp = 0;
+        }
+    }
+
+    std::uint64_t total = 0;
+
+private:
+    ColumnTree &tree;
+    std::size_t perFrame;
+    std::size_t sinceStamp = 0;
+    std::uint32_t stamp = 1;
+};
+
+// Level-of-detail view of an n-element sort on a `width`-pixel canvas: the
+// cost of one frame of columns from the tree against a scan of the visible
+// elements, and how fast a traced quicksort can be applied to the tree
+void benchOverview(std::size_t n, std::size_t width)
+{
+    std::printf("overview: %zu ints on %zu columns\n", n, width);
+    std::vector<int> input = randomInts(n, 16);
+    ColumnTree tree;
+    auto start = Clock::now();
+    tree.assign(input);
+    std::printf("  %-28s %10.2f ms\n", "build tree", std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+    std::vector<ColumnSummary> columns(width);
+    for (std::size_t visible : {n, n / 1000})
+    {
+        std::size_t first = (n - visible) / 2;
+        double treeMs = timeBest(20, [] {}, [&] { tree.columns(first, first + visible, width, columns.data()); });
+        double scanMs = timeBest(5, [] {}, [&] {
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                std::size_t from = first + visible * x / width;
+                std::size_t to = std::max(from + 1, first + visible * (x + 1) / width);
+                auto [lowest, highest] = std::minmax_element(input.begin() + from, input.begin() + to);
+                columns[x] = {*lowest, *highest, 0};
+            }
+        });
+        std::printf("  %zu visible: frame from tree %.3f ms, from a scan %.3f ms\n", visible, treeMs, scanMs);
+    }
+
+    ColumnTreeSink sink(tree, 200000);
+    std::vector<int> work = input;
+    start = Clock::now();
+    {
+        StreamingTrace trace(sink);
+        quicksort(work.data(), n, trace);
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::printf("  %-28s %10.2f ms  %8.1f M events/s (%llu events)\n", "quicksort applied to tree", ms,
+                sink.total / ms / 1e3, static_cast<unsigned long long>(sink.total));
+    if (tree.data() != work || !tree.sorted())
+    {
+        std::printf("  tree: OUT OF STEP\n");
+    }
+}
+
+// Completion checks after every step, as the animated sorts make them near
+// the end of a sort: `ops` random swaps within the last `window` elements of
+// a sorted n-element array are made and then undone in reverse, with "is it
+// sorted?" asked after each swap. A scan has to get past the sorted prefix.
+void benchSortedness(std::size_t n, std::size_t window, std::size_t ops)
+{
+    std::printf("sortedness: %zu ints, %zu swaps out and back in the last %zu\n", n, ops, window);
+    std::vector<int> work(n);
+    std::iota(work.begin(), work.end(), 0);
+    std::mt19937_64 rng(17);
+    std::vector<std::pair<std::size_t, std::size_t>> swaps(ops);
+    for (auto &s : swaps)
+    {
+        s = {n - 1 - rng() % window, n - 1 - rng() % window};
+    }
+
+    std::size_t sortedSteps = 0;
+    auto replay = [&](auto &&step) {
+        sortedSteps = 0;
+        for (std::size_t k = 0; k < 2 * ops; ++k)
+        {
+            auto [i, j] = swaps[k < ops ? k : 2 * ops - 1 - k];
+            std::swap(work[i], work[j]);
+            sortedSteps += step(i, j);
+        }
+    };
+    double scanMs = timeBest(3, [] {}, [&] {
+        replay([&](std::size_t, std::size_t) { return std::is_sorted(work.begin(), work.end()); });
+    });
+    std::size_t scanSorted = sortedSteps;
+    SortednessTracker tracker;
+    tracker.assign(work.data(), n);
+    double trackMs = timeBest(3, [] {}, [&] {
+        replay([&](std::size_t i, std::size_t j) {
+            tracker.swapped(work.data(), i, j);
+            return tracker.sorted();
+        });
+    });
+    std::printf("  %-28s %10.3f ms\n", "std::is_sorted per step", scanMs);
+    std::printf("  %-28s %10.3f ms\n", "descent count per step", trackMs);
+    if (scanSorted != sortedSteps)
+    {
+        std::printf("  sortedness: MISMATCH (%zu vs %zu sorted steps)\n", scanSorted, sortedSteps);
+    }
+}
+
+// Sustained ingest into a StreamingSort fed in pieces of 4096, with the
+// compactor in the background and inline, then query latency against the
+// runs it ends with, and the whole-array LSM sort against one-shot kernels
+void benchStream(std::size_t n)
+{
+    std::printf("stream: %zu ints\n", n);
+    std::vector<int> input = randomInts(n, 18);
+    constexpr std::size_t kPiece = 4096;
+    for (bool background : {true, false})
+    {
+        StreamingSortOptions options;
+        options.background = background;
+        StreamingSort sorter(options);
+        auto start = Clock::now();
+        for (std::size_t k = 0; k < n; k += kPiece)
+        {
+            sorter.push(input.data() + k, std::min(kPiece, n - k));
+        }
+        double ingestMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        sorter.flush();
+        sorter.waitForCompaction();
+        double settledMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        StreamingSortStats stats = sorter.stats();
+        printRow(background ? "ingest, background merges" : "ingest, inline merges", n, ingestMs);
+        std::printf("  %-28s %10.2f ms, %zu runs, write amplification %.2f\n", "  until merges settle", settledMs,
+                    sorter.runs().size(), double(stats.mergedValues) / n);
+        if (!background)
+        {
+            continue;
+        }
+
+        std::mt19937 rng(19);
+        constexpr int kQueries = 1000;
+        std::uint64_t checksum = 0;
+        double rankUs = timeBest(1, [] {}, [&] {
+            for (int q = 0; q < kQueries; ++q)
+            {
+                checksum += sorter.rank(static_cast<int>(rng()));
+            }
+        }) * 1000 / kQueries;
+        double selectUs = timeBest(1, [] {}, [&] {
+            for (int q = 0; q < kQueries; ++q)
+            {
+                std::int32_t value;
+                sorter.select(rng() % n, value);
+                checksum += static_cast<std::uint32_t>(value);
+            }
+        }) * 1000 / kQueries;
+        double rangeUs = timeBest(1, [] {}, [&] {
+            for (int q = 0; q < kQueries; ++q)
+            {
+                int lo = static_cast<int>(rng());
+                checksum += sorter.range(lo, lo + (1 << 20)).size();
+            }
+        }) * 1000 / kQueries;
+        std::printf("  rank %.2f us, select %.2f us, range of ~%zu values %.2f us (checksum %llu)\n", rankUs,
+                    selectUs, std::size_t(double(n) * (1 << 20) / 4294967296.0), rangeUs,
+                    static_cast<unsigned long long>(checksum));
+
+        std::vector<int> expected = input;
+        std::sort(expected.begin(), expected.end());
+        start = Clock::now();
+        std::vector<int> view = sorter.sorted();
+        printRow("sorted view from the runs", n, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        if (view != expected)
+        {
+            std::printf("  stream: NOT SORTED\n");
+        }
+    }
+
+    std::vector<int> work;
+    std::vector<int> aux(n);
+    auto reset = [&] { work = input; };
+    printRow("lsmSort", n, timeBest(3, reset, [&] { lsmSort(work.data(), n); }));
+    if (!std::is_sorted(work.begin(), work.end()))
+    {
+        std::printf("  lsmSort: NOT SORTED\n");
+    }
+    printRow("LSD radix sort", n, timeBest(3, reset, [&] { lsdRadixSort(work.data(), n, aux.data()); }));
+    printRow("quicksort", n, timeBest(3, reset, [&] { quicksort(work.data(), n); }));
+}
+
+// Edits to a sorted n-element array: single values repaired by binary
+// search and memmove, batches merged in, each against sorting again
+void benchEdits(std::size_t n)
+{
+    std::printf("edits: sorted array of %zu ints\n", n);
+    std::vector<int> sorted = randomInts(n, 20);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<int> work = sorted;
+    std::mt19937 rng(21);
+
+    // Random edits move a value about n / 3 on average; small ones barely move
+    constexpr int kSingles = 200;
+    for (bool small : {false, true})
+    {
+        std::uint64_t moved = 0;
+        double ms = timeBest(1, [] {}, [&] {
+            for (int e = 0; e < kSingles; ++e)
+            {
+                std::size_t i = rng() % n;
+                int value = small ? work[i] + static_cast<int>(rng() % 2001) - 1000 : static_cast<int>(rng());
+                std::size_t to = editSorted(work.data(), n, i, value);
+                moved += to > i ? to - i : i - to;
+            }
+        });
+        std::printf("  %-28s %10.4f ms per edit, %zu positions moved on average\n",
+                    small ? "single edit, small change" : "single edit, random value", ms / kSingles,
+                    static_cast<std::size_t>(moved / kSingles));
+    }
+    if (!std::is_sorted(work.begin(), work.end()))
+    {
+        std::printf("  edits: NOT SORTED\n");
+    }
+
+    for (std::size_t k : {std::size_t(1000), n / 100})
+    {
+        std::vector<ValueEdit> edits(k);
+        for (ValueEdit &edit : edits)
+        {
+            edit = {rng() % n, static_cast<int>(rng())};
+        }
+        auto reset = [&] { work = sorted; };
+        double mergeMs = timeBest(3, reset, [&] { applyEdits(work.data(), n, edits); });
+        std::vector<int> expected = sorted;
+        for (const ValueEdit &edit : edits)
+        {
+            expected[edit.index] = edit.value;
+        }
+        double resortMs = timeBest(3, [&] { work = expected; }, [&] { quicksort(work.data(), n); });
+        reset();
+        applyEdits(work.data(), n, edits);
+        std::sort(expected.begin(), expected.end());
+        std::printf("  %7zu edits: merged in %.2f ms, sorting again %.2f ms%s\n", k, mergeMs, resortMs,
+                    work == expected ? "" : "  NOT SORTED");
+    }
+}
+
+void benchCollation(std::size_t n)
+{
+    Collator collator;
+    if (!collator.open("en_US"))
+    {
+        std::printf("collation: %s\n", collator.errorString().c_str());
+        return;
+    }
+    std::printf("collation: %zu mixed-case and accented names, en_US\n", n);
+
+    // Case and accents are where byte order and collation disagree
+    static const char *words[] = {"apple", "Apple", "\xC3\x84pfel", "zebra", "Z\xC3\xBCrich", "eclair",
+                                  "\xC3\x89" "clair", "resume", "r\xC3\xA9sum\xC3\xA9", "Strasse",
+                                  "stra\xC3\x9F" "e", "naive", "na\xC3\xAFve", "Oslo", "\xC3\x98stfold", "delta"};
+    std::mt19937 rng(22);
+    StringArena arena;
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        arena.add(std::string(words[rng() % 16]) + " " + words[rng() % 16] + " " + std::to_string(rng() % 100000));
+    }
+
+    std::vector<std::uint32_t> ids(n), work;
+    std::iota(ids.begin(), ids.end(), 0u);
+    double ms = timeBest(1, [&] { work = ids; }, [&] {
+        std::sort(work.begin(), work.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return collator.compare(arena.view(a), arena.view(b)) < 0;
+        });
+    });
+    printRow("std::sort, collate per compare", n, ms);
+
+    StringArena keys;
+    ms = timeBest(3, [] {}, [&] { keys = collationKeys(collator, arena, 1); });
+    printRow("sort keys, 1 thread", n, ms);
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    if (cores > 1)
+    {
+        ms = timeBest(3, [] {}, [&] { keys = collationKeys(collator, arena); });
+        printRow("sort keys, all cores", n, ms);
+    }
+    std::size_t keyBytes = 0;
+    for (std::uint32_t id = 0; id < n; ++id)
+    {
+        keyBytes += keys.view(id).size();
+    }
+
+    const std::vector<StringRef> initial = makeStringRefs(keys);
+    std::vector<StringRef> refs;
+    ms = timeBest(3, [&] { refs = initial; }, [&] { msdRadixSort(keys, refs); });
+    printRow("MSD radix sort of the keys", n, ms);
+
+    std::vector<std::uint32_t> order;
+    ms = timeBest(3, [] {}, [&] { order = collationOrder(collator, arena); });
+    printRow("keys + sort, total", n, ms);
+    std::printf("  %.1f key bytes per string\n", double(keyBytes) / n);
+    for (std::size_t k = 1; k < n; ++k)
+    {
+        if (collator.compare(arena.view(order[k - 1]), arena.view(order[k])) > 0)
+        {
+            std::printf("  collation order: MISMATCH at %zu\n", k);
+            break;
+        }
+    }
+}
+
+void benchCsv(std::size_t n)
+{
+    std::mt19937 rng(23);
+    std::vector<std::string> names = makeKeys(n, rng);
+    std::string text;
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        char row[96];
+        std::snprintf(row, sizeof row, ",%d.%02d,%04d-%02d-%02d\n", static_cast<int>(rng() % 100000) - 50000,
+                      static_cast<int>(rng() % 100), 2000 + static_cast<int>(rng() % 25), 1 + static_cast<int>(rng() % 12),
+                      1 + static_cast<int>(rng() % 28));
+        text += names[k];
+        text += row;
+    }
+    std::printf("csv: %zu rows, %.0f MB, by date, amount descending, name\n", n, text.size() / 1e6);
+    auto printBytes = [&](const char *name, double ms) {
+        std::printf("  %-28s %10.2f ms  %8.0f MB/s\n", name, ms, text.size() / ms / 1e3);
+    };
+
+    volatile std::size_t sink = 0;
+    double ms = timeBest(3, [] {}, [&] {
+        sink = static_cast<std::size_t>(std::accumulate(text.begin(), text.end(), 0));
+    });
+    printBytes("byte scan (bandwidth)", ms);
+
+    std::vector<std::uint64_t> starts;
+    ms = timeBest(3, [] {}, [&] { starts = csvRowStarts(text.data(), text.size()); });
+    printBytes("row boundaries", ms);
+
+    CsvSortOptions options;
+    CsvKeyColumn key;
+    parseCsvKey("3d", key);
+    options.keys.push_back(key);
+    parseCsvKey("2nr", key);
+    options.keys.push_back(key);
+    parseCsvKey("1", key);
+    options.keys.push_back(key);
+    std::vector<std::uint32_t> order;
+    ms = timeBest(3, [] {}, [&] { sortCsvRows(text.data(), starts, options, order); });
+    printBytes("normalized keys + sort", ms);
+
+    // The same order with the fields parsed again on every comparison
+    auto field = [&](std::uint32_t row, int column) {
+        const char *p = text.data() + starts[row];
+        for (int c = 0; c < column; ++c)
+        {
+            p = static_cast<const char *>(std::memchr(p, ',', text.size())) + 1;
+        }
+        return p;
+    };
+    std::vector<std::uint32_t> rows(n), work;
+    std::iota(rows.begin(), rows.end(), 0u);
+    ms = timeBest(1, [&] { work = rows; }, [&] {
+        std::sort(work.begin(), work.end(), [&](std::uint32_t x, std::uint32_t y) {
+            int c = std::strncmp(field(x, 2), field(y, 2), 10);
+            if (c != 0)
+            {
+                return c < 0;
+            }
+            double a = std::strtod(field(x, 1), nullptr);
+            double b = std::strtod(field(y, 1), nullptr);
+            if (a != b)
+            {
+                return a > b;
+            }
+            std::string_view s(text.data() + starts[x], static_cast<std::size_t>(field(x, 1) - 1 - text.data() - starts[x]));
+            std::string_view t(text.data() + starts[y], static_cast<std::size_t>(field(y, 1) - 1 - text.data() - starts[y]));
+            return s != t ? s < t : x < y;
+        });
+    });
+    printBytes("std::sort, parse per compare", ms);
+    if (work != order)
+    {
+        std::printf("  csv: orders differ\n");
+    }
+
+    std::string out(text.size(), '\0');
+    ms = timeBest(3, [] {}, [&] {
+        char *to = &out[0];
+        for (std::uint32_t row : order)
+        {
+            std::size_t size = static_cast<std::size_t>(starts[row + 1] - starts[row]);
+            std::memcpy(to, text.data() + starts[row], size);
+            to += size;
+        }
+    });
+    printBytes("gathered copy of the rows", ms);
+}
+
+void benchCluster(std::size_t n)
+{
+    std::printf("cluster: %zu ints, sample sort across processes, %u cores\n", n,
+                std::thread::hardware_concurrency());
+    std::vector<int> input = randomInts(n, 20);
+    std::vector<int> work;
+    double ms = timeBest(3, [&] { work = input; }, [&] { runKernel(SortKernel::LsdRadix, work.data(), n); });
+    printRow("radix, in process", n, ms);
+
+    std::vector<int> expected = work;
+    std::printf("  %-12s %8s %8s %8s %8s %8s %8s %7s\n", "", "launch", "sample", "exchange", "sort", "output",
+                "total", "skew");
+    for (unsigned processes : {1u, 2u, 4u, 8u})
+    {
+        ClusterSortOptions options;
+        options.processes = processes;
+        ClusterSortStats stats;
+        std::string error;
+        work = input;
+        auto start = Clock::now();
+        if (!clusterSort(work.data(), n, options, &stats, &error))
+        {
+            std::printf("  cluster: %s\n", error.c_str());
+            return;
+        }
+        double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        // Largest part over the even share: the local sort waits for it
+        double skew = *std::max_element(stats.partSizes.begin(), stats.partSizes.end()) * double(processes) / n;
+        std::printf("  %u %-10s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %7.2f\n", processes,
+                    processes == 1 ? "process" : "processes", stats.launchMs, stats.samplingMs, stats.exchangeMs,
+                    stats.localSortMs, stats.outputMs, totalMs, skew);
+        if (work != expected)
+        {
+            std::printf("  cluster: result differs\n");
+        }
+    }
+}
+
+// A traced merge sort run, recorded into a trace cache, then replayed from
+// the mapped entry: what a second run of the same algorithm on the same
+// input costs instead. Keyframes every n events let a replay start midway.
+void benchTraceCache(std::size_t n)
+{
+    std::printf("tracecache: merge sort trace of %zu ints\n", n);
+    std::vector<int> input = randomInts(n, 21);
+    std::string directory = (std::filesystem::temp_directory_path() / "sortsimple-bench-traces").string();
+    std::filesystem::remove_all(directory);
+    TraceCache cache;
+    if (!cache.open(directory))
+    {
+        std::printf("  %s\n", cache.errorString().c_str());
+        return;
+    }
+
+    double ms = timeBest(3, [] {}, [&] { hashBytes(input.data(), n * sizeof(int)); });
+    std::printf("  %-28s %10.2f ms  %8.1f GB/s\n", "hash the input", ms, n * sizeof(int) / ms / 1e6);
+    TraceCacheKey key = makeTraceCacheKey("merge", "", input.data(), n);
+
+    std::vector<int> work;
+    WorkCounter counter;
+    ms = timeBest(1, [&] { work = input; }, [&] {
+        MergeWorkspace workspace;
+        StreamingTrace trace(counter);
+        bottomUpMergeSort(work.data(), n, workspace, trace);
+    });
+    printRow("traced run", n, ms);
+
+    ms = timeBest(1, [&] { work = input; }, [&] {
+        std::unique_ptr<TraceCacheWriter> writer = cache.record(key, input.data(), &counter, n);
+        {
+            MergeWorkspace workspace;
+            StreamingTrace trace(*writer);
+            bottomUpMergeSort(work.data(), n, workspace, trace);
+        }
+        writer->commit();
+    });
+    printRow("traced run, recorded", n, ms);
+
+    TraceCacheEntry entry;
+    ms = timeBest(1, [] {}, [&] { cache.lookup(key, entry); });
+    std::printf("  %-28s %10.2f ms, %llu events, %zu keyframes\n", "lookup and map", ms,
+                static_cast<unsigned long long>(entry.eventCount()), entry.keyframeCount());
+    WorkCounter replayed;
+    ms = timeBest(1, [] {}, [&] { replayed.consume(entry.events(), static_cast<std::size_t>(entry.eventCount())); });
+    printRow("replay from the mapping", n, ms);
+    if (replayed.compares != counter.compares / 2 || replayed.moves != counter.moves / 2)
+    {
+        std::printf("  tracecache: replayed events differ\n");
+    }
+
+    std::vector<int> state;
+    std::uint64_t middle = entry.eventCount() / 2;
+    ms = timeBest(3, [] {}, [&] { entry.stateAt(middle, state); });
+    std::printf("  %-28s %10.2f ms\n", "seek to the middle", ms);
+    entry.stateAt(entry.eventCount(), state);
+    if (state != work)
+    {
+        std::printf("  tracecache: replay differs from the run\n");
+    }
+
+    TraceCacheStats stats = cache.stats();
+    std::printf("  %llu hits, %llu misses, %llu entries, %.1f MB\n", static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses), static_cast<unsigned long long>(stats.entries),
+                stats.bytes / 1e6);
+    entry.close();
+    std::filesystem::remove_all(directory);
+}
+
+// Bytes in the last-level cache, or 8 MB where the system does not say
+std::size_t lastLevelCacheBytes()
+{
+#if defined(_SC_LEVEL3_CACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (bytes <= 0)
+    {
+        bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+    if (bytes > 0)
+    {
+        return static_cast<std::size_t>(bytes);
+    }
+#endif
+    return std::size_t(8) << 20;
+}
+
+// The fewest full sweeps over memory a kernel makes on n random ints, as
+// runKernel() runs it: reads only, writes only, and copies that read one
+// array and write another. Work on parts that fit in the cache is free.
+struct MemoryPasses
+{
+    double reads = 0;
+    double writes = 0;
+    double copies = 0;
+};
+
+MemoryPasses minimumPasses(SortKernel kernel, std::size_t n, std::size_t cacheBytes)
+{
+    MemoryPasses passes;
+    double bytes = double(n) * sizeof(int);
+    switch (kernel)
+    {
+    case SortKernel::LsdRadix:
+    {
+        // One read for every histogram, then a scatter per digit of the 32-bit
+        // range and a copy home after an odd number of them
+        unsigned scatters = (32 + tuning().radixDigitBits - 1) / tuning().radixDigitBits;
+        passes.reads = 1;
+        passes.writes = 1;  // runKernel() allocates and zeroes the n-int buffer on every call
+        passes.copies = scatters + scatters % 2;
+        break;
+    }
+    case SortKernel::CountingSort:
+        passes.reads = 1;  // Histogram; the values are then written from it
+        passes.writes = 1;
+        break;
+    case SortKernel::BottomUpMerge:
+    {
+        // Runs are formed in place, then every level of merging streams the
+        // whole array from one buffer to the other, and home after an odd count
+        std::size_t runs = (n + tuning().mergeMinRun - 1) / tuning().mergeMinRun;
+        double levels = std::ceil(std::log2(double(std::max<std::size_t>(runs, 1))));
+        passes.writes = 1;  // The workspace, allocated and zeroed on every call as for radix
+        passes.copies = 1 + levels + std::fmod(levels, 2.0);
+        break;
+    }
+    default:
+        // Quicksort partitions: each level is a sweep until the parts fit in
+        // the cache, and one more sweep sorts the cached parts
+        passes.copies = 1 + std::max(0.0, std::ceil(std::log2(bytes / cacheBytes)));
+        break;
+    }
+    return passes;
+}
+
+// This machine's sequential read, write and copy bandwidth and random-access
+// latency, over arrays too large for the cache, then each kernel's time
+// against the time those passes would take at that bandwidth. A kernel close
+// to 100% can only get faster by making fewer passes; one far below it is
+// limited by its own instructions, branches or latency. Everything runs on
+// one thread, counting sort included, so the kernels meet the bandwidth of
+// a single core.
+void benchRoofline(std::size_t n)
+{
+    std::size_t cacheBytes = lastLevelCacheBytes();
+    double bytes = double(n) * sizeof(int);
+    std::printf("roofline: %zu ints (%.0f MB), last-level cache %.1f MB, one thread\n", n, bytes / 1e6,
+                cacheBytes / 1e6);
+    std::vector<int> src = randomInts(n, 22);
+    std::vector<int> dst(n);
+
+    // Reads as 64-bit words into four sums, so neither the adds nor the
+    // dependency between them limit the rate
+    volatile std::uint64_t sink = 0;
+    double readMs = timeBest(3, [] {}, [&] {
+        const std::uint64_t *words = reinterpret_cast<const std::uint64_t *>(src.data());
+        std::uint64_t sums[4] = {0, 0, 0, 0};
+        for (std::size_t k = 0; k + 4 <= n / 2; k += 4)
+        {
+            sums[0] += words[k];
+            sums[1] += words[k + 1];
+            sums[2] += words[k + 2];
+            sums[3] += words[k + 3];
+        }
+        sink = sums[0] + sums[1] + sums[2] + sums[3];
+    });
+    std::printf("  %-28s %10.2f ms  %8.1f GB/s\n", "sequential read", readMs, bytes / readMs / 1e6);
+    int fill = 0;
+    double writeMs = timeBest(3, [] {}, [&] { std::memset(dst.data(), ++fill, n * sizeof(int)); });
+    std::printf("  %-28s %10.2f ms  %8.1f GB/s\n", "sequential write", writeMs, bytes / writeMs / 1e6);
+    double copyMs = timeBest(3, [] {}, [&] { std::memcpy(dst.data(), src.data(), n * sizeof(int)); });
+    std::printf("  %-28s %10.2f ms  %8.1f GB/s (read + write)\n", "copy", copyMs, 2 * bytes / copyMs / 1e6);
+
+    // A single cycle through every slot (Sattolo), so each load depends on
+    // the last and the prefetchers cannot guess the next
+    std::vector<std::uint32_t> next(n);
+    std::iota(next.begin(), next.end(), 0u);
+    std::mt19937 rng(23);
+    for (std::size_t k = n - 1; k > 0; --k)
+    {
+        std::swap(next[k], next[std::uniform_int_distribution<std::size_t>(0, k - 1)(rng)]);
+    }
+    constexpr std::size_t kLoads = std::size_t(1) << 22;
+    std::uint32_t at = 0;
+    double chaseMs = timeBest(3, [] {}, [&] {
+        for (std::size_t k = 0; k < kLoads; ++k)
+        {
+            at = next[at];
+        }
+    });
+    sink = sink + at;
+    std::printf("  %-28s %10.1f ns per dependent load\n", "random access latency", chaseMs * 1e6 / kLoads);
+    next = std::vector<std::uint32_t>();
+
+    std::vector<int> narrow = src;
+    for (int &v : narrow)
+    {
+        v &= 0xFFFF;  // Keeps counting sort on its one-pass path
+    }
+    TuningConfig tuned = tuning();
+    TuningConfig oneThread = tuned;
+    oneThread.parallelGrain = std::numeric_limits<std::size_t>::max();  // Counting sort would otherwise split the work across cores
+    setTuning(oneThread);
+    std::printf("  %-28s %10s %8s %7s %10s %8s  %s\n", "", "ms", "GB/s", "% roof", "passes", "ns/el", "bound by");
+    for (SortKernel kernel : {SortKernel::StdSort, SortKernel::BlockQuicksort, SortKernel::BottomUpMerge,
+                              SortKernel::LsdRadix, SortKernel::CountingSort})
+    {
+        const std::vector<int> &input = kernel == SortKernel::CountingSort ? narrow : src;
+        double ms = timeBest(3, [&] { dst = input; }, [&] { runKernel(kernel, dst.data(), n); });
+        MemoryPasses passes = minimumPasses(kernel, n, cacheBytes);
+        double traffic = (passes.reads + passes.writes + 2 * passes.copies) * bytes;
+        double rooflineMs = passes.reads * readMs + passes.writes * writeMs + passes.copies * copyMs;
+        double percent = 100 * rooflineMs / ms;
+        char passText[64];
+        std::snprintf(passText, sizeof passText, "%gR %gW %gC", passes.reads, passes.writes, passes.copies);
+        std::printf("  %-28s %10.2f %8.1f %6.0f%% %10s %8.2f  %s\n", kernelName(kernel), ms, traffic / ms / 1e6,
+                    percent, passText, ms * 1e6 / n,
+                    percent >= 50 ? "memory: needs fewer passes" : "compute: tune the kernel");
+    }
+    std::printf("  (merge and radix include zeroing the buffer runKernel allocates, counted as one write)\n");
+    setTuning(tuned);
+}
+
+struct Section
+{
+    const char *name;
+    std::function<void()> run;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::vector<Section> sections = {
+        {"strings", [] { benchStrings(1000000); }},
+        {"load", [] { benchLoad(20000000); }},
+        {"merge", [] { benchMerge(10000000); }},
+        {"auto", [] { benchAuto(10000000); }},
+        {"cache", [] { benchCache(10000, 1000000); }},
+        {"perf", [] { benchPerf(10000000); }},
+        {"partition", [] { benchPartition(10000000); }},
+        {"duplicates", [] { benchDuplicates(10000000); }},
+        {"pivots", [] { benchPivots(30000, 10000000); }},
+        {"heap", [] { benchHeap(1000000, 10000000); }},
+        {"topk", [] { benchTopK(10000000); }},
+        {"network", [] { benchNetwork(10000000); }},
+        {"batch", [] { benchBatch(16777216); }},
+        {"simdmerge", [] { benchSimdMerge(16777216); }},
+        {"counting", [] { benchCounting(100000000); }},
+        {"overview", [] { benchOverview(10000000, 1920); }},
+        {"sortedness", [] { benchSortedness(1000000, 1000, 1000); }},
+        {"stream", [] { benchStream(10000000); }},
+        {"edits", [] { benchEdits(10000000); }},
+        {"collation", [] { benchCollation(1000000); }},
+        {"csv", [] { benchCsv(2000000); }},
+        {"cluster", [] { benchCluster(10000000); }},
+        {"tracecache", [] { benchTraceCache(200000); }},
+        {"roofline", [] { benchRoofline(std::size_t(1) << 26); }},
+    };
+
+    for (const Section &section : sections)
+    {
+        bool selected = argc < 2;
+        for (int a = 1; a < argc; ++a)
+        {
+            selected = selected || std::strcmp(argv[a], section.name) == 0;
+        }
+        if (selected)
+        {
+            section.run();
+        }
+    }
+    return 0;
+}
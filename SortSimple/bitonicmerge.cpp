@@ -0,0 +1,180 @@
+#include "bitonicmerge.h"
+#include "cpufeatures.h"
+#include <algorithm>
+
+#if SORT_HAVE_X86
+#include <immintrin.h>
+#endif
+
+const char *mergeKernelName(MergeKernel kernel)
+{
+    switch (kernel)
+    {
+    case MergeKernel::Scalar:
+        return "scalar";
+    case MergeKernel::Bitonic8:
+        return "bitonic 8";
+    case MergeKernel::Bitonic16:
+        return "bitonic 16";
+    }
+    return "?";
+}
+
+namespace {
+
+void mergeScalar(const int *a, std::size_t na, const int *b, std::size_t nb, int *out)
+{
+    const int *aEnd = a + na;
+    const int *bEnd = b + nb;
+    while (a < aEnd && b < bEnd)
+    {
+        *out++ = *b < *a ? *b++ : *a++;
+    }
+    out = std::copy(a, aEnd, out);
+    std::copy(b, bEnd, out);
+}
+
+// Finishes a bitonic merge once a side has no full block left: `held` are
+// the larger half of the last step, which no output so far exceeds
+void mergeTail(const int *held, std::size_t nh, const int *a, std::size_t na, const int *b, std::size_t nb, int *out)
+{
+    const int *hEnd = held + nh;
+    const int *aEnd = a + na;
+    const int *bEnd = b + nb;
+    while (held < hEnd && (a < aEnd || b < bEnd))
+    {
+        if (a < aEnd && (b == bEnd || *a <= *b))
+        {
+            *out++ = *a < *held ? *a++ : *held++;
+        }
+        else
+        {
+            *out++ = *b < *held ? *b++ : *held++;
+        }
+    }
+    out = std::copy(held, hEnd, out);
+    mergeScalar(a, aEnd - a, b, bEnd - b, out);
+}
+
+#if SORT_HAVE_X86
+
+// Sorts a bitonic 8-lane register: half-cleaners at distance 4, 2 and 1
+SORT_TARGET_AVX2 inline __m256i bitonicClean8(__m256i v)
+{
+    __m256i p = _mm256_permute2x128_si256(v, v, 0x01);
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xF0);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    v = _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xCC);
+    p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_blend_epi32(_mm256_min_epi32(v, p), _mm256_max_epi32(v, p), 0xAA);
+}
+
+SORT_TARGET_AVX2 inline __m256i reverse8(__m256i v)
+{
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+// Two sorted blocks of W = 8 * Vectors keys in, the W smallest out in lo
+// and the W largest in hi, both sorted
+template <int Vectors>
+SORT_TARGET_AVX2 inline void bitonicMerge(__m256i *lo, __m256i *hi)
+{
+    // Reversing hi turns lo ++ hi into one bitonic sequence
+    __m256i r[Vectors];
+    for (int v = 0; v < Vectors; ++v)
+    {
+        r[v] = reverse8(hi[Vectors - 1 - v]);
+    }
+    for (int v = 0; v < Vectors; ++v)
+    {
+        __m256i mn = _mm256_min_epi32(lo[v], r[v]);
+        hi[v] = _mm256_max_epi32(lo[v], r[v]);
+        lo[v] = mn;
+    }
+    if (Vectors == 2)
+    {
+        __m256i mn = _mm256_min_epi32(lo[0], lo[1]);
+        lo[1] = _mm256_max_epi32(lo[0], lo[1]);
+        lo[0] = mn;
+        mn = _mm256_min_epi32(hi[0], hi[1]);
+        hi[1] = _mm256_max_epi32(hi[0], hi[1]);
+        hi[0] = mn;
+    }
+    for (int v = 0; v < Vectors; ++v)
+    {
+        lo[v] = bitonicClean8(lo[v]);
+        hi[v] = bitonicClean8(hi[v]);
+    }
+}
+
+template <int Vectors>
+SORT_TARGET_AVX2 void mergeBitonic(const int *a, std::size_t na, const int *b, std::size_t nb, int *out)
+{
+    constexpr std::size_t W = 8 * Vectors;
+    if (na < W || nb < W)
+    {
+        mergeScalar(a, na, b, nb, out);
+        return;
+    }
+
+    __m256i lo[Vectors], hi[Vectors];
+    for (int v = 0; v < Vectors; ++v)
+    {
+        lo[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a) + v);
+        hi[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b) + v);
+    }
+    std::size_t ia = W, ib = W;
+    while (true)
+    {
+        bitonicMerge<Vectors>(lo, hi);
+        for (int v = 0; v < Vectors; ++v)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out) + v, lo[v]);
+        }
+        out += W;
+
+        // The next block comes from the side with the smaller head, and only
+        // while that side still has a whole block
+        bool takeA = ia < na && (ib == nb || a[ia] <= b[ib]);
+        const int *next = takeA ? a + ia : b + ib;
+        if ((takeA ? na - ia : nb - ib) < W)
+        {
+            break;
+        }
+        for (int v = 0; v < Vectors; ++v)
+        {
+            lo[v] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(next) + v);
+        }
+        (takeA ? ia : ib) += W;
+    }
+
+    alignas(32) int held[W];
+    for (int v = 0; v < Vectors; ++v)
+    {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(held) + v, hi[v]);
+    }
+    mergeTail(held, W, a + ia, na - ia, b + ib, nb - ib, out);
+}
+
+#endif
+
+} // namespace
+
+void mergeSorted(const int *a, std::size_t na, const int *b, std::size_t nb, int *out, MergeKernel kernel)
+{
+#if SORT_HAVE_X86
+    if (kernel != MergeKernel::Scalar && cpuHasAvx2())
+    {
+        if (kernel == MergeKernel::Bitonic16)
+        {
+            mergeBitonic<2>(a, na, b, nb, out);
+        }
+        else
+        {
+            mergeBitonic<1>(a, na, b, nb, out);
+        }
+        return;
+    }
+#endif
+    mergeScalar(a, na, b, nb, out);
+}
@@ -0,0 +1,22 @@
+#ifndef BITONICMERGE_H
+#define BITONICMERGE_H
+
+#include <cstddef>
+
+enum class MergeKernel
+{
+    Scalar,     // One comparison per output element
+    Bitonic8,   // AVX2: 8 outputs per bitonic merge network
+    Bitonic16,  // AVX2: 16 outputs per step, two registers per side
+};
+
+const char *mergeKernelName(MergeKernel kernel);
+
+// Merges sorted a[0, na) and b[0, nb) into out, which must not overlap
+// either input. The bitonic kernels keep the larger half of each step in
+// registers and load the next block from whichever input has the smaller
+// head; they fall back to Scalar without AVX2 or for runs shorter than a
+// block. Not stable, which makes no difference for ints.
+void mergeSorted(const int *a, std::size_t na, const int *b, std::size_t nb, int *out, MergeKernel kernel);
+
+#endif // BITONICMERGE_H
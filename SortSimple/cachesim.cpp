@@ -0,0 +1,126 @@
+#include "cachesim.h"
+#include <algorithm>
+
+namespace {
+
+constexpr std::uint64_t kEmpty = ~std::uint64_t(0);
+constexpr std::uint64_t kPageBytes = 4096;
+
+unsigned log2Floor(std::size_t value)
+{
+    unsigned bits = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+} // namespace
+
+CacheConfig CacheConfig::desktop()
+{
+    return {{{"L1", 32 << 10, 8, 64}, {"L2", 1 << 20, 16, 64}, {"LLC", 16 << 20, 16, 64}}};
+}
+
+CacheConfig CacheConfig::teaching()
+{
+    return {{{"L1", 16, 2, 8}, {"L2", 32, 2, 8}, {"LLC", 64, 4, 8}}};
+}
+
+CacheSimulator::CacheSimulator(const CacheConfig &config, std::size_t elements, std::size_t elementBytes)
+    : accessesAt(elements, 0),
+    missesAt(elements, 0),
+    elementBytes(elementBytes)
+{
+    for (const CacheLevelConfig &c : config.levels)
+    {
+        Level level;
+        level.ways = std::max(1u, c.ways);
+        level.lineShift = log2Floor(std::max(1u, c.lineBytes));
+        // Round the set count down to a power of two so the index is a mask
+        std::size_t sets = std::max<std::size_t>(1, c.sizeBytes >> level.lineShift) / level.ways;
+        sets = std::size_t(1) << log2Floor(std::max<std::size_t>(1, sets));
+        level.setMask = sets - 1;
+        level.tags.assign(sets * level.ways, kEmpty);
+        levels.push_back(std::move(level));
+
+        CacheLevelStats stats;
+        stats.name = c.name;
+        levelStats.push_back(stats);
+    }
+    bufferBase[0] = 0;
+    bufferBase[1] = (elements * elementBytes + kPageBytes - 1) / kPageBytes * kPageBytes;
+}
+
+bool CacheSimulator::lookup(Level &level, std::uint64_t address)
+{
+    std::uint64_t line = address >> level.lineShift;
+    std::uint64_t *set = level.tags.data() + (line & level.setMask) * level.ways;
+    if (set[0] == line)
+    {
+        return true; // Neighbouring indices mostly share the most recent line
+    }
+    unsigned way = 1;
+    while (way < level.ways && set[way] != line)
+    {
+        ++way;
+    }
+    bool hit = way < level.ways;
+    if (!hit)
+    {
+        way = level.ways - 1; // Evict the least recently used line
+    }
+    // Move to the front, keeping the others in recency order
+    for (; way > 0; --way)
+    {
+        set[way] = set[way - 1];
+    }
+    set[0] = line;
+    return hit;
+}
+
+void CacheSimulator::access(std::int32_t index, int buffer)
+{
+    std::uint64_t address = bufferBase[buffer & 1] + std::uint64_t(index) * elementBytes;
+    bool missedFirst = false;
+    for (std::size_t l = 0; l < levels.size(); ++l)
+    {
+        ++levelStats[l].accesses;
+        if (lookup(levels[l], address))
+        {
+            break;
+        }
+        ++levelStats[l].misses;
+        missedFirst = missedFirst || l == 0;
+    }
+    if (index >= 0 && std::size_t(index) < accessesAt.size())
+    {
+        ++accessesAt[index];
+        missesAt[index] += missedFirst;
+    }
+}
+
+void CacheSimulator::consume(const TraceEvent *batch, std::size_t count)
+{
+    events += count;
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        const TraceEvent &e = batch[k];
+        switch (e.type)
+        {
+        case TraceEvent::Read:
+        case TraceEvent::Write:
+            access(e.i, e.buffer);
+            break;
+        case TraceEvent::Compare:
+        case TraceEvent::Swap:
+            access(e.i, e.buffer);
+            access(e.j, e.buffer);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include "sorttrace.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CacheLevelConfig
+{
+    std::string name;
+    std::size_t sizeBytes;
+    unsigned ways;
+    unsigned lineBytes;  // Power of two
+};
+
+struct CacheConfig
+{
+    std::vector<CacheLevelConfig> levels;  // Closest to the core first
+
+    // 32 KiB 8-way L1, 1 MiB 16-way L2, 16 MiB 16-way LLC, 64-byte lines
+    static CacheConfig desktop();
+    // Caches a few ints wide, so even the eight-bar demo shows evictions
+    static CacheConfig teaching();
+};
+
+struct CacheLevelStats
+{
+    std::string name;
+    std::uint64_t accesses = 0;
+    std::uint64_t misses = 0;
+
+    double missRate() const { return accesses ? double(misses) / accesses : 0.0; }
+};
+
+// Replays trace events as memory accesses through an LRU set-associative
+// hierarchy; a level is only consulted when every level above it missed.
+// Buffer 0 starts at address 0 and buffer 1 on the next page after it. Each
+// event touches the lines of its indices once (a swap is two accesses).
+class CacheSimulator : public TraceSink
+{
+public:
+    CacheSimulator(const CacheConfig &config, std::size_t elements, std::size_t elementBytes);
+
+    void consume(const TraceEvent *events, std::size_t count) override;
+    void consume(const SortTrace &trace) { consume(trace.events().data(), trace.size()); }
+
+    const std::vector<CacheLevelStats> &stats() const { return levelStats; }
+    std::uint64_t eventCount() const { return events; }
+
+    // Per array position: accesses, and accesses that missed the first level.
+    // Buffer 1 positions count toward the array position they stand in for.
+    const std::vector<std::uint32_t> &accessCounts() const { return accessesAt; }
+    const std::vector<std::uint32_t> &missCounts() const { return missesAt; }
+
+private:
+    struct Level
+    {
+        std::size_t setMask;
+        unsigned ways;
+        unsigned lineShift;
+        std::vector<std::uint64_t> tags;  // ways per set, most recently used first
+    };
+
+    void access(std::int32_t index, int buffer);
+    static bool lookup(Level &level, std::uint64_t address);
+
+    std::vector<Level> levels;
+    std::vector<CacheLevelStats> levelStats;
+    std::vector<std::uint32_t> accessesAt;
+    std::vector<std::uint32_t> missesAt;
+    std::size_t elementBytes;
+    std::uint64_t bufferBase[2];
+    std::uint64_t events = 0;
+};
+
+#endif // CACHESIM_H
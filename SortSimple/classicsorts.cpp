@@ -0,0 +1,135 @@
+#include "classicsorts.h"
+#include <utility>
+
+template <typename Trace>
+void insertionSort(int *a, std::size_t n, Trace &trace)
+{
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        int key = a[i];
+        std::size_t j = i;
+        while (j > 0)
+        {
+            trace.compare(j - 1, j);
+            if (a[j - 1] <= key)
+            {
+                break;
+            }
+            a[j] = a[j - 1];
+            trace.write(j, a[j]);
+            --j;
+        }
+        a[j] = key;
+        trace.write(j, key);
+    }
+}
+
+template <typename Trace>
+void bubbleSort(int *a, std::size_t n, Trace &trace)
+{
+    for (std::size_t end = n; end > 1; --end)
+    {
+        bool swapped = false;
+        for (std::size_t j = 0; j + 1 < end; ++j)
+        {
+            trace.compare(j, j + 1);
+            if (a[j] > a[j + 1])
+            {
+                std::swap(a[j], a[j + 1]);
+                trace.swap(j, j + 1);
+                swapped = true;
+            }
+        }
+        if (!swapped)
+        {
+            return;
+        }
+    }
+}
+
+template <typename Trace>
+void selectionSort(int *a, std::size_t n, Trace &trace)
+{
+    for (std::size_t i = 0; i + 1 < n; ++i)
+    {
+        std::size_t minIndex = i;
+        for (std::size_t j = i + 1; j < n; ++j)
+        {
+            trace.compare(j, minIndex);
+            if (a[j] < a[minIndex])
+            {
+                minIndex = j;
+            }
+        }
+        if (minIndex != i)
+        {
+            std::swap(a[i], a[minIndex]);
+            trace.swap(i, minIndex);
+        }
+    }
+}
+
+namespace {
+
+// Sorts a[first, last) with absolute indices so the trace lines up
+template <typename Trace>
+void lomutoRange(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    while (last - first > 1)
+    {
+        std::size_t pivot = last - 1;
+        trace.mark(TagPivot, pivot, pivot);
+        std::size_t store = first;
+        for (std::size_t j = first; j < pivot; ++j)
+        {
+            trace.compare(j, pivot);
+            if (a[j] <= a[pivot])
+            {
+                std::swap(a[store], a[j]);
+                trace.swap(store, j);
+                ++store;
+            }
+        }
+        std::swap(a[store], a[pivot]);
+        trace.swap(store, pivot);
+
+        // Recurse into the smaller side and loop on the larger one
+        if (store - first < last - store - 1)
+        {
+            lomutoRange(a, first, store, trace);
+            first = store + 1;
+        }
+        else
+        {
+            lomutoRange(a, store + 1, last, trace);
+            last = store;
+        }
+    }
+}
+
+} // namespace
+
+template <typename Trace>
+void lomutoQuicksort(int *a, std::size_t n, Trace &trace)
+{
+    lomutoRange(a, 0, n, trace);
+}
+
+void insertionSort(int *a, std::size_t n)
+{
+    NullTrace trace;
+    insertionSort(a, n, trace);
+}
+
+template void insertionSort<SortTrace>(int *, std::size_t, SortTrace &);
+template void insertionSort<NullTrace>(int *, std::size_t, NullTrace &);
+template void insertionSort<StreamingTrace>(int *, std::size_t, StreamingTrace &);
+template void bubbleSort<SortTrace>(int *, std::size_t, SortTrace &);
+template void bubbleSort<NullTrace>(int *, std::size_t, NullTrace &);
+template void bubbleSort<StreamingTrace>(int *, std::size_t, StreamingTrace &);
+template void selectionSort<SortTrace>(int *, std::size_t, SortTrace &);
+template void selectionSort<NullTrace>(int *, std::size_t, NullTrace &);
+template void selectionSort<StreamingTrace>(int *, std::size_t, StreamingTrace &);
+template void lomutoQuicksort<SortTrace>(int *, std::size_t, SortTrace &);
+template void lomutoQuicksort<NullTrace>(int *, std::size_t, NullTrace &);
+template void lomutoQuicksort<StreamingTrace>(int *, std::size_t, StreamingTrace &);
@@ -0,0 +1,24 @@
+#ifndef CLASSICSORTS_H
+#define CLASSICSORTS_H
+
+#include "sorttrace.h"
+#include <cstddef>
+
+// Textbook kernels, kept for small inputs and as baselines for the faster ones
+
+template <typename Trace>
+void insertionSort(int *a, std::size_t n, Trace &trace);
+void insertionSort(int *a, std::size_t n);
+
+// Stops after the first pass without a swap
+template <typename Trace>
+void bubbleSort(int *a, std::size_t n, Trace &trace);
+
+template <typename Trace>
+void selectionSort(int *a, std::size_t n, Trace &trace);
+
+// Last element as pivot, Lomuto partition; recurses into the smaller side
+template <typename Trace>
+void lomutoQuicksort(int *a, std::size_t n, Trace &trace);
+
+#endif // CLASSICSORTS_H
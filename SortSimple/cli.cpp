@@ -0,0 +1,801 @@
+// Command-line front end for sorting real data with the engine kernels.
+//
+//   SortSimpleCli sort [--binary] [--threads N] [--algo NAME] [--output FILE] INPUT
+//   SortSimpleCli batch --length L [--lanes 8|16] [--binary] [--threads N] [--output FILE] INPUT
+//   SortSimpleCli topk --k K [--mode quick|heap|stream] [--binary] [--output FILE] INPUT
+//   SortSimpleCli stream [--batch B] [--fanout F] [--follow] [--rank V] [--select K] [--range LO:HI]
+//                        [--binary] [--output FILE] INPUT
+//   SortSimpleCli csv --key SPEC [--key SPEC ...] [--delimiter C] [--header] [--threads N] [--output FILE] INPUT
+//   SortSimpleCli cluster [--processes P] [--algo NAME] [--binary] [--output FILE] INPUT
+//   SortSimpleCli autotune [--size N] [--output FILE]
+//
+// Text input holds integers separated by newlines or commas; --binary input
+// is raw native-endian 32-bit integers. --algo is auto (the default: measure
+// the input and pick), insertion, merge, radix, counting, bucket, quick,
+// quick3 (three-way partitioning), heap (4-ary) or std. `batch` treats the input as
+// consecutive arrays of L values and sorts each one on its own. `topk`
+// writes the K smallest values in order: quick partially sorts with
+// quicksort, heap keeps a bounded heap, and stream reads INPUT (- for stdin)
+// in pieces through a heap of K values, so the input never has to fit in
+// memory. `stream` keeps a sorted view of INPUT (- for stdin) while it is
+// read, in runs of B values merged F at a time in the background, and
+// reports the ingest rate and the answers to the queries about once a
+// second; at the end of the input it writes everything in order. With
+// --follow, INPUT is a file still being appended to: at its end the reader
+// waits for more instead of stopping, and only the reports are written.
+// `csv` sorts the rows of a CSV file like sort -k: each SPEC is a column
+// counted from 1, then n (numeric) or d (date), then r for descending, and
+// for string columns optionally :WIDTH, the bytes kept in the key.
+// `cluster` sample sorts across P worker processes that exchange their
+// elements through shared memory, each sorting its part with --algo
+// (radix unless given; not counting or bucket, which start threads), and
+// reports the time spent in each phase.
+// `autotune` times the kernel parameters on N random values (4M unless
+// given) and saves the fastest to FILE, by default the file the engine
+// reads them from at startup, then reports each kernel's speedup over the
+// defaults.
+// Timings go to stderr.
+#include "batchsort.h"
+#include "clustersort.h"
+#include "csvsort.h"
+#include "inputloader.h"
+#include "inputprofile.h"
+#include "quicksort.h"
+#include "streamsort.h"
+#include "topk.h"
+#include "tuning.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: SortSimpleCli sort [--binary] [--threads N] [--algo NAME] [--output FILE] INPUT\n"
+                 "       NAME is auto, insertion, merge, radix, counting, bucket, quick, quick3, heap or std\n"
+                 "       SortSimpleCli batch --length L [--lanes 8|16] [--binary] [--threads N] [--output FILE] INPUT\n"
+                 "       SortSimpleCli topk --k K [--mode quick|heap|stream] [--binary] [--output FILE] INPUT\n"
+                 "       SortSimpleCli stream [--batch B] [--fanout F] [--follow] [--rank V] [--select K] [--range LO:HI]\n"
+                 "                            [--binary] [--output FILE] INPUT\n"
+                 "       SortSimpleCli csv --key SPEC [--key SPEC ...] [--delimiter C] [--header] [--threads N]\n"
+                 "                         [--output FILE] INPUT\n"
+                 "       SPEC is COLUMN[n|d][r][:WIDTH], as in 2nr or 1:32\n"
+                 "       SortSimpleCli cluster [--processes P] [--algo NAME] [--binary] [--output FILE] INPUT\n"
+                 "       SortSimpleCli autotune [--size N] [--output FILE]\n");
+}
+
+struct Options
+{
+    bool binary = false;
+    unsigned threads = 0;
+    std::string algorithm = "auto";
+    std::size_t length = 0;  // batch: values per array
+    std::size_t lanes = 16;  // batch: arrays sorted together
+    std::size_t k = 0;       // topk: values kept
+    std::string mode = "quick";
+    std::size_t batch = StreamingSortOptions().batchSize;  // stream: values per run
+    unsigned fanout = StreamingSortOptions().fanout;       // stream: runs merged at a time
+    bool follow = false;                                  // stream: wait at the end of INPUT for more
+    std::vector<std::int32_t> ranks;                      // stream: queries
+    std::vector<std::uint64_t> selects;
+    std::vector<std::pair<std::int32_t, std::int32_t>> ranges;
+    std::vector<CsvKeyColumn> csvKeys;                    // csv: most significant first
+    char delimiter = ',';
+    bool header = false;
+    unsigned processes = ClusterSortOptions().processes;  // cluster: worker processes
+    std::size_t size = std::size_t(1) << 22;              // autotune: values timed
+    std::string input;
+    std::string output;
+};
+
+bool parseOptions(int argc, char *argv[], int first, Options &options, bool needsInput = true)
+{
+    for (int a = first; a < argc; ++a)
+    {
+        if (std::strcmp(argv[a], "--binary") == 0)
+        {
+            options.binary = true;
+        }
+        else if (std::strcmp(argv[a], "--threads") == 0 && a + 1 < argc)
+        {
+            options.threads = static_cast<unsigned>(std::atoi(argv[++a]));
+        }
+        else if (std::strcmp(argv[a], "--algo") == 0 && a + 1 < argc)
+        {
+            options.algorithm = argv[++a];
+        }
+        else if (std::strcmp(argv[a], "--length") == 0 && a + 1 < argc)
+        {
+            options.length = static_cast<std::size_t>(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--lanes") == 0 && a + 1 < argc)
+        {
+            options.lanes = static_cast<std::size_t>(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--k") == 0 && a + 1 < argc)
+        {
+            options.k = static_cast<std::size_t>(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--mode") == 0 && a + 1 < argc)
+        {
+            options.mode = argv[++a];
+        }
+        else if (std::strcmp(argv[a], "--batch") == 0 && a + 1 < argc)
+        {
+            options.batch = static_cast<std::size_t>(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--fanout") == 0 && a + 1 < argc)
+        {
+            options.fanout = static_cast<unsigned>(std::atoi(argv[++a]));
+        }
+        else if (std::strcmp(argv[a], "--follow") == 0)
+        {
+            options.follow = true;
+        }
+        else if (std::strcmp(argv[a], "--rank") == 0 && a + 1 < argc)
+        {
+            options.ranks.push_back(static_cast<std::int32_t>(std::atoi(argv[++a])));
+        }
+        else if (std::strcmp(argv[a], "--select") == 0 && a + 1 < argc)
+        {
+            options.selects.push_back(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--range") == 0 && a + 1 < argc)
+        {
+            const char *text = argv[++a];
+            const char *colon = std::strchr(text, ':');
+            if (!colon)
+            {
+                return false;
+            }
+            options.ranges.push_back({static_cast<std::int32_t>(std::atoi(text)),
+                                      static_cast<std::int32_t>(std::atoi(colon + 1))});
+        }
+        else if (std::strcmp(argv[a], "--key") == 0 && a + 1 < argc)
+        {
+            CsvKeyColumn key;
+            if (!parseCsvKey(argv[++a], key))
+            {
+                return false;
+            }
+            options.csvKeys.push_back(key);
+        }
+        else if (std::strcmp(argv[a], "--delimiter") == 0 && a + 1 < argc)
+        {
+            const char *text = argv[++a];
+            options.delimiter = std::strcmp(text, "tab") == 0 || std::strcmp(text, "\\t") == 0 ? '\t' : text[0];
+        }
+        else if (std::strcmp(argv[a], "--header") == 0)
+        {
+            options.header = true;
+        }
+        else if (std::strcmp(argv[a], "--processes") == 0 && a + 1 < argc)
+        {
+            options.processes = static_cast<unsigned>(std::atoi(argv[++a]));
+        }
+        else if (std::strcmp(argv[a], "--size") == 0 && a + 1 < argc)
+        {
+            options.size = static_cast<std::size_t>(std::strtoull(argv[++a], nullptr, 10));
+        }
+        else if (std::strcmp(argv[a], "--output") == 0 && a + 1 < argc)
+        {
+            options.output = argv[++a];
+        }
+        else if (argv[a][0] == '-' && argv[a][1] != '\0')
+        {
+            return false;
+        }
+        else
+        {
+            options.input = argv[a];
+        }
+    }
+    return needsInput != options.input.empty();
+}
+
+bool kernelFromName(const std::string &name, SortKernel &kernel)
+{
+    static const std::pair<const char *, SortKernel> names[] = {
+        {"insertion", SortKernel::Insertion},
+        {"merge", SortKernel::BottomUpMerge},
+        {"radix", SortKernel::LsdRadix},
+        {"counting", SortKernel::CountingSort},
+        {"bucket", SortKernel::BucketSort},
+        {"quick", SortKernel::BlockQuicksort},
+        {"quick3", SortKernel::ThreeWayQuicksort},
+        {"heap", SortKernel::HeapSort},
+        {"std", SortKernel::StdSort},
+    };
+    for (const auto &entry : names)
+    {
+        if (name == entry.first)
+        {
+            kernel = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One value per line through a single large buffer
+bool writeValues(const std::string &path, const std::int32_t *values, std::size_t n, bool binary)
+{
+    std::FILE *out = path.empty() ? stdout : std::fopen(path.c_str(), binary ? "wb" : "w");
+    if (!out)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    if (binary)
+    {
+        std::fwrite(values, sizeof(std::int32_t), n, out);
+    }
+    else
+    {
+        std::vector<char> buffer(1 << 20);
+        std::size_t used = 0;
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            if (used + 16 > buffer.size())
+            {
+                std::fwrite(buffer.data(), 1, used, out);
+                used = 0;
+            }
+            used += static_cast<std::size_t>(std::snprintf(buffer.data() + used, 16, "%d\n", values[k]));
+        }
+        std::fwrite(buffer.data(), 1, used, out);
+    }
+    bool ok = std::ferror(out) == 0;
+    if (out != stdout)
+    {
+        ok = std::fclose(out) == 0 && ok;
+    }
+    if (!ok)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+    }
+    return ok;
+}
+
+// Input values, either parsed into `parsed` or mapped through `mapped`
+struct LoadedValues
+{
+    std::vector<std::int32_t> parsed;
+    BinaryIntegerFile mapped;
+    std::int32_t *values = nullptr;
+    std::size_t n = 0;
+};
+
+bool loadValues(const Options &options, LoadedValues &loaded)
+{
+    if (options.binary)
+    {
+        if (!loaded.mapped.open(options.input))
+        {
+            std::fprintf(stderr, "%s\n", loaded.mapped.errorString().c_str());
+            return false;
+        }
+        loaded.values = loaded.mapped.data();
+        loaded.n = loaded.mapped.size();
+        return true;
+    }
+    std::string error;
+    if (!loadTextIntegers(options.input, loaded.parsed, &error, options.threads))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    loaded.values = loaded.parsed.data();
+    loaded.n = loaded.parsed.size();
+    return true;
+}
+
+int runSort(const Options &options)
+{
+    auto start = Clock::now();
+    LoadedValues loaded;
+    if (!loadValues(options, loaded))
+    {
+        return 1;
+    }
+    std::int32_t *values = loaded.values;
+    std::size_t n = loaded.n;
+    double loadMs = msSince(start);
+
+    SortKernel kernel = SortKernel::StdSort;
+    double profileMs = 0;
+    if (options.algorithm == "auto")
+    {
+        start = Clock::now();
+        KernelChoice choice = recommendKernel(profileInput(values, n, options.threads));
+        profileMs = msSince(start);
+        kernel = choice.kernel;
+        std::fprintf(stderr, "auto: %s. %s\n", kernelName(kernel), choice.reason.c_str());
+    }
+    else if (!kernelFromName(options.algorithm, kernel))
+    {
+        usage();
+        return 2;
+    }
+
+    start = Clock::now();
+    runKernel(kernel, values, n);
+    double sortMs = msSince(start);
+
+    start = Clock::now();
+    if (!writeValues(options.output, values, n, options.binary))
+    {
+        return 1;
+    }
+    double writeMs = msSince(start);
+
+    std::fprintf(stderr, "%zu values: load %.1f ms, profile %.1f ms, sort %.1f ms, write %.1f ms\n", n, loadMs,
+                 profileMs, sortMs, writeMs);
+    return 0;
+}
+
+int runBatch(const Options &options)
+{
+    if (options.length == 0)
+    {
+        usage();
+        return 2;
+    }
+    auto start = Clock::now();
+    LoadedValues loaded;
+    if (!loadValues(options, loaded))
+    {
+        return 1;
+    }
+    double loadMs = msSince(start);
+    if (loaded.n % options.length != 0)
+    {
+        std::fprintf(stderr, "%zu values do not split into arrays of %zu\n", loaded.n, options.length);
+        return 1;
+    }
+
+    std::size_t count = loaded.n / options.length;
+    start = Clock::now();
+    sortBatch(loaded.values, count, options.length, options.lanes);
+    double sortMs = msSince(start);
+
+    start = Clock::now();
+    if (!writeValues(options.output, loaded.values, loaded.n, options.binary))
+    {
+        return 1;
+    }
+    double writeMs = msSince(start);
+
+    std::fprintf(stderr, "%zu arrays of %zu (%s): load %.1f ms, sort %.1f ms, write %.1f ms\n", count,
+                 options.length, batchSortIsa(), loadMs, sortMs, writeMs);
+    return 0;
+}
+
+// Feeds INPUT to `consume(values, count)` in pieces of about 4 MB. Text
+// pieces end after the last separator; the token after it is carried into
+// the next piece. With --follow the end of the input is waited out: consume
+// is called with no values every 100 ms until more arrives.
+template <typename Consume>
+bool streamValues(const Options &options, Consume consume)
+{
+    bool useStdin = options.input == "-";
+    std::FILE *in = useStdin ? stdin : std::fopen(options.input.c_str(), "rb");
+    if (!in)
+    {
+        std::fprintf(stderr, "cannot open %s\n", options.input.c_str());
+        return false;
+    }
+    constexpr std::size_t kPiece = std::size_t(1) << 22;
+    std::vector<char> buffer(kPiece);
+    std::vector<std::int32_t> values;
+    std::size_t carried = 0;
+    std::uint64_t line = 1;  // Of the first byte in the buffer
+    bool ok = true;
+    while (true)
+    {
+        std::size_t got = std::fread(buffer.data() + carried, 1, buffer.size() - carried, in);
+        std::size_t size = carried + got;
+        if (got == 0 && options.follow)
+        {
+            consume(values.data(), 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::clearerr(in);
+            continue;
+        }
+        bool last = got == 0;
+        std::size_t end = size;
+        if (options.binary)
+        {
+            end = size / sizeof(std::int32_t) * sizeof(std::int32_t);
+            values.resize(end / sizeof(std::int32_t));
+            std::memcpy(values.data(), buffer.data(), end);
+        }
+        else
+        {
+            // A token cut off at the end of the piece waits for the rest
+            while (!last && end > 0 && !isIntegerSeparator(buffer[end - 1]))
+            {
+                --end;
+            }
+            if (end == 0 && size == buffer.size())
+            {
+                std::fprintf(stderr, "%s: no separator in %zu bytes\n", options.input.c_str(), size);
+                ok = false;
+                break;
+            }
+            std::string error;
+            if (!parseTextIntegers(buffer.data(), end, values, &error, 1, line))
+            {
+                std::fprintf(stderr, "%s: %s\n", options.input.c_str(), error.c_str());
+                ok = false;
+                break;
+            }
+            line += static_cast<std::uint64_t>(std::count(buffer.data(), buffer.data() + end, '\n'));
+        }
+        consume(values.data(), values.size());
+        carried = size - end;
+        std::memmove(buffer.data(), buffer.data() + end, carried);
+        if (last)
+        {
+            break;
+        }
+    }
+    if (!useStdin)
+    {
+        std::fclose(in);
+    }
+    return ok;
+}
+
+int runTopK(const Options &options)
+{
+    if (options.k == 0 || (options.mode != "quick" && options.mode != "heap" && options.mode != "stream"))
+    {
+        usage();
+        return 2;
+    }
+    auto start = Clock::now();
+    std::vector<std::int32_t> result;
+    if (options.mode == "stream")
+    {
+        StreamingTopK top(options.k);
+        if (!streamValues(options, [&](const std::int32_t *values, std::size_t count) { top.push(values, count); }))
+        {
+            return 1;
+        }
+        result = top.sorted();
+        std::fprintf(stderr, "%llu values streamed, %llu entered the heap: %.1f ms\n",
+                     static_cast<unsigned long long>(top.seen()), static_cast<unsigned long long>(top.replacements()),
+                     msSince(start));
+    }
+    else
+    {
+        LoadedValues loaded;
+        if (!loadValues(options, loaded))
+        {
+            return 1;
+        }
+        double loadMs = msSince(start);
+        start = Clock::now();
+        NullTrace none;
+        if (options.mode == "quick")
+        {
+            partialQuicksort(loaded.values, loaded.n, options.k, none);
+        }
+        else
+        {
+            heapPartialSort(loaded.values, loaded.n, options.k, none);
+        }
+        result.assign(loaded.values, loaded.values + std::min(options.k, loaded.n));
+        std::fprintf(stderr, "%zu values: load %.1f ms, select %.1f ms\n", loaded.n, loadMs, msSince(start));
+    }
+    return writeValues(options.output, result.data(), result.size(), options.binary) ? 0 : 1;
+}
+
+// One status line: ingest so far, the runs by tier, and the query answers
+void reportStream(const Options &options, const StreamingSort &sorter, double ms)
+{
+    StreamingSortStats stats = sorter.stats();
+    std::string tiers;
+    for (const StreamingRun &run : sorter.runs())
+    {
+        tiers += std::to_string(run.tier) + (run.compacting ? "*" : "") + " ";
+    }
+    std::fprintf(stderr, "%.1f s: %llu values, %.2f M/s, %llu compactions, write amplification %.2f, runs by tier [ %s]\n",
+                 ms / 1000, static_cast<unsigned long long>(stats.values), stats.values / ms / 1e3,
+                 static_cast<unsigned long long>(stats.compactions),
+                 stats.values ? double(stats.mergedValues) / stats.values : 0.0, tiers.c_str());
+    for (std::int32_t value : options.ranks)
+    {
+        std::fprintf(stderr, "  rank(%d) = %llu\n", value, static_cast<unsigned long long>(sorter.rank(value)));
+    }
+    for (std::uint64_t k : options.selects)
+    {
+        std::int32_t value;
+        if (sorter.select(k, value))
+        {
+            std::fprintf(stderr, "  select(%llu) = %d\n", static_cast<unsigned long long>(k), value);
+        }
+        else
+        {
+            std::fprintf(stderr, "  select(%llu): only %llu values\n", static_cast<unsigned long long>(k),
+                         static_cast<unsigned long long>(sorter.size()));
+        }
+    }
+    for (const auto &range : options.ranges)
+    {
+        std::vector<std::int32_t> values = sorter.range(range.first, range.second);
+        std::fprintf(stderr, "  range(%d:%d): %zu values", range.first, range.second, values.size());
+        for (std::size_t k = 0; k < std::min<std::size_t>(values.size(), 8); ++k)
+        {
+            std::fprintf(stderr, " %d", values[k]);
+        }
+        std::fprintf(stderr, values.size() > 8 ? " ...\n" : "\n");
+    }
+}
+
+int runStream(const Options &options)
+{
+    if (options.batch == 0 || options.fanout < 2)
+    {
+        usage();
+        return 2;
+    }
+    StreamingSortOptions sortOptions;
+    sortOptions.batchSize = options.batch;
+    sortOptions.fanout = options.fanout;
+    StreamingSort sorter(sortOptions);
+    auto start = Clock::now();
+    double reported = 0;
+    bool ok = streamValues(options, [&](const std::int32_t *values, std::size_t count) {
+        sorter.push(values, count);
+        double ms = msSince(start);
+        if (ms - reported >= 1000)
+        {
+            reportStream(options, sorter, ms);
+            reported = ms;
+        }
+    });
+    if (!ok)
+    {
+        return 1;
+    }
+    double ingestMs = msSince(start);
+    reportStream(options, sorter, ingestMs);
+
+    start = Clock::now();
+    std::vector<std::int32_t> result = sorter.sorted();
+    double viewMs = msSince(start);
+    start = Clock::now();
+    if (!writeValues(options.output, result.data(), result.size(), options.binary))
+    {
+        return 1;
+    }
+    std::fprintf(stderr, "%zu values: ingest %.1f ms, sorted view %.1f ms, write %.1f ms\n", result.size(), ingestMs,
+                 viewMs, msSince(start));
+    return 0;
+}
+
+// Copies the rows to the output in `order`, each through one large buffer
+// straight from the mapping, adding a line break where the last row had none
+bool writeRows(const std::string &path, const char *text, const std::vector<std::uint64_t> &starts,
+               const std::vector<std::uint32_t> &order)
+{
+    std::FILE *out = path.empty() ? stdout : std::fopen(path.c_str(), "wb");
+    if (!out)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    std::vector<char> buffer(1 << 22);
+    std::size_t used = 0;
+    for (std::uint32_t row : order)
+    {
+        const char *from = text + starts[row];
+        std::size_t size = static_cast<std::size_t>(starts[row + 1] - starts[row]);
+        if (used + size + 1 > buffer.size())
+        {
+            std::fwrite(buffer.data(), 1, used, out);
+            used = 0;
+            if (size + 1 > buffer.size())
+            {
+                buffer.resize(size + 1);
+            }
+        }
+        std::memcpy(buffer.data() + used, from, size);
+        used += size;
+        if (size == 0 || from[size - 1] != '\n')
+        {
+            buffer[used++] = '\n';
+        }
+    }
+    std::fwrite(buffer.data(), 1, used, out);
+    bool ok = std::ferror(out) == 0;
+    if (out != stdout)
+    {
+        ok = std::fclose(out) == 0 && ok;
+    }
+    if (!ok)
+    {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+    }
+    return ok;
+}
+
+int runCsv(const Options &options)
+{
+    if (options.csvKeys.empty())
+    {
+        usage();
+        return 2;
+    }
+    auto start = Clock::now();
+    MappedFile file;
+    if (!file.open(options.input))
+    {
+        std::fprintf(stderr, "%s\n", file.errorString().c_str());
+        return 1;
+    }
+    std::vector<std::uint64_t> starts = csvRowStarts(file.data(), file.size(), options.threads);
+    double scanMs = msSince(start);
+
+    start = Clock::now();
+    CsvSortOptions sortOptions;
+    sortOptions.keys = options.csvKeys;
+    sortOptions.delimiter = options.delimiter;
+    sortOptions.header = options.header;
+    sortOptions.threads = options.threads;
+    std::vector<std::uint32_t> order;
+    std::string error;
+    if (!sortCsvRows(file.data(), starts, sortOptions, order, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double sortMs = msSince(start);
+
+    start = Clock::now();
+    if (!writeRows(options.output, file.data(), starts, order))
+    {
+        return 1;
+    }
+    double writeMs = msSince(start);
+
+    double mb = file.size() / 1e6;
+    std::fprintf(stderr, "%zu rows, %.1f MB: map and split %.1f ms, keys and sort %.1f ms, write %.1f ms (%.0f MB/s)\n",
+                 order.size(), mb, scanMs, sortMs, writeMs, mb / ((scanMs + sortMs + writeMs) / 1e3));
+    return 0;
+}
+
+int runCluster(const Options &options)
+{
+    ClusterSortOptions clusterOptions;
+    clusterOptions.processes = options.processes;
+    if (options.algorithm != "auto" && !kernelFromName(options.algorithm, clusterOptions.localKernel))
+    {
+        usage();
+        return 2;
+    }
+
+    auto start = Clock::now();
+    LoadedValues loaded;
+    if (!loadValues(options, loaded))
+    {
+        return 1;
+    }
+    double loadMs = msSince(start);
+
+    start = Clock::now();
+    ClusterSortStats stats;
+    std::string error;
+    if (!clusterSort(loaded.values, loaded.n, clusterOptions, &stats, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double totalMs = msSince(start);
+
+    start = Clock::now();
+    if (!writeValues(options.output, loaded.values, loaded.n, options.binary))
+    {
+        return 1;
+    }
+    double writeMs = msSince(start);
+
+    std::fprintf(stderr,
+                 "%zu values on %u processes (%s): load %.1f ms, launch %.1f ms, sampling %.1f ms, exchange %.1f ms, "
+                 "local sort %.1f ms, output %.1f ms (%.1f ms in all), write %.1f ms\n",
+                 loaded.n, clusterOptions.processes, kernelName(clusterOptions.localKernel), loadMs, stats.launchMs,
+                 stats.samplingMs, stats.exchangeMs, stats.localSortMs, stats.outputMs, totalMs, writeMs);
+    std::fprintf(stderr, "part sizes:");
+    for (std::size_t size : stats.partSizes)
+    {
+        std::fprintf(stderr, " %zu", size);
+    }
+    std::fprintf(stderr, "\n");
+    return 0;
+}
+
+int runAutotune(const Options &options)
+{
+    if (options.size < 1000)
+    {
+        usage();
+        return 2;
+    }
+    std::fprintf(stderr, "tuning on %zu values, %s\n", options.size, machineSignature().c_str());
+    auto start = Clock::now();
+    TuningReport report = autotune(options.size, 3, [](const TuningTrial &trial) {
+        std::fprintf(stderr, "  %-18s %-10s %9.2f ms%s\n", trial.parameter.c_str(), trial.value.c_str(), trial.ms,
+                     trial.kept ? "  *" : "");
+    });
+    std::fprintf(stderr, "tuned in %.1f s: %s\n", msSince(start) / 1e3, describeTuning(report.config).c_str());
+
+    std::fprintf(stderr, "%-22s %12s %12s %8s\n", "kernel", "default ms", "tuned ms", "speedup");
+    for (const TuningSpeedup &speedup : report.speedups)
+    {
+        std::fprintf(stderr, "%-22s %12.2f %12.2f %7.2fx\n", speedup.kernel.c_str(), speedup.defaultMs,
+                     speedup.tunedMs, speedup.defaultMs / std::max(speedup.tunedMs, 1e-9));
+    }
+
+    std::string path = options.output.empty() ? tuningPath() : options.output;
+    std::string error;
+    if (!saveTuning(path, report.config, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "saved to %s\n", path.c_str());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (argc >= 2 && std::strcmp(argv[1], "sort") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runSort(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "batch") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runBatch(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "topk") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runTopK(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "stream") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runStream(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "csv") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runCsv(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "cluster") == 0 && parseOptions(argc, argv, 2, options))
+    {
+        return runCluster(options);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "autotune") == 0 && parseOptions(argc, argv, 2, options, false))
+    {
+        return runAutotune(options);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,474 @@
+#include "clustersort.h"
+#include "cpufeatures.h"
+#include "mergesort.h"
+#include "radixsort.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+              "shared memory atomics must not need a lock");
+
+constexpr int kStamps = 4;  // Started, sampled, exchanged, sorted
+
+// The control segment; the samples follow it
+struct Control
+{
+    std::atomic<std::uint32_t> waiting{0};     // Barrier: workers arrived in this round
+    std::atomic<std::uint32_t> generation{0};  // Barrier: rounds completed
+    std::int64_t startNs = 0;
+    std::atomic<std::int64_t> stamps[ClusterSort::kMaxProcesses][kStamps] = {};  // 0 until reached
+    int splitters[ClusterSort::kMaxProcesses - 1] = {};
+    std::uint64_t counts[ClusterSort::kMaxProcesses][ClusterSort::kMaxProcesses] = {};  // [sender][receiver]
+};
+
+std::int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int *samplesOf(Control &control)
+{
+    return reinterpret_cast<int *>(&control + 1);
+}
+
+// Sense-free barrier: the last to arrive starts the next round
+void barrier(Control &control, unsigned parties)
+{
+    std::uint32_t round = control.generation.load(std::memory_order_acquire);
+    if (control.waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == parties)
+    {
+        control.waiting.store(0, std::memory_order_relaxed);
+        control.generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    while (control.generation.load(std::memory_order_acquire) == round)
+    {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+ClusterSort::~ClusterSort()
+{
+    stopWorkers();
+    removeSegments();
+}
+
+ClusterPhase ClusterSort::slowestPhase() const
+{
+    if (workers.empty())
+    {
+        return ClusterPhase::Idle;
+    }
+    const Control &c = *static_cast<const Control *>(control.data);
+    int reached = kStamps;
+    for (unsigned p = 0; p < options.processes; ++p)
+    {
+        int k = 0;
+        while (k < kStamps && c.stamps[p][k].load(std::memory_order_acquire) != 0)
+        {
+            ++k;
+        }
+        reached = std::min(reached, k);
+    }
+    static const ClusterPhase phases[] = {ClusterPhase::Sampling, ClusterPhase::Sampling, ClusterPhase::Exchange,
+                                          ClusterPhase::LocalSort, ClusterPhase::Done};
+    return phases[reached];
+}
+
+void ClusterSort::snapshot(std::vector<int> &values, std::vector<std::uint8_t> &ownerOf) const
+{
+    values.resize(n);
+    ownerOf.resize(n);
+    if (workers.empty() || n == 0)
+    {
+        return;
+    }
+    if (slowestPhase() == ClusterPhase::Sampling)
+    {
+        std::memcpy(values.data(), input.data, n * sizeof(int));
+        for (unsigned p = 0; p < options.processes; ++p)
+        {
+            std::fill(ownerOf.begin() + n * p / options.processes, ownerOf.begin() + n * (p + 1) / options.processes,
+                      static_cast<std::uint8_t>(p));
+        }
+        return;
+    }
+    std::memcpy(values.data(), output.data, n * sizeof(int));
+    std::memcpy(ownerOf.data(), owners.data, n);
+}
+
+// Only calls that neither allocate nor lock: another thread of the parent
+// may have held the heap's lock when it forked
+void ClusterSort::work(unsigned id)
+{
+    Control &c = *static_cast<Control *>(control.data);
+    int *in = static_cast<int *>(input.data);
+    int *out = static_cast<int *>(output.data);
+    std::uint8_t *own = static_cast<std::uint8_t *>(owners.data);
+    unsigned processes = options.processes;
+    std::size_t perProcess = options.samplesPerProcess;
+    auto stamp = [&](int k) { c.stamps[id][k].store(nowNs(), std::memory_order_release); };
+    stamp(0);
+
+    // Sampling: worker 0 sorts the pooled samples in place and publishes
+    // the splitters every worker then uses
+    std::size_t first = n * id / processes;
+    std::size_t size = n * (id + 1) / processes - first;
+    std::mt19937_64 rng(id + 1);
+    int *samples = samplesOf(c);
+    for (std::size_t s = 0; s < perProcess; ++s)
+    {
+        samples[id * perProcess + s] = size ? in[first + rng() % size] : INT_MIN;
+    }
+    barrier(c, processes);
+    if (id == 0)
+    {
+        std::sort(samples, samples + processes * perProcess);
+        for (unsigned q = 1; q < processes; ++q)
+        {
+            c.splitters[q - 1] = samples[q * perProcess];
+        }
+    }
+    barrier(c, processes);
+    const int *splitters = c.splitters;
+    const int *splittersEnd = c.splitters + (processes - 1);
+    stamp(1);
+
+    // Exchange: counts first, so every sender knows where its elements go
+    std::uint8_t *destination = static_cast<std::uint8_t *>(destinations.data) + first;
+    std::uint64_t count[kMaxProcesses] = {};
+    for (std::size_t k = 0; k < size; ++k)
+    {
+        auto q = std::upper_bound(splitters, splittersEnd, in[first + k]) - splitters;
+        destination[k] = static_cast<std::uint8_t>(q);
+        ++count[q];
+    }
+    std::copy(count, count + processes, c.counts[id]);
+    barrier(c, processes);
+    std::uint64_t partStart[kMaxProcesses + 1] = {};
+    std::uint64_t next[kMaxProcesses];
+    for (unsigned q = 0; q < processes; ++q)
+    {
+        std::uint64_t before = 0;
+        for (unsigned p = 0; p < processes; ++p)
+        {
+            before += p < id ? c.counts[p][q] : 0;
+            partStart[q + 1] += c.counts[p][q];
+        }
+        partStart[q + 1] += partStart[q];
+        next[q] = partStart[q] + before;
+    }
+    for (std::size_t k = 0; k < size; ++k)
+    {
+        std::uint64_t at = next[destination[k]]++;
+        out[at] = in[first + k];
+        own[at] = static_cast<std::uint8_t>(id);
+        if (options.paceMicros)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(options.paceMicros));
+        }
+    }
+    barrier(c, processes);
+    stamp(2);
+
+    // Local sort of this worker's part. Nobody reads the input any more, so
+    // the same range of it is the kernel's second buffer.
+    std::size_t from = static_cast<std::size_t>(partStart[id]);
+    std::size_t to = static_cast<std::size_t>(partStart[id + 1]);
+    std::size_t *scratch = static_cast<std::size_t *>(kernelScratch.data);
+    if (options.localKernel == SortKernel::LsdRadix)
+    {
+        lsdRadixSort(out + from, to - from, in + from, scratch + id * radixCountsSize(tuned.radixDigitBits),
+                     tuned.radixDigitBits);
+    }
+    else if (options.localKernel == SortKernel::BottomUpMerge)
+    {
+        // A part needs (to - from) / minRun + 2 run starts; starting each at
+        // from / minRun + 2 * id keeps the parts' run starts apart
+        MergeSortOptions merge;
+        merge.minRun = std::max<std::size_t>(1, tuned.mergeMinRun);
+        merge.mergeKernel = tuned.mergeKernel;
+        bottomUpMergeSort(out + from, to - from, in + from, scratch + from / merge.minRun + 2 * id, merge);
+    }
+    else
+    {
+        runKernel(options.localKernel, out + from, to - from);  // The rest sort in place
+    }
+    std::memset(own + from, static_cast<int>(id), to - from);
+    stamp(3);
+}
+
+#ifdef _WIN32
+
+bool ClusterSort::start(const int *, std::size_t, ClusterSortOptions)
+{
+    error = "cluster mode needs fork() and POSIX shared memory";
+    return false;
+}
+
+ClusterPhase ClusterSort::poll()
+{
+    return ClusterPhase::Failed;
+}
+
+bool ClusterSort::finish(int *, ClusterSortStats *)
+{
+    return false;
+}
+
+bool ClusterSort::createSegment(Segment &, const char *, std::size_t)
+{
+    return false;
+}
+
+void ClusterSort::removeSegments()
+{
+}
+
+void ClusterSort::stopWorkers()
+{
+}
+
+#else
+
+bool ClusterSort::createSegment(Segment &segment, const char *what, std::size_t size)
+{
+    static std::atomic<unsigned> serial{0};
+    std::string name = "/sortsimple-" + std::to_string(getpid()) + "-" + std::to_string(serial++) + "-" + what;
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        error = "cannot create shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    shm_unlink(name.c_str());
+    size = std::max<std::size_t>(size, 1);  // mmap rejects empty mappings
+    void *data = ftruncate(fd, static_cast<off_t>(size)) == 0
+                     ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        error = "cannot map shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    segment.data = data;
+    segment.size = size;
+    return true;
+}
+
+void ClusterSort::removeSegments()
+{
+    for (Segment *segment : {&control, &input, &output, &owners, &destinations, &kernelScratch})
+    {
+        if (segment->data)
+        {
+            munmap(segment->data, segment->size);
+        }
+        *segment = Segment();
+    }
+}
+
+void ClusterSort::stopWorkers()
+{
+    for (int &pid : workers)
+    {
+        if (pid > 0)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            pid = 0;
+        }
+    }
+    workers.clear();
+}
+
+bool ClusterSort::start(const int *a, std::size_t count, ClusterSortOptions newOptions)
+{
+    stopWorkers();
+    removeSegments();
+    failed = false;
+    options = newOptions;
+    n = count;
+    if (options.processes == 0 || options.processes > kMaxProcesses || options.samplesPerProcess == 0)
+    {
+        error = "cluster mode runs 1 to " + std::to_string(kMaxProcesses) + " processes with at least one sample each";
+        return false;
+    }
+    if (options.localKernel == SortKernel::CountingSort || options.localKernel == SortKernel::BucketSort)
+    {
+        error = std::string("cluster workers cannot run ") + kernelName(options.localKernel) +
+                ": it allocates and starts threads, which a forked worker must not";
+        return false;
+    }
+
+    // Everything a worker would otherwise set up lazily, settled here:
+    // tuning() may read a file and cpuHasAvx2() initializes a static
+    tuned = tuning();
+    cpuHasAvx2();
+    std::size_t scratchEntries = 0;
+    if (options.localKernel == SortKernel::LsdRadix)
+    {
+        scratchEntries = options.processes * radixCountsSize(tuned.radixDigitBits);
+    }
+    else if (options.localKernel == SortKernel::BottomUpMerge)
+    {
+        scratchEntries = n / std::max<std::size_t>(1, tuned.mergeMinRun) + 2 * options.processes;
+    }
+
+    std::size_t sampleBytes = options.processes * options.samplesPerProcess * sizeof(int);
+    if (!createSegment(control, "control", sizeof(Control) + sampleBytes) ||
+        !createSegment(input, "input", n * sizeof(int)) || !createSegment(output, "exchange", n * sizeof(int)) ||
+        !createSegment(owners, "owners", n) || !createSegment(destinations, "destinations", n) ||
+        !createSegment(kernelScratch, "scratch", scratchEntries * sizeof(std::size_t)))
+    {
+        removeSegments();
+        return false;
+    }
+    Control *c = new (control.data) Control;
+    if (n > 0)
+    {
+        std::memcpy(input.data, a, n * sizeof(int));
+    }
+    std::memset(owners.data, kNoOwner, n);
+
+    c->startNs = nowNs();
+    for (unsigned id = 0; id < options.processes; ++id)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            work(id);
+            _exit(0);  // No destructors or atexit handlers of the parent's state
+        }
+        if (pid < 0)
+        {
+            error = std::string("cannot start a worker: ") + std::strerror(errno);
+            stopWorkers();
+            removeSegments();
+            return false;
+        }
+        workers.push_back(pid);
+    }
+    return true;
+}
+
+ClusterPhase ClusterSort::poll()
+{
+    if (failed)
+    {
+        return ClusterPhase::Failed;
+    }
+    for (int &pid : workers)
+    {
+        int status = 0;
+        if (pid > 0 && waitpid(pid, &status, WNOHANG) == pid)
+        {
+            pid = 0;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                error = WIFSIGNALED(status) ? "a worker was killed by signal " + std::to_string(WTERMSIG(status))
+                                            : "a worker failed";
+                failed = true;
+            }
+        }
+    }
+    if (failed)
+    {
+        stopWorkers();  // The others would wait at the next barrier for ever
+        return ClusterPhase::Failed;
+    }
+    return slowestPhase();
+}
+
+bool ClusterSort::finish(int *out, ClusterSortStats *stats)
+{
+    ClusterPhase phase;
+    while ((phase = poll()) != ClusterPhase::Done && phase != ClusterPhase::Failed && phase != ClusterPhase::Idle)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    if (phase != ClusterPhase::Done)
+    {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (n > 0)
+    {
+        std::memcpy(out, output.data, n * sizeof(int));
+    }
+    double outputMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (stats)
+    {
+        const Control &c = *static_cast<const Control *>(control.data);
+        std::int64_t latest[kStamps] = {};
+        for (unsigned p = 0; p < options.processes; ++p)
+        {
+            for (int k = 0; k < kStamps; ++k)
+            {
+                latest[k] = std::max(latest[k], c.stamps[p][k].load());
+            }
+        }
+        stats->launchMs = (latest[0] - c.startNs) / 1e6;
+        stats->samplingMs = (latest[1] - latest[0]) / 1e6;
+        stats->exchangeMs = (latest[2] - latest[1]) / 1e6;
+        stats->localSortMs = (latest[3] - latest[2]) / 1e6;
+        stats->outputMs = outputMs;
+        stats->partSizes.assign(options.processes, 0);
+        for (unsigned p = 0; p < options.processes; ++p)
+        {
+            for (unsigned q = 0; q < options.processes; ++q)
+            {
+                stats->partSizes[q] += static_cast<std::size_t>(c.counts[p][q]);
+            }
+        }
+    }
+    for (int &pid : workers)
+    {
+        if (pid > 0)
+        {
+            waitpid(pid, nullptr, 0);
+            pid = 0;
+        }
+    }
+    workers.clear();
+    return true;
+}
+
+#endif
+
+bool clusterSort(int *a, std::size_t n, ClusterSortOptions options, ClusterSortStats *stats, std::string *error)
+{
+    ClusterSort sorter;
+    if (!sorter.start(a, n, options) || !sorter.finish(a, stats))
+    {
+        if (error)
+        {
+            *error = sorter.errorString();
+        }
+        return false;
+    }
+    return true;
+}
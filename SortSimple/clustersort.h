@@ -0,0 +1,116 @@
+#ifndef CLUSTERSORT_H
+#define CLUSTERSORT_H
+
+#include "sortkernels.h"
+#include "tuning.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ClusterSortOptions
+{
+    unsigned processes = 4;                      // Worker processes, at most kMaxProcesses
+    std::size_t samplesPerProcess = 256;         // Oversampling for the splitters
+    SortKernel localKernel = SortKernel::LsdRadix;
+    unsigned paceMicros = 0;                     // Pause after each element moved, so the exchange can be watched
+};
+
+// Wall time of each phase: the latest worker to finish it, measured from
+// the latest one to finish the phase before
+struct ClusterSortStats
+{
+    double launchMs = 0;     // Segments created and workers forked until all are running
+    double samplingMs = 0;   // Samples drawn, splitters picked
+    double exchangeMs = 0;   // Counted, then moved to their process's part of the output
+    double localSortMs = 0;
+    double outputMs = 0;     // The concatenated parts copied out of shared memory
+    std::vector<std::size_t> partSizes;  // Elements each process ended up sorting
+};
+
+enum class ClusterPhase
+{
+    Idle,
+    Sampling,
+    Exchange,
+    LocalSort,
+    Done,
+    Failed
+};
+
+// Sample sort across local worker processes, as a cluster of machines
+// would run it. The input is copied into a POSIX shared memory segment and
+// each of N forked workers owns one slice of it. Every worker draws samples
+// from its slice; the first one sorts the pooled samples and picks N - 1
+// splitters for all. Each worker counts how many of its elements fall between each
+// pair of splitters, and once all counts are in, writes its elements
+// straight into the exchange segment at their destination process's part,
+// after the parts of lower-numbered senders. Each worker then sorts its
+// own part, and the parts, in order, are the sorted array. Workers meet at
+// a barrier between phases. Workers are forked from a process that may run
+// other threads, so they never allocate: start() maps every buffer they use,
+// and local kernels that need the heap or threads of their own (Counting
+// Sort, Bucket Sort) are refused. POSIX only; start() fails elsewhere.
+class ClusterSort
+{
+public:
+    static constexpr unsigned kMaxProcesses = 64;
+    static constexpr std::uint8_t kNoOwner = 0xFF;
+
+    ClusterSort() = default;
+    ~ClusterSort();  // Stops workers still running and removes the segments
+    ClusterSort(const ClusterSort &) = delete;
+    ClusterSort &operator=(const ClusterSort &) = delete;
+
+    bool start(const int *a, std::size_t n, ClusterSortOptions options = {});
+
+    // The phase the slowest worker is in. Also notices workers that died,
+    // stops the others and reports Failed.
+    ClusterPhase poll();
+    const std::string &errorString() const { return error; }
+
+    // The global array as the processes see it now, and the process holding
+    // each element: the input slices while sampling, then the exchange
+    // segment, where elements not yet moved are kNoOwner and moved ones
+    // belong to their sender until their part is sorted by its owner. For
+    // display; values may be read while they are being written.
+    void snapshot(std::vector<int> &values, std::vector<std::uint8_t> &owners) const;
+
+    // Waits for the workers and copies the sorted array to `out`; false if
+    // a worker failed
+    bool finish(int *out, ClusterSortStats *stats = nullptr);
+
+private:
+    // Mapped, then unlinked at once: workers inherit the mapping, and
+    // nothing is left behind if the program dies
+    struct Segment
+    {
+        void *data = nullptr;
+        std::size_t size = 0;
+    };
+
+    bool createSegment(Segment &segment, const char *what, std::size_t size);
+    void removeSegments();
+    ClusterPhase slowestPhase() const;
+    void stopWorkers();
+    void work(unsigned id);  // Runs in worker process `id`
+
+    ClusterSortOptions options;
+    std::size_t n = 0;
+    Segment control;  // Barrier, phase stamps, samples, splitters and counts
+    Segment input;    // Also the local kernel's second buffer once the exchange is over
+    Segment output;   // The exchange segment, the sorted array at the end
+    Segment owners;
+    Segment destinations;  // Receiving process of each input element
+    Segment kernelScratch; // Radix histograms or merge run starts, per worker
+    TuningConfig tuned;    // Read before forking; loading it may allocate
+    std::vector<int> workers;  // Process ids; 0 once reaped
+    bool failed = false;
+    std::string error;
+};
+
+// Runs a ClusterSort over a[0, n) and copies the result back
+bool clusterSort(int *a, std::size_t n, ClusterSortOptions options = {}, ClusterSortStats *stats = nullptr,
+                 std::string *error = nullptr);
+
+#endif // CLUSTERSORT_H
@@ -0,0 +1,294 @@
+#include "collation.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef SORT_HAVE_ICU
+#include <unicode/ucol.h>
+#include <unicode/ustring.h>
+#else
+#include <locale.h>
+#include <string.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kMinChunk = 4096;  // Strings per thread worth starting one for
+
+#ifdef SORT_HAVE_ICU
+
+const UCollator *collatorOf(const void *handle)
+{
+    return static_cast<const UCollator *>(handle);
+}
+
+#else
+
+// The C library's locale calls, by platform
+#ifdef _WIN32
+using Locale = _locale_t;
+
+Locale makeLocale(const std::string &name)
+{
+    return _create_locale(LC_COLLATE, name.c_str());
+}
+
+void freeLocale(Locale locale)
+{
+    _free_locale(locale);
+}
+
+std::size_t transform(char *out, const char *s, std::size_t room, Locale locale)
+{
+    return _strxfrm_l(out, s, room, locale);
+}
+
+int collate(const char *a, const char *b, Locale locale)
+{
+    return _strcoll_l(a, b, locale);
+}
+#else
+using Locale = locale_t;
+
+Locale makeLocale(const std::string &name)
+{
+    return newlocale(LC_COLLATE_MASK, name.c_str(), static_cast<locale_t>(0));
+}
+
+void freeLocale(Locale locale)
+{
+    freelocale(locale);
+}
+
+std::size_t transform(char *out, const char *s, std::size_t room, Locale locale)
+{
+    return strxfrm_l(out, s, room, locale);
+}
+
+int collate(const char *a, const char *b, Locale locale)
+{
+    return strcoll_l(a, b, locale);
+}
+#endif
+
+Locale localeOf(const void *handle)
+{
+    return static_cast<Locale>(const_cast<void *>(handle));
+}
+
+#endif
+
+} // namespace
+
+Collator::~Collator()
+{
+    close();
+}
+
+#ifdef SORT_HAVE_ICU
+
+bool Collator::open(const std::string &locale)
+{
+    close();
+    UErrorCode status = U_ZERO_ERROR;
+    // An unknown locale falls back to the root rules with a warning, not an error
+    UCollator *collator = ucol_open(locale.empty() ? nullptr : locale.c_str(), &status);
+    if (U_FAILURE(status))
+    {
+        error = "Cannot open a collator for " + (locale.empty() ? std::string("the default locale") : locale) +
+                ": " + u_errorName(status);
+        return false;
+    }
+    handle = collator;
+    error.clear();
+    return true;
+}
+
+void Collator::close()
+{
+    if (handle)
+    {
+        ucol_close(static_cast<UCollator *>(handle));
+        handle = nullptr;
+    }
+}
+
+void Collator::appendKey(std::string_view s, std::string &key) const
+{
+    // ICU collates UTF-16, which never needs more units than UTF-8 has bytes;
+    // invalid UTF-8 becomes U+FFFD
+    thread_local std::vector<UChar> text;
+    text.resize(s.size() + 1);
+    std::int32_t units = 0;
+    UErrorCode status = U_ZERO_ERROR;
+    u_strFromUTF8WithSub(text.data(), static_cast<std::int32_t>(text.size()), &units, s.data(),
+                         static_cast<std::int32_t>(s.size()), 0xFFFD, nullptr, &status);
+    if (U_FAILURE(status))
+    {
+        units = 0;
+    }
+
+    std::size_t start = key.size();
+    std::size_t room = 2 * s.size() + 16;
+    for (;;)
+    {
+        key.resize(start + room);
+        std::int32_t needed = ucol_getSortKey(collatorOf(handle), text.data(), units,
+                                              reinterpret_cast<std::uint8_t *>(&key[start]),
+                                              static_cast<std::int32_t>(room));
+        if (needed <= 0)
+        {
+            key.resize(start);
+            return;
+        }
+        if (static_cast<std::size_t>(needed) <= room)
+        {
+            key.resize(start + needed - 1);  // Without the terminating NUL
+            return;
+        }
+        room = static_cast<std::size_t>(needed);
+    }
+}
+
+int Collator::compare(std::string_view a, std::string_view b) const
+{
+    UErrorCode status = U_ZERO_ERROR;
+    return ucol_strcollUTF8(collatorOf(handle), a.data(), static_cast<std::int32_t>(a.size()), b.data(),
+                            static_cast<std::int32_t>(b.size()), &status);
+}
+
+#else
+
+bool Collator::open(const std::string &locale)
+{
+    close();
+    Locale l = makeLocale(locale);
+    if (!l && !locale.empty() && locale.find('.') == std::string::npos)
+    {
+        l = makeLocale(locale + ".UTF-8");  // "de_DE" is usually installed as "de_DE.UTF-8"
+    }
+    if (!l)
+    {
+        error = "Locale " + locale + " is not installed";
+        return false;
+    }
+    handle = l;
+    error.clear();
+    return true;
+}
+
+void Collator::close()
+{
+    if (handle)
+    {
+        freeLocale(localeOf(handle));
+        handle = nullptr;
+    }
+}
+
+void Collator::appendKey(std::string_view s, std::string &key) const
+{
+    thread_local std::string text;
+    text.assign(s.data(), s.size());  // The C library wants terminated strings
+
+    std::size_t start = key.size();
+    std::size_t room = 2 * s.size() + 16;
+    for (;;)
+    {
+        key.resize(start + room);
+        std::size_t needed = transform(&key[start], text.c_str(), room, localeOf(handle));
+        if (needed < room)
+        {
+            key.resize(start + needed);
+            return;
+        }
+        room = needed + 1;
+    }
+}
+
+int Collator::compare(std::string_view a, std::string_view b) const
+{
+    thread_local std::string x, y;
+    x.assign(a.data(), a.size());
+    y.assign(b.data(), b.size());
+    return collate(x.c_str(), y.c_str(), localeOf(handle));
+}
+
+#endif
+
+StringArena collationKeys(const Collator &collator, const StringArena &strings, unsigned threads)
+{
+    std::size_t n = strings.size();
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, n / kMinChunk + 1));
+
+    // Each thread fills an arena for its slice; they are joined in order, so
+    // key ids stay equal to string ids
+    std::vector<StringArena> parts(threads);
+    auto build = [&](unsigned t) {
+        std::size_t first = n * t / threads;
+        std::size_t last = n * (t + 1) / threads;
+        if (first == last)
+        {
+            return;
+        }
+        std::string_view back = strings.view(static_cast<std::uint32_t>(last - 1));
+        std::size_t bytes = static_cast<std::size_t>(back.data() + back.size() -
+                                                     strings.view(static_cast<std::uint32_t>(first)).data());
+        parts[t].reserve(last - first, 2 * bytes);
+        std::string key;
+        for (std::size_t id = first; id < last; ++id)
+        {
+            key.clear();
+            collator.appendKey(strings.view(static_cast<std::uint32_t>(id)), key);
+            parts[t].add(key);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back(build, t);
+    }
+    build(0);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    StringArena keys = std::move(parts[0]);
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        keys.append(parts[t]);
+    }
+    return keys;
+}
+
+std::vector<std::uint32_t> collationOrder(const Collator &collator, const StringArena &strings, unsigned threads)
+{
+    StringArena keys = collationKeys(collator, strings, threads);
+    std::vector<StringRef> refs = makeStringRefs(keys);
+    msdRadixSort(keys, refs);
+
+    // Empty keys sort first and all share one offset, so idOf() cannot tell
+    // them apart; they are listed by id instead
+    std::vector<std::uint32_t> order;
+    order.reserve(refs.size());
+    for (std::uint32_t id = 0; id < keys.size(); ++id)
+    {
+        if (keys.view(id).empty())
+        {
+            order.push_back(id);
+        }
+    }
+    for (const StringRef &ref : refs)
+    {
+        if (ref.length != 0)
+        {
+            order.push_back(keys.idOf(ref));
+        }
+    }
+    return order;
+}
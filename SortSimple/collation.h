@@ -0,0 +1,52 @@
+#ifndef COLLATION_H
+#define COLLATION_H
+
+#include "stringsort.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Locale-correct order for UTF-8 strings. A sort key is a byte string that
+// compares with memcmp the way its string collates, so instead of calling
+// the collator on every comparison, each string's key is computed once and
+// the keys are sorted with the byte-wise string kernels. Keys come from ICU
+// when the build found it (SORT_HAVE_ICU), otherwise from the C library's
+// strxfrm_l, which only knows the locales installed on the system.
+class Collator
+{
+public:
+    Collator() = default;
+    ~Collator();
+    Collator(const Collator &) = delete;
+    Collator &operator=(const Collator &) = delete;
+
+    // `locale` like "de_DE" or "sv_SE"; empty means the user's locale
+    bool open(const std::string &locale);
+    void close();
+    bool isOpen() const { return handle != nullptr; }
+    const std::string &errorString() const { return error; }
+
+    // Appends the sort key of `s` to `key`. Keys never contain NUL bytes.
+    // Safe to call from several threads at once.
+    void appendKey(std::string_view s, std::string &key) const;
+
+    // One collator call: negative, zero or positive as a sorts before,
+    // with or after b
+    int compare(std::string_view a, std::string_view b) const;
+
+private:
+    void *handle = nullptr;  // UCollator * with ICU, locale_t otherwise
+    std::string error;
+};
+
+// The sort keys of all strings of `strings`, computed on `threads` threads
+// (0 means one per core); key id k belongs to string id k
+StringArena collationKeys(const Collator &collator, const StringArena &strings, unsigned threads = 0);
+
+// The ids of `strings` in collation order: collationKeys() sorted with
+// msdRadixSort. Strings that collate equal keep no particular order.
+std::vector<std::uint32_t> collationOrder(const Collator &collator, const StringArena &strings,
+                                          unsigned threads = 0);
+
+#endif // COLLATION_H
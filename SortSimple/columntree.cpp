@@ -0,0 +1,230 @@
+#include "columntree.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+ColumnSummary join(const ColumnSummary &a, const ColumnSummary &b)
+{
+    return {std::min(a.minValue, b.minValue), std::max(a.maxValue, b.maxValue), std::max(a.touched, b.touched)};
+}
+
+bool operator==(const ColumnSummary &a, const ColumnSummary &b)
+{
+    return a.minValue == b.minValue && a.maxValue == b.maxValue && a.touched == b.touched;
+}
+
+} // namespace
+
+void ColumnTree::assign(std::vector<int> newValues)
+{
+    values = std::move(newValues);
+    tracker.assign(values.data(), values.size());
+    leaves = (values.size() + kBlock - 1) / kBlock;
+    nodes.assign(2 * leaves, ColumnSummary());
+    for (std::size_t b = 0; b < leaves; ++b)
+    {
+        nodes[leaves + b] = scan(b * kBlock, std::min(values.size(), (b + 1) * kBlock));
+    }
+    for (std::size_t k = leaves - 1; k >= 1 && k < leaves; --k)
+    {
+        nodes[k] = join(nodes[2 * k], nodes[2 * k + 1]);
+    }
+}
+
+ColumnSummary ColumnTree::scan(std::size_t first, std::size_t last) const
+{
+    ColumnSummary s;
+    s.minValue = s.maxValue = values[first];
+    for (std::size_t k = first + 1; k < last; ++k)
+    {
+        s.minValue = std::min(s.minValue, values[k]);
+        s.maxValue = std::max(s.maxValue, values[k]);
+    }
+    return s;
+}
+
+// Recomputes the ancestors of `node`, stopping at the first that is unchanged
+void ColumnTree::raise(std::size_t node)
+{
+    for (node >>= 1; node >= 1; node >>= 1)
+    {
+        ColumnSummary joined = join(nodes[2 * node], nodes[2 * node + 1]);
+        if (joined == nodes[node])
+        {
+            break;
+        }
+        nodes[node] = joined;
+    }
+}
+
+void ColumnTree::rescan(std::size_t block, std::uint32_t stamp)
+{
+    ColumnSummary &leaf = nodes[leaves + block];
+    std::uint32_t touched = std::max(leaf.touched, stamp);
+    leaf = scan(block * kBlock, std::min(values.size(), (block + 1) * kBlock));
+    leaf.touched = touched;
+}
+
+void ColumnTree::set(std::size_t i, int value, std::uint32_t stamp)
+{
+    int old = values[i];
+    values[i] = value;
+    tracker.changed(values.data(), i, old);
+    std::size_t block = i / kBlock;
+    ColumnSummary &leaf = nodes[leaves + block];
+    if (old != value && (old == leaf.minValue || old == leaf.maxValue))
+    {
+        rescan(block, stamp);  // The old value may have been the only extreme
+    }
+    else
+    {
+        leaf.minValue = std::min(leaf.minValue, value);
+        leaf.maxValue = std::max(leaf.maxValue, value);
+        leaf.touched = std::max(leaf.touched, stamp);
+    }
+    raise(leaves + block);
+}
+
+void ColumnTree::swap(std::size_t i, std::size_t j, std::uint32_t stamp)
+{
+    if (i / kBlock == j / kBlock)
+    {
+        std::swap(values[i], values[j]);
+        tracker.swapped(values.data(), i, j);
+        touch(i, stamp);
+        return;
+    }
+    int vi = values[i];
+    set(i, values[j], stamp);
+    set(j, vi, stamp);
+}
+
+void ColumnTree::touch(std::size_t i, std::uint32_t stamp)
+{
+    std::size_t node = leaves + i / kBlock;
+    if (nodes[node].touched < stamp)
+    {
+        nodes[node].touched = stamp;
+        raise(node);
+    }
+}
+
+void ColumnTree::refresh(std::size_t first, std::size_t last, std::uint32_t stamp)
+{
+    if (first >= last)
+    {
+        return;
+    }
+    tracker.refresh(values.data(), first, last);
+    std::size_t from = leaves + first / kBlock;
+    std::size_t to = leaves + (last - 1) / kBlock;
+    for (std::size_t node = from; node <= to; ++node)
+    {
+        rescan(node - leaves, stamp);
+    }
+    // Each level up covers the same range with half as many nodes
+    for (from >>= 1, to >>= 1; from >= 1; from >>= 1, to >>= 1)
+    {
+        for (std::size_t node = from; node <= to; ++node)
+        {
+            nodes[node] = join(nodes[2 * node], nodes[2 * node + 1]);
+        }
+    }
+}
+
+void ColumnTree::apply(const TraceEvent *events, std::size_t count, std::uint32_t stamp)
+{
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        const TraceEvent &e = events[k];
+        switch (e.type)
+        {
+        case TraceEvent::Write:
+            set(e.i, e.value, stamp);
+            break;
+        case TraceEvent::Swap:
+            swap(e.i, e.j, stamp);
+            break;
+        case TraceEvent::Compare:
+            touch(e.i, stamp);
+            touch(e.j, stamp);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+ColumnSummary ColumnTree::query(std::size_t first, std::size_t last) const
+{
+    std::size_t firstBlock = first / kBlock;
+    std::size_t lastBlock = (last - 1) / kBlock;
+    ColumnSummary result = scan(first, std::min(last, (firstBlock + 1) * kBlock));
+    result.touched = nodes[leaves + firstBlock].touched;
+    if (firstBlock == lastBlock)
+    {
+        return result;
+    }
+    ColumnSummary tail = scan(lastBlock * kBlock, last);
+    tail.touched = nodes[leaves + lastBlock].touched;
+    result = join(result, tail);
+
+    // Whole blocks in between, bottom-up
+    for (std::size_t l = leaves + firstBlock + 1, r = leaves + lastBlock; l < r; l >>= 1, r >>= 1)
+    {
+        if (l & 1)
+        {
+            result = join(result, nodes[l++]);
+        }
+        if (r & 1)
+        {
+            result = join(result, nodes[--r]);
+        }
+    }
+    return result;
+}
+
+void ColumnTree::columns(std::size_t first, std::size_t last, std::size_t width, ColumnSummary *out) const
+{
+    std::size_t length = last - first;
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        std::size_t from = first + length * x / width;
+        std::size_t to = std::max(from + 1, first + length * (x + 1) / width);
+        to = std::min(to, last);
+        out[x] = query(from, to);
+        out[x].sorted = tracker.rangeSorted(values.data(), from, to);
+    }
+}
+
+void TraceQueue::consume(const TraceEvent *events, std::size_t count)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return cancelled || batches.size() < capacity; });
+    if (!cancelled)
+    {
+        batches.emplace_back(events, events + count);
+    }
+}
+
+bool TraceQueue::pop(std::vector<TraceEvent> &batch)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (batches.empty())
+    {
+        return false;
+    }
+    batch = std::move(batches.front());
+    batches.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+void TraceQueue::cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+    batches.clear();
+    notFull.notify_all();
+}
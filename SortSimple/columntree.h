@@ -0,0 +1,94 @@
+#ifndef COLUMNTREE_H
+#define COLUMNTREE_H
+
+#include "sortedness.h"
+#include "sorttrace.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// What one pixel column shows for a range of the array
+struct ColumnSummary
+{
+    int minValue = 0;
+    int maxValue = 0;
+    std::uint32_t touched = 0;  // Latest stamp of a write, swap or compare in the range; 0 if none
+    bool sorted = false;        // The range is in order; filled in by columns() only
+};
+
+// Min/max/last-touched aggregate over an array, for drawing arrays far
+// longer than the screen is wide. Leaves summarize blocks of kBlock
+// elements, so the tree is 2n / kBlock nodes on top of the values. A change
+// updates its block and walks up only while a node's summary changes, which
+// with one stamp per frame usually stops a few levels up. Any range, and so
+// any pixel column at any zoom, is summarized in O(log n). Highlights are
+// kept per block, not per element. A SortednessTracker follows every change,
+// so whether the array, or any column of it, is in order needs no scan.
+class ColumnTree
+{
+public:
+    static constexpr std::size_t kBlock = 32;
+
+    void assign(std::vector<int> values);
+    std::size_t size() const { return values.size(); }
+    const std::vector<int> &data() const { return values; }
+    const SortednessTracker &order() const { return tracker; }
+    bool sorted() const { return tracker.sorted(); }
+
+    // Stamps are chosen by the caller, typically one per frame; 0 means untouched
+    void set(std::size_t i, int value, std::uint32_t stamp);
+    void swap(std::size_t i, std::size_t j, std::uint32_t stamp);
+    void touch(std::size_t i, std::uint32_t stamp);
+
+    // For bulk changes made to the values directly: refresh() afterwards
+    // rebuilds the summaries of [first, last), in O(last - first + log n)
+    int *mutableData() { return values.data(); }
+    void refresh(std::size_t first, std::size_t last, std::uint32_t stamp);
+
+    // Applies Write, Swap and Compare events. Writes to the auxiliary
+    // buffer land on the position they stand in for, as in the bar view.
+    void apply(const TraceEvent *events, std::size_t count, std::uint32_t stamp);
+
+    ColumnSummary query(std::size_t first, std::size_t last) const;  // [first, last), not empty
+
+    // Summaries of `width` consecutive columns splitting [first, last) evenly
+    void columns(std::size_t first, std::size_t last, std::size_t width, ColumnSummary *out) const;
+
+private:
+    void raise(std::size_t node);
+    void rescan(std::size_t block, std::uint32_t stamp);
+    ColumnSummary scan(std::size_t first, std::size_t last) const;
+
+    std::vector<int> values;
+    SortednessTracker tracker;
+    std::vector<ColumnSummary> nodes;  // nodes[leaves + b] is block b; nodes[k] joins nodes[2k] and nodes[2k + 1]
+    std::size_t leaves = 0;
+};
+
+// Hands trace batches from a kernel on a worker thread to the GUI thread.
+// consume() blocks while `capacity` batches are waiting, so the kernel runs
+// only as far ahead of the display as that; after cancel() it drops
+// everything, letting the kernel finish at full speed.
+class TraceQueue : public TraceSink
+{
+public:
+    explicit TraceQueue(std::size_t capacity = 64) : capacity(capacity) {}
+
+    void consume(const TraceEvent *events, std::size_t count) override;
+
+    // Moves the oldest batch into `batch`; false if none is waiting
+    bool pop(std::vector<TraceEvent> &batch);
+    void cancel();
+
+private:
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::deque<std::vector<TraceEvent>> batches;
+    std::size_t capacity;
+    bool cancelled = false;
+};
+
+#endif // COLUMNTREE_H
@@ -0,0 +1,308 @@
+#include "countingsort.h"
+#include "tuning.h"
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr unsigned kMaxBucketBits = 11;
+
+unsigned workerCount(unsigned threads, std::size_t n, bool traced)
+{
+    if (traced)
+    {
+        return 1;  // Trace events must come in program order
+    }
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<unsigned>(std::min<std::size_t>(threads, n / tuning().parallelGrain + 1));
+}
+
+// Calls f(t, from, to) for `threads` equal slices of [0, n), slice 0 on the
+// calling thread
+template <typename F>
+void forEachSlice(std::size_t n, unsigned threads, F f)
+{
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back([&f, n, t, threads] { f(t, n * t / threads, n * (t + 1) / threads); });
+    }
+    f(0u, std::size_t(0), n / threads);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+unsigned bitsFor(std::uint64_t value)
+{
+    unsigned bits = 0;
+    while (bits < 64 && (value >> bits) != 0)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+// Keys are handled as offsets from `base`, so `span` is max - min + 1
+struct KeyRange
+{
+    std::uint32_t base;
+    std::uint64_t span;
+};
+
+KeyRange keyRange(const int *a, std::size_t n, unsigned threads)
+{
+    std::vector<std::pair<int, int>> extremes(threads, {a[0], a[0]});
+    forEachSlice(n, threads, [&](unsigned t, std::size_t from, std::size_t to) {
+        // Separate min and max vectorize; std::minmax_element does not
+        int lowest = a[from], highest = a[from];
+        for (std::size_t k = from + 1; k < to; ++k)
+        {
+            lowest = std::min(lowest, a[k]);
+            highest = std::max(highest, a[k]);
+        }
+        extremes[t] = {lowest, highest};
+    });
+    int lowest = extremes[0].first, highest = extremes[0].second;
+    for (const auto &e : extremes)
+    {
+        lowest = std::min(lowest, e.first);
+        highest = std::max(highest, e.second);
+    }
+    std::uint32_t base = static_cast<std::uint32_t>(lowest);
+    return {base, std::uint64_t(static_cast<std::uint32_t>(highest) - base) + 1};
+}
+
+// Per-thread histograms of bucketOf over a[first, last), added into one
+template <typename Trace, typename BucketOf>
+std::vector<std::size_t> histogram(const int *a, std::size_t first, std::size_t last, std::size_t buckets,
+                                   Trace &trace, unsigned threads, BucketOf bucketOf)
+{
+    std::vector<std::size_t> counts(buckets * threads, 0);
+    forEachSlice(last - first, threads, [&](unsigned t, std::size_t from, std::size_t to) {
+        std::size_t *count = counts.data() + t * buckets;
+        for (std::size_t k = first + from; k < first + to; ++k)
+        {
+            ++count[bucketOf(a[k])];
+        }
+    });
+    for (std::size_t k = first; k < last; ++k)
+    {
+        trace.read(k);
+    }
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        const std::size_t *count = counts.data() + t * buckets;
+        for (std::size_t b = 0; b < buckets; ++b)
+        {
+            counts[b] += count[b];
+        }
+    }
+    counts.resize(buckets);
+    return counts;
+}
+
+template <typename Trace>
+void insertionRange(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    for (std::size_t i = first + 1; i < last; ++i)
+    {
+        int key = a[i];
+        std::size_t j = i;
+        while (j > first)
+        {
+            trace.compare(j - 1, j);
+            if (a[j - 1] <= key)
+            {
+                break;
+            }
+            a[j] = a[j - 1];
+            trace.write(j, a[j]);
+            --j;
+        }
+        a[j] = key;
+        trace.write(j, key);
+    }
+}
+
+// Counting sort of a[first, last), whose keys lie in [base, base + span)
+template <typename Trace>
+void countRange(int *a, std::size_t first, std::size_t last, std::uint32_t base, std::size_t span, Trace &trace,
+                unsigned threads)
+{
+    std::vector<std::size_t> starts = histogram(a, first, last, span, trace, threads, [base](int v) {
+        return static_cast<std::uint32_t>(v) - base;
+    });
+    std::size_t offset = first;
+    for (std::size_t &start : starts)
+    {
+        std::size_t count = start;
+        start = offset;
+        offset += count;
+    }
+    starts.push_back(last);
+
+    if (Trace::enabled)
+    {
+        for (std::size_t key = 0; key < span; ++key)
+        {
+            if (starts[key] == starts[key + 1])
+            {
+                continue;
+            }
+            trace.mark(TagBucket, starts[key], starts[key + 1] - 1);
+            for (std::size_t k = starts[key]; k < starts[key + 1]; ++k)
+            {
+                a[k] = static_cast<int>(base + key);
+                trace.write(k, a[k]);
+            }
+        }
+        return;
+    }
+
+    // Each thread writes an equal share of the output, starting with the
+    // key whose run contains the first position of its share
+    forEachSlice(last - first, threads, [&](unsigned, std::size_t from, std::size_t to) {
+        from += first;
+        to += first;
+        std::size_t key = std::upper_bound(starts.begin(), starts.end(), from) - starts.begin() - 1;
+        while (from < to)
+        {
+            std::size_t end = std::min(to, starts[key + 1]);
+            std::fill(a + from, a + end, static_cast<int>(base + key));
+            from = end;
+            ++key;
+        }
+    });
+}
+
+template <typename Trace>
+void bucketRange(int *a, std::size_t first, std::size_t last, std::uint32_t base, std::uint64_t span, Trace &trace,
+                 unsigned threads, std::size_t smallBucket)
+{
+    const std::size_t n = last - first;
+    if (n <= smallBucket)
+    {
+        insertionRange(a, first, last, trace);
+        return;
+    }
+    if (span <= n && span <= kMaxCountingSpan)
+    {
+        countRange(a, first, last, base, static_cast<std::size_t>(span), trace, threads);
+        return;
+    }
+
+    // About four keys per bucket; the shift makes the buckets cover the span
+    const unsigned bucketBits = std::min({kMaxBucketBits, std::max(1u, bitsFor(n / 4)), bitsFor(span - 1)});
+    const unsigned shift = bitsFor(span - 1) - bucketBits;
+    const std::size_t buckets = static_cast<std::size_t>((span - 1) >> shift) + 1;
+    auto bucketOf = [base, shift](int v) { return (static_cast<std::uint32_t>(v) - base) >> shift; };
+
+    std::vector<std::size_t> heads = histogram(a, first, last, buckets, trace, threads, bucketOf);
+    std::vector<std::size_t> starts(buckets + 1);
+    std::size_t offset = first;
+    for (std::size_t b = 0; b < buckets; ++b)
+    {
+        starts[b] = offset;
+        offset += heads[b];
+        heads[b] = starts[b];
+    }
+    starts[buckets] = last;
+
+    // In-place distribution in sweeps: every key in the unplaced part of a
+    // bucket is swapped to the head of the bucket it belongs to, and the key
+    // that comes back waits for the next sweep. Consecutive swaps then do
+    // not depend on each other, so their cache misses overlap.
+    for (bool unplaced = true; unplaced;)
+    {
+        unplaced = false;
+        for (std::size_t b = 0; b < buckets; ++b)
+        {
+            const std::size_t end = starts[b + 1];
+            for (std::size_t k = heads[b]; k < end; ++k)
+            {
+                std::size_t to = heads[bucketOf(a[k])]++;
+                if (to != k)
+                {
+                    std::swap(a[k], a[to]);
+                    trace.swap(k, to);
+                }
+            }
+            unplaced = unplaced || heads[b] < end;
+        }
+    }
+
+    // Threads finish the buckets that start in their share of the range
+    const std::uint64_t width = std::uint64_t(1) << shift;
+    forEachSlice(n, threads, [&](unsigned, std::size_t from, std::size_t to) {
+        std::size_t b = std::lower_bound(starts.begin(), starts.end() - 1, first + from) - starts.begin();
+        for (; b < buckets && starts[b] < first + to; ++b)
+        {
+            if (starts[b + 1] - starts[b] < 2)
+            {
+                continue;
+            }
+            trace.mark(TagBucket, starts[b], starts[b + 1] - 1);
+            std::uint64_t low = std::uint64_t(b) << shift;
+            bucketRange(a, starts[b], starts[b + 1], base + static_cast<std::uint32_t>(low),
+                        std::min(width, span - low), trace, 1, smallBucket);
+        }
+    });
+}
+
+} // namespace
+
+template <typename Trace>
+bool countingSort(int *a, std::size_t n, Trace &trace, unsigned threads)
+{
+    if (n < 2)
+    {
+        return true;
+    }
+    threads = workerCount(threads, n, Trace::enabled);
+    KeyRange keys = keyRange(a, n, threads);
+    if (keys.span > kMaxCountingSpan)
+    {
+        return false;
+    }
+    countRange(a, 0, n, keys.base, static_cast<std::size_t>(keys.span), trace, threads);
+    return true;
+}
+
+bool countingSort(int *a, std::size_t n, unsigned threads)
+{
+    NullTrace trace;
+    return countingSort(a, n, trace, threads);
+}
+
+template <typename Trace>
+void bucketSort(int *a, std::size_t n, Trace &trace, unsigned threads, std::size_t smallBucket)
+{
+    if (n < 2)
+    {
+        return;
+    }
+    threads = workerCount(threads, n, Trace::enabled);
+    KeyRange keys = keyRange(a, n, threads);
+    bucketRange(a, 0, n, keys.base, keys.span, trace, threads, smallBucket);
+}
+
+void bucketSort(int *a, std::size_t n, unsigned threads)
+{
+    NullTrace trace;
+    bucketSort(a, n, trace, threads);
+}
+
+template bool countingSort<SortTrace>(int *, std::size_t, SortTrace &, unsigned);
+template bool countingSort<NullTrace>(int *, std::size_t, NullTrace &, unsigned);
+template bool countingSort<StreamingTrace>(int *, std::size_t, StreamingTrace &, unsigned);
+
+template void bucketSort<SortTrace>(int *, std::size_t, SortTrace &, unsigned, std::size_t);
+template void bucketSort<NullTrace>(int *, std::size_t, NullTrace &, unsigned, std::size_t);
+template void bucketSort<StreamingTrace>(int *, std::size_t, StreamingTrace &, unsigned, std::size_t);
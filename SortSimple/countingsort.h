@@ -0,0 +1,37 @@
+#ifndef COUNTINGSORT_H
+#define COUNTINGSORT_H
+
+#include "sorttrace.h"
+#include <cstddef>
+#include <cstdint>
+
+// Widest key range (max - min + 1) countingSort accepts: 8 MB of counters
+// per thread at most
+constexpr std::uint64_t kMaxCountingSpan = std::uint64_t(1) << 20;
+
+// Counting sort for keys in a narrow range. Each thread counts its slice of
+// the input into a histogram of its own, the histograms are added up, and
+// the threads then write the sorted keys back from the counts, each taking
+// an equal share of the output. Extra memory is one counter per possible key
+// per thread, however long the input. Returns false and leaves `a` untouched
+// if the range is wider than kMaxCountingSpan. `threads` 0 means one per
+// core; traced runs use one.
+template <typename Trace>
+bool countingSort(int *a, std::size_t n, Trace &trace, unsigned threads = 0);
+bool countingSort(int *a, std::size_t n, unsigned threads = 0);
+
+// Bucket sort for keys whose range is too wide for countingSort's table.
+// The keys are moved in place into buckets by their high bits, about one
+// bucket per four keys but at most 2^11, so the bucket heads stay in L1 and
+// no scratch array is needed. Each bucket is then finished by counting sort
+// if it holds at least as many keys as it has values, by insertion sort if
+// it is tiny, and otherwise split again on the next bits. Histograms are
+// built per thread as in countingSort, and the threads finish disjoint sets
+// of buckets. Fastest when the range is no wider than n; on wider ranges it
+// trails LSD radix sort but needs no n-sized buffer. Buckets of up to
+// `smallBucket` keys are insertion sorted.
+template <typename Trace>
+void bucketSort(int *a, std::size_t n, Trace &trace, unsigned threads = 0, std::size_t smallBucket = 16);
+void bucketSort(int *a, std::size_t n, unsigned threads = 0);
+
+#endif // COUNTINGSORT_H
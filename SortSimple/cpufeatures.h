@@ -0,0 +1,21 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Kernels with an AVX2 version compile it with SORT_TARGET_AVX2 next to the
+// portable one and pick between them at run time with cpuHasAvx2(), so one
+// binary runs everywhere and still uses the wide registers where they exist.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SORT_HAVE_X86 1
+#define SORT_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define SORT_HAVE_X86 1
+#define SORT_TARGET_AVX2
+#else
+#define SORT_HAVE_X86 0
+#define SORT_TARGET_AVX2
+#endif
+
+// True when the CPU and the operating system both support AVX2
+bool cpuHasAvx2();
+
+#endif // CPUFEATURES_H
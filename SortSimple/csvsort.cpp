@@ -0,0 +1,675 @@
+#include "csvsort.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t kMinChunkBytes = 1 << 20;  // Text per thread worth starting one for
+constexpr std::size_t kMinChunkRows = 1 << 16;
+constexpr std::size_t kInsertion = 24;           // Records below which the radix sort stops splitting
+
+unsigned threadCount(unsigned threads, std::size_t work, std::size_t minChunk)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return static_cast<unsigned>(std::min<std::size_t>(threads, work / minChunk + 1));
+}
+
+// Calls f(t) for t in [0, threads), t = 0 on the calling thread
+template <typename F>
+void onThreads(unsigned threads, F f)
+{
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back([&f, t] { f(t); });
+    }
+    f(0u);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// The fields of one row, up to the last key column. Quoted fields are
+// unquoted; those with doubled quotes inside are rebuilt in `unquoted`.
+struct RowFields
+{
+    std::vector<std::string_view> fields;
+    std::vector<std::string> unquoted;
+
+    void split(const char *row, const char *end, char delimiter, std::size_t count)
+    {
+        fields.assign(count, std::string_view());
+        unquoted.resize(count);
+        while (end > row && (end[-1] == '\n' || end[-1] == '\r'))
+        {
+            --end;
+        }
+        const char *p = row;
+        for (std::size_t c = 0; c < count && p <= end; ++c)
+        {
+            const char *next;
+            if (p < end && *p == '"')
+            {
+                const char *q = p + 1;
+                bool escaped = false;
+                while (q < end && !(*q == '"' && (q + 1 == end || q[1] != '"')))
+                {
+                    escaped = escaped || *q == '"';
+                    q += *q == '"' ? 2 : 1;
+                }
+                if (!escaped)
+                {
+                    fields[c] = std::string_view(p + 1, static_cast<std::size_t>(q - p - 1));
+                }
+                else
+                {
+                    std::string &s = unquoted[c];
+                    s.clear();
+                    for (const char *r = p + 1; r < q; ++r)
+                    {
+                        s.push_back(*r);
+                        r += *r == '"';
+                    }
+                    fields[c] = s;
+                }
+                next = static_cast<const char *>(std::memchr(q, delimiter, static_cast<std::size_t>(end - q)));
+            }
+            else
+            {
+                next = static_cast<const char *>(std::memchr(p, delimiter, static_cast<std::size_t>(end - p)));
+                fields[c] = std::string_view(p, static_cast<std::size_t>((next ? next : end) - p));
+            }
+            p = next ? next + 1 : end + 1;
+        }
+    }
+};
+
+void putBigEndian(unsigned char *out, std::uint64_t value)
+{
+    for (int k = 7; k >= 0; --k)
+    {
+        out[k] = static_cast<unsigned char>(value);
+        value >>= 8;
+    }
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// Plain decimals of up to 15 significant digits, like most amounts and
+// counts, are exact as integer / 10^k in doubles (one correctly rounded
+// division); anything else goes through from_chars
+bool parseNumber(std::string_view s, double &value)
+{
+    std::size_t k = s.size() > 0 && s[0] == '-' ? 1 : 0;
+    std::uint64_t digits = 0;
+    int count = 0;
+    int fraction = -1;
+    bool any = false;
+    for (; k < s.size() && count <= 15; ++k)
+    {
+        if (s[k] >= '0' && s[k] <= '9')
+        {
+            digits = digits * 10 + static_cast<std::uint64_t>(s[k] - '0');
+            count += digits != 0;
+            fraction += fraction >= 0;
+            any = true;
+        }
+        else if (s[k] == '.' && fraction < 0)
+        {
+            fraction = 0;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (k == s.size() && count <= 15 && any)
+    {
+        static const double powers[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        if (fraction <= 22)
+        {
+            value = static_cast<double>(digits) / powers[fraction < 0 ? 0 : fraction];
+            value = s[0] == '-' ? -value : value;
+            return true;
+        }
+    }
+    auto [end, status] = std::from_chars(s.data(), s.data() + s.size(), value);
+    return !s.empty() && status == std::errc();
+}
+
+// IEEE bits with the sign bit flipped for positive values and all bits for
+// negative ones order like the numbers; 0 is left for missing values
+std::uint64_t numberKey(std::string_view s)
+{
+    s = trim(s);
+    if (!s.empty() && s.front() == '+')
+    {
+        s.remove_prefix(1);
+    }
+    double value = 0;
+    if (!parseNumber(s, value))
+    {
+        return 0;
+    }
+    value = value == 0 ? 0.0 : value;  // -0 and 0 are equal
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits >> 63 ? ~bits : bits | (std::uint64_t(1) << 63);
+}
+
+// Up to six runs of digits read as year, month, day, hour, minute, second,
+// packed as decimal digits; 0 if there are fewer than three
+std::uint64_t dateKey(std::string_view s)
+{
+    std::uint64_t parts[6] = {};
+    int count = 0;
+    std::size_t k = 0;
+    while (count < 6 && k < s.size())
+    {
+        if (s[k] < '0' || s[k] > '9')
+        {
+            ++k;
+            continue;
+        }
+        std::uint64_t value = 0;
+        for (int digits = 0; k < s.size() && s[k] >= '0' && s[k] <= '9'; ++k, ++digits)
+        {
+            value = digits < 9 ? value * 10 + static_cast<std::uint64_t>(s[k] - '0') : value;
+        }
+        parts[count++] = value;
+    }
+    if (count < 3)
+    {
+        return 0;
+    }
+    std::uint64_t key = parts[0];
+    for (int p = 1; p < 6; ++p)
+    {
+        key = key * 100 + std::min<std::uint64_t>(parts[p], 99);
+    }
+    return key + 1;
+}
+
+std::size_t keyWidth(const CsvKeyColumn &key)
+{
+    return key.type == CsvKeyType::String ? key.width : 8;
+}
+
+// Writes the key of one row; returns 1 + the index of the first key whose
+// string was longer than its width, or 0
+unsigned encodeRow(const RowFields &row, const std::vector<CsvKeyColumn> &keys, unsigned char *out)
+{
+    unsigned cut = 0;
+    for (std::size_t k = 0; k < keys.size(); ++k)
+    {
+        const CsvKeyColumn &key = keys[k];
+        std::string_view field = row.fields[key.column];
+        std::size_t width = keyWidth(key);
+        if (key.type == CsvKeyType::String)
+        {
+            std::size_t used = std::min(field.size(), width);
+            std::memcpy(out, field.data(), used);
+            std::memset(out + used, 0, width - used);
+            cut = cut == 0 && field.size() > width ? static_cast<unsigned>(k + 1) : cut;
+        }
+        else
+        {
+            putBigEndian(out, key.type == CsvKeyType::Numeric ? numberKey(field) : dateKey(field));
+        }
+        if (key.descending)
+        {
+            for (std::size_t b = 0; b < width; ++b)
+            {
+                out[b] = static_cast<unsigned char>(~out[b]);
+            }
+        }
+        out += width;
+    }
+    return cut;
+}
+
+void insertionSortRecords(unsigned char *a, std::size_t n, std::size_t width, std::size_t depth, unsigned char *tmp)
+{
+    std::size_t rest = width - depth;
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        unsigned char *x = a + i * width;
+        if (std::memcmp(x - width + depth, x + depth, rest) <= 0)
+        {
+            continue;
+        }
+        std::memcpy(tmp, x, width);
+        std::size_t j = i;
+        while (j > 0 && std::memcmp(a + (j - 1) * width + depth, tmp + depth, rest) > 0)
+        {
+            std::memcpy(a + j * width, a + (j - 1) * width, width);
+            --j;
+        }
+        std::memcpy(a + j * width, tmp, width);
+    }
+}
+
+// Moves the records from `from` to `to`, split by their byte at `depth`
+// into buckets [bounds[b], bounds[b + 1]); false, with nothing moved, if
+// they all share that byte
+bool distribute(const unsigned char *from, unsigned char *to, std::size_t n, std::size_t width, std::size_t depth,
+                std::size_t bounds[257])
+{
+    std::size_t count[256] = {};
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        ++count[from[k * width + depth]];
+    }
+    if (count[from[depth]] == n)
+    {
+        return false;
+    }
+    bounds[0] = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+        bounds[b + 1] = bounds[b] + count[b];
+    }
+    std::size_t next[256];
+    std::copy(bounds, bounds + 256, next);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        const unsigned char *record = from + k * width;
+        std::memcpy(to + next[record[depth]]++ * width, record, width);
+    }
+    return true;
+}
+
+// Sorts the records at `a` by bytes [depth, width) using `other`, an equal
+// area, as the other half of each split; they end up in `other` if
+// `toOther` is set, in `a` otherwise. Splits alternate between the two
+// areas, so no level copies its records back.
+void radixSortRecords(unsigned char *a, unsigned char *other, std::size_t n, std::size_t width, std::size_t depth,
+                      bool toOther)
+{
+    std::size_t bounds[257];
+    while (n > kInsertion && depth < width)
+    {
+        if (!distribute(a, other, n, width, depth, bounds))
+        {
+            ++depth;
+            continue;
+        }
+        for (int b = 0; b < 256; ++b)
+        {
+            std::size_t offset = bounds[b] * width;
+            std::size_t size = bounds[b + 1] - bounds[b];
+            if (size > 1)
+            {
+                radixSortRecords(other + offset, a + offset, size, width, depth + 1, !toOther);
+            }
+            else if (size == 1 && !toOther)
+            {
+                std::memcpy(a + offset, other + offset, width);
+            }
+        }
+        return;
+    }
+    if (depth < width)
+    {
+        insertionSortRecords(a, n, width, depth, other);
+    }
+    if (toOther)
+    {
+        std::memcpy(other, a, n * width);
+    }
+}
+
+// The first byte at which the records are not all equal, or width
+std::size_t firstDifference(const unsigned char *a, std::size_t n, std::size_t width)
+{
+    std::vector<unsigned char> differs(width);
+    for (std::size_t k = 1; k < n; ++k)
+    {
+        for (std::size_t b = 0; b < width; ++b)
+        {
+            differs[b] |= a[k * width + b] ^ a[b];
+        }
+    }
+    return static_cast<std::size_t>(std::find_if(differs.begin(), differs.end(), [](unsigned char d) { return d; }) -
+                                    differs.begin());
+}
+
+// MSD radix sort of n records of `width` bytes. Bytes all records share,
+// like the high bytes of dates and small numbers, are found in one pass;
+// the first split after them is shared out to the threads by bucket,
+// largest first.
+void sortRecords(unsigned char *a, std::size_t n, std::size_t width, unsigned threads)
+{
+    std::size_t depth = firstDifference(a, n, width);
+    if (depth == width)
+    {
+        return;  // All equal
+    }
+    std::vector<unsigned char> scratch(n * width);
+    std::size_t bounds[257];
+    if (threads <= 1 || n <= kInsertion || !distribute(a, scratch.data(), n, width, depth, bounds))
+    {
+        radixSortRecords(a, scratch.data(), n, width, depth, false);
+        return;
+    }
+
+    std::vector<int> buckets(256);
+    std::iota(buckets.begin(), buckets.end(), 0);
+    std::sort(buckets.begin(), buckets.end(),
+              [&](int x, int y) { return bounds[x + 1] - bounds[x] > bounds[y + 1] - bounds[y]; });
+    std::atomic<int> next{0};
+    onThreads(threads, [&](unsigned) {
+        for (int k = next++; k < 256; k = next++)
+        {
+            std::size_t offset = bounds[buckets[k]] * width;
+            std::size_t size = bounds[buckets[k] + 1] - bounds[buckets[k]];
+            radixSortRecords(scratch.data() + offset, a + offset, size, width, depth + 1, true);
+        }
+    });
+}
+
+// The records are in key order, but where a string was cut short at key c
+// the rows sharing its prefix are not ordered from c on. Each such run,
+// equal up to the end of key c, is sorted again on the whole fields, with
+// the other keys compared by their encoding. cutAt[k] is encodeRow()'s
+// answer for the record at k, whose row is order[k].
+void sortCutRuns(const char *text, const std::vector<std::uint64_t> &starts, const CsvSortOptions &options,
+                 std::size_t columns, const unsigned char *records, std::size_t record,
+                 const std::vector<std::uint16_t> &cutAt, std::uint32_t *order)
+{
+    struct Tied
+    {
+        std::uint32_t row;
+        const unsigned char *key;
+        std::vector<std::string> strings;  // Whole fields of the string keys
+    };
+    const std::vector<CsvKeyColumn> &keys = options.keys;
+    auto less = [&](const Tied &x, const Tied &y) {
+        std::size_t offset = 0;
+        std::size_t s = 0;
+        for (const CsvKeyColumn &key : keys)
+        {
+            int c;
+            if (key.type == CsvKeyType::String)
+            {
+                c = x.strings[s].compare(y.strings[s]);
+                c = key.descending ? -c : c;
+                ++s;
+            }
+            else
+            {
+                c = std::memcmp(x.key + offset, y.key + offset, keyWidth(key));
+            }
+            if (c != 0)
+            {
+                return c < 0;
+            }
+            offset += keyWidth(key);
+        }
+        return x.row < y.row;
+    };
+
+    std::size_t n = cutAt.size();
+    std::vector<unsigned char> done(n);  // Inside a run already sorted again; runs of later keys nest in it
+    RowFields fields;
+    std::vector<Tied> tied;
+    std::size_t end = 0;
+    for (std::size_t c = 0; c < keys.size(); ++c)
+    {
+        end += keyWidth(keys[c]);
+        if (std::find(cutAt.begin(), cutAt.end(), c + 1) == cutAt.end())
+        {
+            continue;
+        }
+        for (std::size_t i = 0, j; i < n; i = j)
+        {
+            bool wasCut = cutAt[i] == c + 1;
+            for (j = i + 1; j < n && std::memcmp(records + i * record, records + j * record, end) == 0; ++j)
+            {
+                wasCut = wasCut || cutAt[j] == c + 1;
+            }
+            if (!wasCut || j - i < 2 || done[i])
+            {
+                continue;
+            }
+            tied.clear();
+            for (std::size_t k = i; k < j; ++k)
+            {
+                fields.split(text + starts[order[k]], text + starts[order[k] + 1], options.delimiter, columns);
+                Tied entry{order[k], records + k * record, {}};
+                for (const CsvKeyColumn &key : keys)
+                {
+                    if (key.type == CsvKeyType::String)
+                    {
+                        entry.strings.emplace_back(fields.fields[key.column]);
+                    }
+                }
+                tied.push_back(std::move(entry));
+            }
+            std::sort(tied.begin(), tied.end(), less);
+            for (std::size_t k = i; k < j; ++k)
+            {
+                order[k] = tied[k - i].row;
+                done[k] = 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool parseCsvKey(const std::string &spec, CsvKeyColumn &key)
+{
+    key = CsvKeyColumn();
+    std::size_t k = 0;
+    unsigned column = 0;
+    for (; k < spec.size() && spec[k] >= '0' && spec[k] <= '9'; ++k)
+    {
+        column = column * 10 + static_cast<unsigned>(spec[k] - '0');
+    }
+    if (k == 0 || column == 0)
+    {
+        return false;
+    }
+    key.column = column - 1;
+    for (; k < spec.size() && spec[k] != ':'; ++k)
+    {
+        switch (spec[k])
+        {
+        case 'n':
+            key.type = CsvKeyType::Numeric;
+            break;
+        case 'd':
+            key.type = CsvKeyType::Date;
+            break;
+        case 's':
+            key.type = CsvKeyType::String;
+            break;
+        case 'r':
+            key.descending = true;
+            break;
+        default:
+            return false;
+        }
+    }
+    if (k < spec.size())
+    {
+        if (key.type != CsvKeyType::String || k + 1 == spec.size())
+        {
+            return false;
+        }
+        key.width = static_cast<std::size_t>(std::strtoull(spec.c_str() + k + 1, nullptr, 10));
+    }
+    return key.width > 0;
+}
+
+std::vector<std::uint64_t> csvRowStarts(const char *text, std::size_t size, unsigned threads)
+{
+    if (size == 0)
+    {
+        return {0};
+    }
+
+    // A quote may hide a line break, and whether a chunk starts inside quotes
+    // depends on every quote before it. So each chunk keeps its breaks in two
+    // lists, by whether an even or odd number of its own quotes precede them,
+    // and the quote counts of the chunks before pick the list that holds the
+    // real row breaks. The first chunk starts outside quotes and collects
+    // straight into the result.
+    threads = threadCount(threads, size, kMinChunkBytes);
+    std::vector<std::vector<std::uint64_t>> parts(2 * threads);
+    std::vector<unsigned char> oddQuotes(threads, 0);
+    onThreads(threads, [&](unsigned t) {
+        const char *p = text + size * t / threads;
+        const char *end = text + size * (t + 1) / threads;
+        const char *last = text + size - 1;  // A break there ends the last row instead of starting one
+        std::vector<std::uint64_t> even, odd;
+        if (t == 0)
+        {
+            even.push_back(0);
+        }
+        unsigned parity = 0;
+        if (!std::memchr(p, '"', static_cast<std::size_t>(end - p)))  // Every break counts; skip to each
+        {
+            while ((p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) &&
+                   p < last)
+            {
+                even.push_back(static_cast<std::uint64_t>(++p - text));
+            }
+        }
+        else
+        {
+            for (const char *stop = std::min(end, last); p < stop; ++p)
+            {
+                char c = *p;
+                parity ^= c == '"';
+                if (c == '\n')
+                {
+                    if (parity)
+                    {
+                        odd.push_back(static_cast<std::uint64_t>(p + 1 - text));
+                    }
+                    else
+                    {
+                        even.push_back(static_cast<std::uint64_t>(p + 1 - text));
+                    }
+                }
+            }
+            for (; p < end; ++p)
+            {
+                parity ^= *p == '"';  // The last byte: no row starts after it
+            }
+        }
+        parts[2 * t] = std::move(even);
+        parts[2 * t + 1] = std::move(odd);
+        oddQuotes[t] = static_cast<unsigned char>(parity);
+    });
+
+    std::vector<std::uint64_t> starts = std::move(parts[0]);
+    unsigned quoted = oddQuotes[0];
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        const std::vector<std::uint64_t> &part = parts[2 * t + quoted];
+        starts.insert(starts.end(), part.begin(), part.end());
+        quoted ^= oddQuotes[t];
+    }
+    starts.push_back(size);
+    return starts;
+}
+
+bool sortCsvRows(const char *text, const std::vector<std::uint64_t> &starts, const CsvSortOptions &options,
+                 std::vector<std::uint32_t> &order, std::string *error)
+{
+    std::size_t rows = starts.empty() ? 0 : starts.size() - 1;
+    if (rows > UINT32_MAX || options.keys.size() > UINT16_MAX)
+    {
+        if (error)
+        {
+            *error = rows > UINT32_MAX ? "more than 2^32 - 1 rows" : "too many keys";
+        }
+        return false;
+    }
+    std::size_t columns = 0;
+    std::size_t width = 0;
+    for (const CsvKeyColumn &key : options.keys)
+    {
+        if (key.type == CsvKeyType::String && key.width == 0)
+        {
+            if (error)
+            {
+                *error = "a string key needs a width of at least one byte";
+            }
+            return false;
+        }
+        columns = std::max<std::size_t>(columns, key.column + 1);
+        width += keyWidth(key);
+    }
+
+    std::size_t first = options.header && rows > 0 ? 1 : 0;
+    std::size_t n = rows - first;
+    std::size_t record = width + 4;  // Key, then the row index, big-endian
+    std::vector<unsigned char> records(n * record);
+    std::vector<std::uint16_t> cut(n);
+
+    unsigned threads = threadCount(options.threads, n, kMinChunkRows);
+    onThreads(threads, [&](unsigned t) {
+        RowFields fields;
+        for (std::size_t k = n * t / threads; k < n * (t + 1) / threads; ++k)
+        {
+            std::size_t row = first + k;
+            fields.split(text + starts[row], text + starts[row + 1], options.delimiter, columns);
+            unsigned char *out = records.data() + k * record;
+            cut[k] = static_cast<std::uint16_t>(encodeRow(fields, options.keys, out));
+            for (int b = 0; b < 4; ++b)
+            {
+                out[width + b] = static_cast<unsigned char>(row >> (24 - 8 * b));
+            }
+        }
+    });
+
+    sortRecords(records.data(), n, record, threads);
+
+    order.resize(rows);
+    if (first)
+    {
+        order[0] = 0;
+    }
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        const unsigned char *r = records.data() + k * record + width;
+        order[first + k] = std::uint32_t(r[0]) << 24 | std::uint32_t(r[1]) << 16 | std::uint32_t(r[2]) << 8 | r[3];
+    }
+
+    if (std::any_of(cut.begin(), cut.end(), [](std::uint16_t c) { return c != 0; }))
+    {
+        std::vector<std::uint16_t> cutAt(n);
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            cutAt[k] = cut[order[first + k] - first];
+        }
+        sortCutRuns(text, starts, options, columns, records.data(), record, cutAt, order.data() + first);
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef CSVSORT_H
+#define CSVSORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class CsvKeyType
+{
+    String,   // Bytes, compared as they are
+    Numeric,  // Decimal or floating point; empty or unparsable fields sort first
+    Date      // Year, month, day and optional hour, minute, second, as in ISO 8601
+};
+
+struct CsvKeyColumn
+{
+    unsigned column = 0;  // From 0
+    CsvKeyType type = CsvKeyType::String;
+    bool descending = false;
+    std::size_t width = 16;  // String keys: leading bytes kept in the key
+};
+
+// Parses a key written like sort -k: a column counted from 1, then n for
+// numeric or d for date (string otherwise), then r for descending, and for
+// strings optionally :WIDTH, as in "3", "2nr" or "1r:32"
+bool parseCsvKey(const std::string &spec, CsvKeyColumn &key);
+
+struct CsvSortOptions
+{
+    std::vector<CsvKeyColumn> keys;  // Most significant first
+    char delimiter = ',';
+    bool header = false;   // The first row stays first
+    unsigned threads = 0;  // 0 means one per core
+};
+
+// Where each row of CSV text starts, plus `size` at the end, so row r is
+// [starts[r], starts[r + 1]) including its line break. Quoted fields may
+// hold line breaks. The text is split on all cores either way.
+std::vector<std::uint64_t> csvRowStarts(const char *text, std::size_t size, unsigned threads = 0);
+
+// The rows in sorted order. Every row's key columns are parsed once into a
+// fixed-width key that compares with memcmp in the requested order:
+// numbers and dates as order-preserving big-endian integers, strings as
+// their first `width` bytes, descending columns inverted. The row index is
+// appended, which makes the sort stable, and the records are sorted with an
+// MSD radix sort; only rows whose keys tie after a string was cut short are
+// compared again on the full fields. False, with `error` set, if a key is
+// invalid or there are more than 2^32 - 1 rows.
+bool sortCsvRows(const char *text, const std::vector<std::uint64_t> &starts, const CsvSortOptions &options,
+                 std::vector<std::uint32_t> &order, std::string *error = nullptr);
+
+#endif // CSVSORT_H
@@ -0,0 +1,168 @@
+#include "editsort.h"
+#include "quicksort.h"
+#include <algorithm>
+#include <cstring>
+
+template <typename Trace>
+std::size_t editSorted(int *a, std::size_t n, std::size_t i, int value, Trace &trace)
+{
+    // First position in [lo, hi) whose value is greater than `value`
+    auto upper = [&](std::size_t lo, std::size_t hi) {
+        while (lo < hi)
+        {
+            std::size_t mid = lo + (hi - lo) / 2;
+            trace.read(mid);
+            if (value < a[mid])
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    };
+
+    std::size_t to;
+    if (value >= a[i])
+    {
+        // Moves right past every value that is now smaller or equal
+        to = upper(i + 1, n) - 1;
+        if (to > i)
+        {
+            trace.mark(TagRange, i, to);
+            if (Trace::enabled)
+            {
+                for (std::size_t k = i; k < to; ++k)
+                {
+                    a[k] = a[k + 1];
+                    trace.write(k, a[k]);
+                }
+            }
+            else
+            {
+                std::memmove(a + i, a + i + 1, (to - i) * sizeof(int));
+            }
+        }
+    }
+    else
+    {
+        // Moves left past every value that is now bigger
+        to = upper(0, i);
+        if (to < i)
+        {
+            trace.mark(TagRange, to, i);
+            if (Trace::enabled)
+            {
+                for (std::size_t k = i; k > to; --k)
+                {
+                    a[k] = a[k - 1];
+                    trace.write(k, a[k]);
+                }
+            }
+            else
+            {
+                std::memmove(a + to + 1, a + to, (i - to) * sizeof(int));
+            }
+        }
+    }
+    a[to] = value;
+    trace.write(to, value);
+    return to;
+}
+
+std::size_t editSorted(int *a, std::size_t n, std::size_t i, int value)
+{
+    NullTrace trace;
+    return editSorted(a, n, i, value, trace);
+}
+
+template <typename Trace>
+EditRange applyEdits(int *a, std::size_t n, std::vector<ValueEdit> edits, Trace &trace)
+{
+    if (edits.empty())
+    {
+        return {0, 0};
+    }
+    // One edit per index, the last one given
+    std::stable_sort(edits.begin(), edits.end(),
+                     [](const ValueEdit &x, const ValueEdit &y) { return x.index < y.index; });
+    std::size_t kept = 0;
+    for (std::size_t e = 0; e < edits.size(); ++e)
+    {
+        if (e + 1 < edits.size() && edits[e + 1].index == edits[e].index)
+        {
+            continue;
+        }
+        edits[kept++] = edits[e];
+    }
+    edits.resize(kept);
+    std::size_t k = edits.size();
+
+    std::vector<int> fresh(k);
+    for (std::size_t e = 0; e < k; ++e)
+    {
+        fresh[e] = edits[e].value;
+    }
+    // The new values are not in the array yet, so they are sorted untraced
+    quicksort(fresh.data(), k);
+
+    // Squeeze out the edited positions; everything below the first stays
+    std::size_t first = edits.front().index;
+    std::size_t last = edits.back().index + 1;
+    std::size_t w = first;
+    std::size_t e = 0;
+    for (std::size_t r = first; r < n; ++r)
+    {
+        if (e < k && edits[e].index == r)
+        {
+            ++e;
+            continue;
+        }
+        if (w != r)
+        {
+            a[w] = a[r];
+            trace.write(w, a[w]);
+        }
+        ++w;
+    }
+
+    // Merge from the back: the kept values shift up to make room, and the
+    // merge stops as soon as the smallest new value is placed
+    std::size_t out = n;
+    std::size_t i = w;
+    std::size_t j = k;
+    while (j > 0)
+    {
+        --out;
+        if (i > 0)
+        {
+            trace.compare(i - 1, out);
+        }
+        if (i > 0 && a[i - 1] > fresh[j - 1])
+        {
+            a[out] = a[--i];
+        }
+        else
+        {
+            a[out] = fresh[--j];
+            last = std::max(last, out + 1);
+        }
+        trace.write(out, a[out]);
+    }
+    return {std::min(first, out), last};
+}
+
+EditRange applyEdits(int *a, std::size_t n, std::vector<ValueEdit> edits)
+{
+    NullTrace trace;
+    return applyEdits(a, n, std::move(edits), trace);
+}
+
+template std::size_t editSorted<SortTrace>(int *, std::size_t, std::size_t, int, SortTrace &);
+template std::size_t editSorted<NullTrace>(int *, std::size_t, std::size_t, int, NullTrace &);
+template std::size_t editSorted<StreamingTrace>(int *, std::size_t, std::size_t, int, StreamingTrace &);
+template EditRange applyEdits<SortTrace>(int *, std::size_t, std::vector<ValueEdit>, SortTrace &);
+template EditRange applyEdits<NullTrace>(int *, std::size_t, std::vector<ValueEdit>, NullTrace &);
+template EditRange applyEdits<StreamingTrace>(int *, std::size_t, std::vector<ValueEdit>, StreamingTrace &);
@@ -0,0 +1,43 @@
+#ifndef EDITSORT_H
+#define EDITSORT_H
+
+#include "sorttrace.h"
+#include <cstddef>
+#include <vector>
+
+// Keeping a sorted array sorted while its values are edited, without
+// sorting it again.
+
+struct ValueEdit
+{
+    std::size_t index;
+    int value;
+};
+
+// Positions [first, last) of the array that an edit may have changed
+struct EditRange
+{
+    std::size_t first;
+    std::size_t last;
+};
+
+// a[0, n) is sorted. Replaces a[i] with `value` and moves it to where it
+// now belongs: a binary search on the side it moves towards, then one
+// memmove of the values in between. O(log n + distance moved). In the trace
+// the probes are Reads, the shifted range is marked, and every shifted value
+// is a Write. Returns where the value ended up.
+template <typename Trace>
+std::size_t editSorted(int *a, std::size_t n, std::size_t i, int value, Trace &trace);
+std::size_t editSorted(int *a, std::size_t n, std::size_t i, int value);
+
+// a[0, n) is sorted. Applies all edits at once and restores the order: the
+// edited positions are squeezed out, the new values are sorted on their
+// own, and they are merged into the rest from the back, so nothing below
+// the lowest edited or inserted position moves. O(n + k log k) for k edits,
+// against O(n log n) for sorting again; when an index is edited more than
+// once the last edit wins.
+template <typename Trace>
+EditRange applyEdits(int *a, std::size_t n, std::vector<ValueEdit> edits, Trace &trace);
+EditRange applyEdits(int *a, std::size_t n, std::vector<ValueEdit> edits);
+
+#endif // EDITSORT_H
@@ -0,0 +1,188 @@
+#include "heapsort.h"
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// Moves the key at heap position `root` down until no child is bigger. The
+// heap occupies a[first, first + size) and node k has children
+// Arity * k + 1 ... Arity * k + Arity. The key travels as a hole: each step
+// writes one child up instead of swapping.
+template <unsigned Arity, typename Trace>
+void siftDown(int *a, std::size_t first, std::size_t root, std::size_t size, Trace &trace)
+{
+    int *heap = a + first;
+    int key = heap[root];
+    while (true)
+    {
+        std::size_t child = Arity * root + 1;
+        if (child >= size)
+        {
+            break;
+        }
+        std::size_t end = child + Arity < size ? child + Arity : size;
+        std::size_t biggest = child;
+        for (std::size_t c = child + 1; c < end; ++c)
+        {
+            trace.compare(first + biggest, first + c);
+            biggest = heap[biggest] < heap[c] ? c : biggest;
+        }
+        trace.compare(first + root, first + biggest);
+        if (!(key < heap[biggest]))
+        {
+            break;
+        }
+        heap[root] = heap[biggest];
+        trace.write(first + root, heap[root]);
+        root = biggest;
+    }
+    heap[root] = key;
+    trace.write(first + root, key);
+}
+
+// Floyd's variant of siftDown(root = 0) for the sort-down phase. The key at
+// the top came from the bottom and almost always sinks back there, so the
+// hole first runs all the way down along the biggest children without
+// testing the key, which keeps that loop free of unpredictable exits, and
+// the key then climbs back up the few levels it has to.
+template <unsigned Arity, typename Trace>
+void siftTopToLeaf(int *a, std::size_t first, std::size_t size, Trace &trace)
+{
+    int *heap = a + first;
+    int key = heap[0];
+    std::size_t hole = 0;
+    while (true)
+    {
+        std::size_t child = Arity * hole + 1;
+        if (child >= size)
+        {
+            break;
+        }
+        std::size_t end = child + Arity < size ? child + Arity : size;
+        std::size_t biggest = child;
+        for (std::size_t c = child + 1; c < end; ++c)
+        {
+            trace.compare(first + biggest, first + c);
+            biggest = heap[biggest] < heap[c] ? c : biggest;
+        }
+        heap[hole] = heap[biggest];
+        trace.write(first + hole, heap[hole]);
+        hole = biggest;
+    }
+    heap[hole] = key;
+    trace.write(first + hole, key);
+    while (hole > 0)
+    {
+        std::size_t parent = (hole - 1) / Arity;
+        trace.compare(first + parent, first + hole);
+        if (!(heap[parent] < heap[hole]))
+        {
+            break;
+        }
+        std::swap(heap[parent], heap[hole]);
+        trace.swap(first + parent, first + hole);
+        hole = parent;
+    }
+}
+
+template <unsigned Arity, typename Trace>
+void makeHeapArity(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    std::size_t n = last - first;
+    if (n < 2)
+    {
+        return;
+    }
+    trace.mark(TagHeap, first, last - 1);
+    for (std::size_t root = (n - 2) / Arity + 1; root-- > 0;)
+    {
+        siftDown<Arity>(a, first, root, n, trace);
+    }
+}
+
+template <unsigned Arity, typename Trace>
+void sortHeapArity(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    for (std::size_t size = last - first; size-- > 1;)
+    {
+        std::swap(a[first], a[first + size]);
+        trace.swap(first, first + size);
+        if (size > 1)
+        {
+            trace.mark(TagHeap, first, first + size - 1);
+        }
+        siftTopToLeaf<Arity>(a, first, size, trace);
+    }
+}
+
+// Calls f with the supported arity that `arity` rounds up to, as a constant
+template <typename F>
+void withArity(unsigned arity, F &&f)
+{
+    if (arity <= 2)
+    {
+        f(std::integral_constant<unsigned, 2>());
+    }
+    else if (arity <= 4)
+    {
+        f(std::integral_constant<unsigned, 4>());
+    }
+    else
+    {
+        f(std::integral_constant<unsigned, 8>());
+    }
+}
+
+} // namespace
+
+template <typename Trace>
+void heapSortRange(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity)
+{
+    withArity(arity, [&](auto d) {
+        makeHeapArity<decltype(d)::value>(a, first, last, trace);
+        sortHeapArity<decltype(d)::value>(a, first, last, trace);
+    });
+}
+
+void heapSort(int *a, std::size_t n, unsigned arity)
+{
+    NullTrace trace;
+    heapSortRange(a, 0, n, trace, arity);
+}
+
+template <typename Trace>
+void makeHeap(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity)
+{
+    withArity(arity, [&](auto d) { makeHeapArity<decltype(d)::value>(a, first, last, trace); });
+}
+
+template <typename Trace>
+void siftHeapTop(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity)
+{
+    if (last > first)
+    {
+        withArity(arity, [&](auto d) { siftTopToLeaf<decltype(d)::value>(a, first, last - first, trace); });
+    }
+}
+
+template <typename Trace>
+void sortHeap(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity)
+{
+    withArity(arity, [&](auto d) { sortHeapArity<decltype(d)::value>(a, first, last, trace); });
+}
+
+template void heapSortRange<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void heapSortRange<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void heapSortRange<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
+
+template void makeHeap<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void makeHeap<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void makeHeap<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
+
+template void siftHeapTop<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void siftHeapTop<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void siftHeapTop<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
+
+template void sortHeap<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void sortHeap<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void sortHeap<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
@@ -0,0 +1,31 @@
+#ifndef HEAPSORT_H
+#define HEAPSORT_H
+
+#include "sorttrace.h"
+#include <cstddef>
+
+// Max-heap sort of a[first, last) with absolute indices, so it can finish a
+// sub-range of a larger sort and still line up with its trace. O(n log n)
+// whatever the input, which makes it the fallback of quicksort.
+//
+// `arity` is 2, 4 or 8 children per node (anything else rounds up to one of
+// those). The children of a node are contiguous, so a wider heap reads one
+// or two cache lines per level instead of one per comparison, and has
+// log2(arity) times fewer levels; it pays with more comparisons per level.
+// 4 halves the L1 misses of a binary heap and is the fastest of the three.
+template <typename Trace>
+void heapSortRange(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity = 4);
+void heapSort(int *a, std::size_t n, unsigned arity = 4);
+
+// The pieces of heapSortRange, for callers that keep a heap of their own:
+// makeHeap arranges a[first, last) as a max-heap, siftHeapTop restores the
+// heap after a[first] was replaced, and sortHeap sorts a range that is
+// already a heap.
+template <typename Trace>
+void makeHeap(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity = 4);
+template <typename Trace>
+void siftHeapTop(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity = 4);
+template <typename Trace>
+void sortHeap(int *a, std::size_t first, std::size_t last, Trace &trace, unsigned arity = 4);
+
+#endif // HEAPSORT_H
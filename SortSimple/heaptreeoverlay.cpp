@@ -0,0 +1,58 @@
+#include "heaptreeoverlay.h"
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+
+HeapTreeOverlay::HeapTreeOverlay(const std::vector<QLabel *> &bars, QWidget *parent) : QWidget(parent), bars(bars)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_NoSystemBackground);
+    hide();
+}
+
+void HeapTreeOverlay::showHeap(unsigned arity, int first, int last)
+{
+    this->arity = arity;
+    this->first = first;
+    this->last = last;
+    setGeometry(parentWidget()->rect());
+    raise();
+    show();
+    update();
+}
+
+void HeapTreeOverlay::clear()
+{
+    last = first - 1;
+    hide();
+}
+
+QPointF HeapTreeOverlay::topCenter(int bar) const
+{
+    QLabel *label = bars[bar];
+    return mapFromGlobal(label->mapToGlobal(QPointF(label->width() / 2.0, 0)));
+}
+
+void HeapTreeOverlay::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(QColor(255, 255, 255, 200), 2));
+
+    // Heap node k sits on bar first + k; its children are arity * k + 1 on.
+    // Arcs rise above the bars, higher the further apart the two nodes are.
+    int size = last - first + 1;
+    for (int node = 0; node < size; ++node)
+    {
+        QPointF from = topCenter(first + node);
+        for (int child = int(arity) * node + 1; child <= int(arity) * node + int(arity) && child < size; ++child)
+        {
+            QPointF to = topCenter(first + child);
+            QPointF control((from.x() + to.x()) / 2, std::min(from.y(), to.y()) - (to.x() - from.x()) / 3);
+            QPainterPath arc(from);
+            arc.quadTo(control, to);
+            painter.drawPath(arc);
+        }
+        painter.drawEllipse(from, 4, 4);
+    }
+}
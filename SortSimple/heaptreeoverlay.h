@@ -0,0 +1,31 @@
+#ifndef HEAPTREEOVERLAY_H
+#define HEAPTREEOVERLAY_H
+
+#include <QLabel>
+#include <QWidget>
+#include <vector>
+
+// Transparent layer over the bars that draws the implicit tree of a d-ary
+// heap: an arc from every node to each of its children, for the part of
+// the array that is still a heap. Sits on top of the bars' parent widget.
+class HeapTreeOverlay : public QWidget
+{
+public:
+    HeapTreeOverlay(const std::vector<QLabel *> &bars, QWidget *parent);
+
+    void showHeap(unsigned arity, int first, int last);  // The heap is bars[first, last]
+    void clear();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QPointF topCenter(int bar) const;
+
+    const std::vector<QLabel *> &bars;
+    unsigned arity = 2;
+    int first = 0;
+    int last = -1;
+};
+
+#endif // HEAPTREEOVERLAY_H
@@ -0,0 +1,377 @@
+#include "inputloader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <intrin.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path, Mode mode)
+{
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    fileHandle = file;
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    if (length == 0)
+    {
+        return true; // Windows refuses to map empty files
+    }
+
+    mappingHandle = CreateFileMappingA(file, nullptr, mode == CopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0,
+                                       nullptr);
+    if (mappingHandle)
+    {
+        bytes = static_cast<char *>(
+            MapViewOfFile(mappingHandle, mode == CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!bytes)
+    {
+        error = "cannot map " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+    {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle)
+    {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle)
+    {
+        CloseHandle(fileHandle);
+    }
+    bytes = nullptr;
+    mappingHandle = fileHandle = nullptr;
+    length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path, Mode mode)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        error = "cannot stat " + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length == 0)
+    {
+        ::close(fd);
+        return true; // mmap rejects zero-length mappings
+    }
+
+    int protection = mode == CopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *mapping = mmap(nullptr, length, protection, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED)
+    {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        length = 0;
+        return false;
+    }
+    // Advice values are not flags; each takes its own call. A read-only
+    // mapping is parsed front to back, a writable one is sorted in place.
+    if (mode != CopyOnWrite)
+    {
+        madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+    madvise(mapping, length, MADV_WILLNEED);
+    bytes = static_cast<char *>(mapping);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+    {
+        munmap(bytes, length);
+    }
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
+
+namespace {
+
+constexpr std::size_t kMinChunkBytes = 1 << 20;
+constexpr std::uint64_t kAsciiZeros = 0x3030303030303030ULL;
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+std::uint64_t load8(const char *p)
+{
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v; // Little-endian: the first character is the lowest byte
+}
+
+// Number of leading ASCII digits in an eight-byte word, all lanes at once.
+// A byte is a digit when neither byte+0x46 nor byte-0x30 overflows its sign bit.
+unsigned leadingDigits(std::uint64_t v)
+{
+    std::uint64_t notDigit = ((v + 0x4646464646464646ULL) | (v - kAsciiZeros)) & 0x8080808080808080ULL;
+    if (notDigit == 0)
+    {
+        return 8;
+    }
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward64(&bit, notDigit);
+    return bit / 8;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(notDigit)) / 8;
+#endif
+}
+
+// Eight ASCII digits to their value with three multiplies (SWAR)
+std::uint32_t parseEightDigits(std::uint64_t v)
+{
+    v -= kAsciiZeros;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFULL) * 0x000F424000000064ULL) +
+         (((v >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32;
+    return static_cast<std::uint32_t>(v);
+}
+
+// `digits` (1..8) ASCII digits at the start of `v`, left-padded with '0'
+std::uint32_t parseDigits(std::uint64_t v, unsigned digits)
+{
+    if (digits < 8)
+    {
+        unsigned pad = 8 * (8 - digits);
+        v = (v << pad) | (kAsciiZeros >> (64 - pad));
+    }
+    return parseEightDigits(v);
+}
+
+const std::uint32_t kPowersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+constexpr std::uint64_t kMaxMagnitude = std::uint64_t(1) << 31;  // Of INT32_MIN
+
+// Parses [p, end). `limit` is how far eight-byte loads may safely read.
+// Returns false at the first token that is not a 32-bit integer, with `bad`
+// pointing at it.
+bool parseChunk(const char *p, const char *end, const char *limit, std::vector<std::int32_t> &out, const char *&bad)
+{
+    while (p < end)
+    {
+        if (isIntegerSeparator(*p))
+        {
+            ++p;
+            continue;
+        }
+        const char *token = p;
+        bool negative = *p == '-';
+        if (negative)
+        {
+            ++p;
+        }
+
+        const char *digits = p;
+        std::uint64_t value = 0;
+        bool tooLarge = false;
+        while (p < end && isDigit(*p))
+        {
+            if (p + 8 <= limit)
+            {
+                std::uint64_t word = load8(p);
+                unsigned count = leadingDigits(word);
+                value = value * kPowersOf10[count] + parseDigits(word, count);
+                p += count;
+                tooLarge = tooLarge || value > kMaxMagnitude;  // Checked every step, so value never wraps unseen
+                if (count < 8)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                value = value * 10 + static_cast<unsigned>(*p++ - '0');
+                tooLarge = tooLarge || value > kMaxMagnitude;
+            }
+        }
+        // Exactly an optional minus and digits, up to a separator, in range
+        if (p == digits || (p < end && !isIntegerSeparator(*p)) || tooLarge ||
+            value > (negative ? kMaxMagnitude : kMaxMagnitude - 1))
+        {
+            bad = token;
+            return false;
+        }
+        std::int64_t signedValue = negative ? -static_cast<std::int64_t>(value) : static_cast<std::int64_t>(value);
+        out.push_back(static_cast<std::int32_t>(signedValue));
+    }
+    return true;
+}
+
+} // namespace
+
+bool isIntegerSeparator(char c)
+{
+    return c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool parseTextIntegers(const char *text, std::size_t size, std::vector<std::int32_t> &values, std::string *error,
+                       unsigned threads, std::uint64_t firstLine)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, size / kMinChunkBytes + 1));
+
+    // Chunk boundaries move forward to a separator, so no token is ever
+    // split between two threads
+    const char *end = text + size;
+    std::vector<const char *> bounds(threads + 1, end);
+    bounds[0] = text;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        const char *p = std::max(bounds[t - 1], text + size / threads * t);
+        while (p < end && !isIntegerSeparator(*p))
+        {
+            ++p;
+        }
+        bounds[t] = p;
+    }
+
+    std::vector<std::vector<std::int32_t>> parts(threads);
+    std::vector<const char *> bad(threads, nullptr);
+    auto parsePart = [&](unsigned t) {
+        parts[t].reserve(static_cast<std::size_t>(bounds[t + 1] - bounds[t]) / 4);
+        parseChunk(bounds[t], bounds[t + 1], end, parts[t], bad[t]);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back(parsePart, t);
+    }
+    parsePart(0);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    // The first bad token in the text, by line
+    for (const char *token : bad)
+    {
+        if (token)
+        {
+            if (error)
+            {
+                const char *tokenEnd = token;
+                while (tokenEnd < end && !isIntegerSeparator(*tokenEnd) && tokenEnd - token < 32)
+                {
+                    ++tokenEnd;
+                }
+                std::uint64_t line = firstLine + static_cast<std::uint64_t>(std::count(text, token, '\n'));
+                *error = "line " + std::to_string(line) + ": \"" + std::string(token, tokenEnd) +
+                         "\" is not a 32-bit integer";
+            }
+            return false;
+        }
+    }
+
+    // Concatenate in parallel; each part lands at its prefix-sum offset
+    std::vector<std::size_t> offsets(threads + 1, 0);
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        offsets[t + 1] = offsets[t] + parts[t].size();
+    }
+    values.assign(offsets[threads], 0);
+    workers.clear();
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back([&, t] { std::copy(parts[t].begin(), parts[t].end(), values.begin() + offsets[t]); });
+    }
+    std::copy(parts[0].begin(), parts[0].end(), values.begin());
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    return true;
+}
+
+bool loadTextIntegers(const std::string &path, std::vector<std::int32_t> &values, std::string *error,
+                      unsigned threads)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    std::string parseError;
+    if (!parseTextIntegers(file.data(), file.size(), values, &parseError, threads))
+    {
+        if (error)
+        {
+            *error = path + ": " + parseError;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool BinaryIntegerFile::open(const std::string &path)
+{
+    if (!file.open(path, MappedFile::CopyOnWrite))
+    {
+        error = file.errorString();
+        return false;
+    }
+    if (file.size() % sizeof(std::int32_t) != 0)
+    {
+        error = path + " is not a whole number of 32-bit integers";
+        file.close();
+        return false;
+    }
+    return true;
+}
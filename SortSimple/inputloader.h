@@ -0,0 +1,71 @@
+#ifndef INPUTLOADER_H
+#define INPUTLOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A whole file mapped into memory. CopyOnWrite mappings may be modified in
+// place (sorted, for example) without the changes reaching the file.
+class MappedFile
+{
+public:
+    enum Mode { ReadOnly, CopyOnWrite };
+
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path, Mode mode = ReadOnly);
+    void close();
+
+    char *data() const { return bytes; }
+    std::size_t size() const { return length; }
+    const std::string &errorString() const { return error; }
+
+private:
+    char *bytes = nullptr;
+    std::size_t length = 0;
+    std::string error;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
+
+// Commas and whitespace
+bool isIntegerSeparator(char c);
+
+// Parses decimal integers separated by runs of isIntegerSeparator() bytes.
+// The text is split into one chunk per thread at separator boundaries and
+// each chunk is parsed eight digits at a time; `threads` 0 means one per core.
+// Every token must be an optional minus and digits that fit in 32 bits;
+// otherwise parsing fails and `error` names the line, counted from
+// `firstLine`, and the token.
+bool parseTextIntegers(const char *text, std::size_t size, std::vector<std::int32_t> &values,
+                       std::string *error = nullptr, unsigned threads = 0, std::uint64_t firstLine = 1);
+
+// Maps `path` and parses it with parseTextIntegers
+bool loadTextIntegers(const std::string &path, std::vector<std::int32_t> &values, std::string *error = nullptr,
+                      unsigned threads = 0);
+
+// Raw native-endian 32-bit integers, used straight from a copy-on-write
+// mapping: nothing is read until the kernel touches it, and nothing is copied
+// except the pages the kernel writes to.
+class BinaryIntegerFile
+{
+public:
+    bool open(const std::string &path);
+
+    std::int32_t *data() const { return reinterpret_cast<std::int32_t *>(file.data()); }
+    std::size_t size() const { return file.size() / sizeof(std::int32_t); }
+    const std::string &errorString() const { return error; }
+
+private:
+    MappedFile file;
+    std::string error;
+};
+
+#endif // INPUTLOADER_H
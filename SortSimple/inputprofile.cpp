@@ -0,0 +1,178 @@
+#include "inputprofile.h"
+#include "countingsort.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kSampleSize = 1024;
+constexpr std::size_t kMinChunk = 1 << 16;
+
+struct ChunkStats
+{
+    std::size_t descents = 0;
+    int minValue = 0;
+    int maxValue = 0;
+};
+
+ChunkStats scanChunk(const int *a, std::size_t first, std::size_t last)
+{
+    ChunkStats stats;
+    stats.minValue = stats.maxValue = a[first];
+    for (std::size_t k = first + 1; k < last; ++k)
+    {
+        stats.descents += a[k] < a[k - 1];
+        stats.minValue = std::min(stats.minValue, a[k]);
+        stats.maxValue = std::max(stats.maxValue, a[k]);
+    }
+    return stats;
+}
+
+std::string percent(double ratio)
+{
+    char text[16];
+    std::snprintf(text, sizeof(text), "%.1f%%", ratio * 100);
+    return text;
+}
+
+} // namespace
+
+InputProfile profileInput(const int *a, std::size_t n, unsigned threads)
+{
+    InputProfile profile;
+    profile.size = n;
+    if (n == 0)
+    {
+        return profile;
+    }
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, n / kMinChunk + 1));
+    std::vector<ChunkStats> stats(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        workers.emplace_back([&, t] { stats[t] = scanChunk(a, n * t / threads, n * (t + 1) / threads); });
+    }
+    stats[0] = scanChunk(a, 0, n / threads);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    std::size_t descents = 0;
+    profile.minValue = stats[0].minValue;
+    profile.maxValue = stats[0].maxValue;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        descents += stats[t].descents;
+        std::size_t first = n * t / threads;
+        descents += t > 0 && a[first] < a[first - 1]; // Descent across the chunk boundary
+        profile.minValue = std::min(profile.minValue, stats[t].minValue);
+        profile.maxValue = std::max(profile.maxValue, stats[t].maxValue);
+    }
+    profile.runs = descents + 1;
+
+    // Fixed seed, so the same input always gets the same recommendation
+    std::mt19937_64 rng(n);
+    std::uniform_int_distribution<std::size_t> index(0, n - 1);
+    std::size_t pairs = 0, inversions = 0;
+    std::vector<int> sample(std::min(n, kSampleSize));
+    for (std::size_t s = 0; s < sample.size(); ++s)
+    {
+        std::size_t i = index(rng), j = index(rng);
+        if (i != j)
+        {
+            ++pairs;
+            inversions += (i < j) ? a[i] > a[j] : a[j] > a[i];
+        }
+        sample[s] = a[i];
+    }
+    profile.inversionRatio = pairs ? double(inversions) / pairs : 0.0;
+
+    std::sort(sample.begin(), sample.end());
+    std::size_t repeated = 0;
+    for (std::size_t s = 0; s < sample.size(); ++s)
+    {
+        bool same = (s > 0 && sample[s] == sample[s - 1]) || (s + 1 < sample.size() && sample[s] == sample[s + 1]);
+        repeated += same;
+    }
+    profile.duplicateRatio = double(repeated) / sample.size();
+    return profile;
+}
+
+KernelChoice recommendKernel(const InputProfile &profile)
+{
+    const std::size_t n = profile.size;
+    if (n <= 32)
+    {
+        return {SortKernel::Insertion,
+                "Only " + std::to_string(n) + " elements, so insertion sort wins: it has no setup cost at all."};
+    }
+
+    std::size_t averageRun = n / profile.runs;
+    if (averageRun >= 16 || profile.inversionRatio < 0.01)
+    {
+        return {SortKernel::BottomUpMerge,
+                "The input is nearly sorted (" + std::to_string(profile.runs) + " runs, " +
+                    percent(profile.inversionRatio) +
+                    " of sampled pairs inverted), so a natural merge sort reuses the existing runs."};
+    }
+
+    if (profile.range() <= n && profile.range() <= kMaxCountingSpan)
+    {
+        return {SortKernel::CountingSort,
+                "All values fall in a range of " + std::to_string(profile.range()) + ", no wider than the " +
+                    std::to_string(n) + " elements, so counting sort counts each value once and writes the runs back."};
+    }
+
+    if (profile.range() <= n)
+    {
+        return {SortKernel::BucketSort,
+                "All values fall in a range of " + std::to_string(profile.range()) +
+                    ", too wide for one table of counts but no wider than the input, so bucket sort splits them by "
+                    "their high bits in place and counting-sorts each bucket."};
+    }
+
+    if (profile.range() <= 65536)
+    {
+        unsigned bits = 0;
+        while ((std::uint64_t(1) << bits) < profile.range())
+        {
+            ++bits;
+        }
+        unsigned passes = std::max(1u, (bits + 7) / 8);
+        return {SortKernel::LsdRadix,
+                "All values fall in a range of " + std::to_string(profile.range()) + ", so radix sort needs only " +
+                    std::to_string(passes) + (passes == 1 ? " pass" : " passes") + " and never compares two keys."};
+    }
+
+    if (profile.duplicateRatio > 0.5)
+    {
+        if (n >= 4096)
+        {
+            return {SortKernel::LsdRadix,
+                    percent(profile.duplicateRatio) +
+                        " of sampled values repeat; radix sort does the same work however many keys are equal."};
+        }
+        return {SortKernel::BlockQuicksort,
+                percent(profile.duplicateRatio) +
+                    " of sampled values repeat; quicksort gathers all copies of a repeated pivot in one pass."};
+    }
+
+    if (n >= 100000)
+    {
+        return {SortKernel::LsdRadix,
+                "With " + std::to_string(n) +
+                    " unordered elements, four linear radix passes beat the n log n comparisons of a quicksort."};
+    }
+
+    return {SortKernel::StdSort,
+            "The input is unordered and small enough that an in-cache introsort is the fastest choice."};
+}
@@ -0,0 +1,32 @@
+#ifndef INPUTPROFILE_H
+#define INPUTPROFILE_H
+
+#include "sortkernels.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Cheap measurements of an input, taken before deciding how to sort it
+struct InputProfile
+{
+    std::size_t size = 0;
+    std::size_t runs = 0;            // Maximal non-descending runs (exact)
+    double inversionRatio = 0;       // Share of sampled pairs i < j with a[i] > a[j]
+    double duplicateRatio = 0;       // Share of sampled values that occur twice in the sample
+    int minValue = 0;
+    int maxValue = 0;
+    std::uint64_t range() const { return std::uint64_t(std::int64_t(maxValue) - minValue) + 1; }
+};
+
+// One parallel pass for runs and range, plus fixed-size samples for the rest
+InputProfile profileInput(const int *a, std::size_t n, unsigned threads = 0);
+
+struct KernelChoice
+{
+    SortKernel kernel;
+    std::string reason;  // One sentence for the user, naming the deciding measurement
+};
+
+KernelChoice recommendKernel(const InputProfile &profile);
+
+#endif // INPUTPROFILE_H
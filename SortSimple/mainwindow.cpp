@@ -1,4 +1,15 @@
 #include "mainwindow.h"
+#include "arrayoverview.h"
+#include "cachesim.h"
+#include "classicsorts.h"
+#include "clustersort.h"
+#include "collation.h"
+#include "countingsort.h"
+#include "heapsort.h"
+#include "heaptreeoverlay.h"
+#include "quicksort.h"
+#include "streamsort.h"
+#include "tuning.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -11,6 +22,189 @@
 #include <QResizeEvent>
 #include <QScrollArea>
 #include <QFontDatabase>
+#include <QInputDialog>
+#include <QLocale>
+#include <QStandardPaths>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// Comparisons and moves in a trace, leaving out marks and reads
+std::size_t traceWork(const SortTrace &trace)
+{
+    std::size_t work = 0;
+    for (const TraceEvent &e : trace.events())
+    {
+        work += e.type == TraceEvent::Compare || e.type == TraceEvent::Swap || e.type == TraceEvent::Write;
+    }
+    return work;
+}
+
+// Children per node of the "Heap Sort (...)" entries
+unsigned heapArityOf(const QString &algorithm)
+{
+    return algorithm.contains("8-ary") ? 8 : algorithm.contains("4-ary") ? 4 : 2;
+}
+
+// Random input for the fast-forward and large runs. The key-range kernels
+// get keys from the range each one is picked for.
+std::vector<int> largeInput(const QString &algorithm, std::size_t size, std::uint32_t seed)
+{
+    std::vector<int> input(size);
+    std::mt19937 rng(seed);
+    for (int &v : input)
+    {
+        v = static_cast<int>(rng());
+    }
+    if (algorithm == "Counting Sort" || algorithm == "Bucket Sort")
+    {
+        std::size_t span = algorithm == "Counting Sort" ? 65536 : size / 2;
+        for (int &v : input)
+        {
+            v = static_cast<int>(static_cast<unsigned>(v) % span);
+        }
+    }
+    return input;
+}
+
+// Algorithms that cannot sort an arbitrary long integer input
+bool needsDemoInput(const QString &algorithm)
+{
+    return algorithm.startsWith("String Sort") || algorithm == "Sorting Network" || algorithm.startsWith("Top") ||
+           algorithm.startsWith("Median") || algorithm.startsWith("Cluster");
+}
+
+bool isQuadratic(const QString &algorithm)
+{
+    return algorithm == "Bubble Sort" || algorithm == "Selection Sort" || algorithm == "Insertion Sort";
+}
+
+// The "Merge Sort" entry: halves are sorted before they are merged, each
+// merge going into the workspace buffer and back, so nothing is allocated
+// once the workspace is reserved
+template <typename Trace>
+void topDownMergeSort(int *a, int *aux, std::size_t lo, std::size_t hi, Trace &trace)
+{
+    if (hi - lo < 2)
+    {
+        return;
+    }
+    std::size_t mid = lo + (hi - lo) / 2;
+    topDownMergeSort(a, aux, lo, mid, trace);
+    topDownMergeSort(a, aux, mid, hi, trace);
+    trace.mark(TagRange, lo, hi - 1);
+    std::size_t i = lo, j = mid;
+    for (std::size_t k = lo; k < hi; ++k)
+    {
+        bool takeRight = i == mid;
+        if (!takeRight && j < hi)
+        {
+            trace.compare(i, j);
+            takeRight = a[j] < a[i];  // Ties go left, so equal values keep their order
+        }
+        aux[k] = takeRight ? a[j++] : a[i++];
+        trace.write(k, aux[k], 1);
+    }
+    for (std::size_t k = lo; k < hi; ++k)
+    {
+        a[k] = aux[k];
+        trace.write(k, a[k]);
+    }
+}
+
+template <typename Trace>
+void topDownMergeSort(int *a, std::size_t n, MergeWorkspace &workspace, Trace &trace)
+{
+    if (workspace.aux.size() < n)
+    {
+        workspace.reserve(n);
+    }
+    topDownMergeSort(a, workspace.aux.data(), 0, n, trace);
+}
+
+// Run the engine kernel behind `algorithm`. Returns false for the string
+// kernels, which do not sort the bar values.
+template <typename Trace>
+bool runEngineKernel(const QString &algorithm, int *a, std::size_t n, MergeWorkspace &workspace, Trace &trace,
+                     const MergeSortOptions &mergeOptions = MergeSortOptions())
+{
+    if (algorithm == "Bubble Sort")
+    {
+        bubbleSort(a, n, trace);
+    }
+    else if (algorithm == "Quick Sort")
+    {
+        lomutoQuicksort(a, n, trace);
+    }
+    else if (algorithm == "Quick Sort (Block Partition)")
+    {
+        quicksort(a, n, trace);
+    }
+    else if (algorithm == "Quick Sort (Three-Way)")
+    {
+        QuicksortOptions options;
+        options.partition = PartitionScheme::ThreeWay;
+        quicksort(a, n, trace, options);
+    }
+    else if (algorithm == "Counting Sort")
+    {
+        if (!countingSort(a, n, trace))
+        {
+            bucketSort(a, n, trace);
+        }
+    }
+    else if (algorithm == "Bucket Sort")
+    {
+        bucketSort(a, n, trace);
+    }
+    else if (algorithm == "Merge Sort")
+    {
+        topDownMergeSort(a, n, workspace, trace);
+    }
+    else if (algorithm == "Merge Sort (Bottom-Up)")
+    {
+        bottomUpMergeSort(a, n, workspace, trace, mergeOptions);
+    }
+    else if (algorithm == "Insertion Sort")
+    {
+        insertionSort(a, n, trace);
+    }
+    else if (algorithm == "Selection Sort")
+    {
+        selectionSort(a, n, trace);
+    }
+    else if (algorithm.startsWith("Heap Sort"))
+    {
+        heapSortRange(a, 0, n, trace, heapArityOf(algorithm));
+    }
+    else if (algorithm == "Sorting Network" && n <= kMaxNetworkSize)
+    {
+        networkSortRange(a, 0, n, trace);
+    }
+    else if (algorithm == "Streaming Sort (LSM)")
+    {
+        // Batches scale with the input so short arrays still show compactions
+        StreamingSortOptions options;
+        options.batchSize = std::clamp<std::size_t>(n / 64, 2, options.batchSize);
+        lsmSort(a, n, trace, options);
+    }
+    else if (algorithm == "Auto (Recommended)")
+    {
+        runKernel(recommendKernel(profileInput(a, n)).kernel, a, n, trace);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
 
 // Constructor
 MainWindow::MainWindow(QWidget *parent)
@@ -19,20 +213,51 @@ MainWindow::MainWindow(QWidget *parent)
     algorithmSelector(new QComboBox(this)),
     startButton(new QPushButton("Start", this)),
     resetButton(new QPushButton("Reset", this)),
+    repeatsButton(new QPushButton("Repeated Values", this)),
+    cacheButton(new QPushButton("Cache Heatmap", this)),
+    fastForwardButton(new QPushButton("Fast Forward", this)),
+    largeButton(new QPushButton("Watch 10M", this)),
     statusLabel(new QLabel("Select an algorithm and start", this)),
     currentIndex(0),
-    animationTimer(new QTimer(this))
+    animationTimer(new QTimer(this)),
+    perfTimer(new QTimer(this)),
+    overviewTimer(new QTimer(this))
 {
 
     setupUI();
     setMinimumSize(800, 600);
 
+    // A 10M-value radix sort records about 700 MB; the merge and quick
+    // sorts record too much to keep
+    QString traceDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/traces";
+    if (!traceCache.open(traceDirectory.toStdString(), std::uint64_t(2) << 30))
+    {
+        qWarning() << QString::fromStdString(traceCache.errorString());
+    }
+
     // Populate dropdown with sorting algorithms
+    algorithmSelector->addItem("Auto (Recommended)");
     algorithmSelector->addItem("Bubble Sort");
+    algorithmSelector->addItem("Bucket Sort");
+    algorithmSelector->addItem("Cluster Sort (4 Processes)");
+    algorithmSelector->addItem("Counting Sort");
+    algorithmSelector->addItem("Median (Introselect)");
     algorithmSelector->addItem("Merge Sort");
+    algorithmSelector->addItem("Merge Sort (Bottom-Up)");
+    algorithmSelector->addItem("Heap Sort (Binary)");
+    algorithmSelector->addItem("Heap Sort (4-ary)");
+    algorithmSelector->addItem("Heap Sort (8-ary)");
     algorithmSelector->addItem("Insertion Sort");
     algorithmSelector->addItem("Quick Sort");
+    algorithmSelector->addItem("Quick Sort (Block Partition)");
+    algorithmSelector->addItem("Quick Sort (Three-Way)");
     algorithmSelector->addItem("Selection Sort");
+    algorithmSelector->addItem("Sorting Network");
+    algorithmSelector->addItem("Streaming Sort (LSM)");
+    algorithmSelector->addItem("Top 3 (Partial Sort)");
+    algorithmSelector->addItem("String Sort (Multikey Quicksort)");
+    algorithmSelector->addItem("String Sort (MSD Radix)");
+    algorithmSelector->addItem("String Sort (Collation)");
 
     int fontIdAll = QFontDatabase::addApplicationFont("Nasa21-l23X.ttf");
     if (fontIdAll == -1)
@@ -45,28 +270,61 @@ MainWindow::MainWindow(QWidget *parent)
     algorithmSelector->setFont(fontAll);
     startButton->setFont(fontAll);
     resetButton->setFont(fontAll);
+    repeatsButton->setFont(fontAll);
+    cacheButton->setFont(fontAll);
+    fastForwardButton->setFont(fontAll);
+    largeButton->setFont(fontAll);
     statusLabel->setFont(fontAll);
 
     // Connect signals to slots
     connect(startButton, &QPushButton::clicked, this, &MainWindow::startSorting);
     connect(resetButton, &QPushButton::clicked, this, &MainWindow::resetSorting);
+    connect(repeatsButton, &QPushButton::clicked, this, &MainWindow::loadRepeatedValues);
+    connect(cacheButton, &QPushButton::clicked, this, &MainWindow::showCacheHeatmap);
+    connect(fastForwardButton, &QPushButton::clicked, this, &MainWindow::startFastForward);
+    connect(perfTimer, &QTimer::timeout, this, &MainWindow::updatePerfReadout);
+    connect(largeButton, &QPushButton::clicked, this, &MainWindow::startLargeView);
+    connect(overviewTimer, &QTimer::timeout, this, &MainWindow::largeViewStep);
     connect(animationTimer, &QTimer::timeout, this, &MainWindow::performStep);
 }
 
 // Destructor
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow()
+{
+    stopLargeView();
+    if (fastForwardThread.joinable())
+    {
+        fastForwardThread.join();
+    }
+}
 
 void MainWindow::resetSorting()
 {
     // Reset the data to its initial unsorted state
     data = {23, 41, 25, 54, 18, 14, 9, 10};
     resetBool = true;
+    stringIds.clear();
+    trace.clear();
+    traceIndex = 0;
+    replayingTrace = false;
+    cluster.reset();
+    heapOverlay->clear();
+    answerLast = answerFirst - 1;
+    traceSummary.clear();
+    stopLargeView();
+    overview->hide();
+    for (QPushButton *button : {startButton, repeatsButton, cacheButton, fastForwardButton, largeButton})
+    {
+        button->setEnabled(true);
+    }
+    algorithmSelector->setEnabled(true);
 
     // Reset the visualization: all bars back to blue
     for (int i = 0; i < bars.size(); ++i)
     {
         bars[i]->setText(QString::number(data[i]));        // Restore original data value on each bar
         bars[i]->setStyleSheet("background-color: blue;"); // Reset the color of the bars to blue
+        bars[i]->show();
     }
 
     // Stop the timer
@@ -92,6 +350,30 @@ void MainWindow::resetSorting()
     currentIndex = 0;
 }
 
+// Replace the bars with a sample that repeats values, the input three-way
+// partitioning is for. The bars keep it until they are edited or reset.
+void MainWindow::loadRepeatedValues()
+{
+    if (animationTimer->isActive())
+    {
+        return;
+    }
+    data = {23, 41, 25, 9, 23, 54, 23, 10};
+    stringIds.clear();
+    trace.clear();
+    traceIndex = 0;
+    replayingTrace = false;
+    cluster.reset();
+    heapOverlay->clear();
+    answerLast = answerFirst - 1;
+    for (int i = 0; i < (int)bars.size(); ++i)
+    {
+        updateBar(i);
+        bars[i]->setStyleSheet("background-color: blue;");
+    }
+    statusLabel->setText("Loaded values with repeats; Quick Sort (Three-Way) settles each repeated value in one pass");
+}
+
 // Set up the UI
 void MainWindow::setupUI()
 {
@@ -213,6 +495,10 @@ void MainWindow::setupUI()
         );
     controlsLayout->addWidget(startButton);
     controlsLayout->addWidget(resetButton);
+    controlsLayout->addWidget(repeatsButton);
+    controlsLayout->addWidget(cacheButton);
+    controlsLayout->addWidget(fastForwardButton);
+    controlsLayout->addWidget(largeButton);
     startButton->setStyleSheet(
         "QPushButton {"
         "  background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #00b4d8, stop:1 #0077b6);"
@@ -241,6 +527,53 @@ void MainWindow::setupUI()
         "QPushButton:pressed { background: #C0392B; }"
         );
 
+    repeatsButton->setStyleSheet(
+        "QPushButton {"
+        "  background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #9b5de5, stop:1 #7b3fc4);"
+        "  border-radius: 8px;"
+        "  padding: 12px 24px;"
+        "  color: white;"
+        "}"
+        "QPushButton:hover { background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #b07cf0, stop:1 #9b5de5); }"
+        "QPushButton:pressed { background: #7b3fc4; }"
+        "QPushButton:disabled { background: #555; }"
+        );
+
+    cacheButton->setStyleSheet(
+        "QPushButton {"
+        "  background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #8338ec, stop:1 #5a189a);"
+        "  border-radius: 8px;"
+        "  padding: 12px 24px;"
+        "  color: white;"
+        "}"
+        "QPushButton:hover { background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #9d4edd, stop:1 #7b2cbf); }"
+        "QPushButton:pressed { background: #5a189a; }"
+        );
+
+    fastForwardButton->setStyleSheet(
+        "QPushButton {"
+        "  background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #2a9d8f, stop:1 #21867a);"
+        "  border-radius: 8px;"
+        "  padding: 12px 24px;"
+        "  color: white;"
+        "}"
+        "QPushButton:hover { background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #40b3a5, stop:1 #2a9d8f); }"
+        "QPushButton:pressed { background: #21867a; }"
+        "QPushButton:disabled { background: #555; }"
+        );
+
+    largeButton->setStyleSheet(
+        "QPushButton {"
+        "  background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #f4a261, stop:1 #e76f51);"
+        "  border-radius: 8px;"
+        "  padding: 12px 24px;"
+        "  color: white;"
+        "}"
+        "QPushButton:hover { background: qlineargradient(x1:0, y1:0, x2:0, y2:1, stop:0 #f6b17a, stop:1 #f4a261); }"
+        "QPushButton:pressed { background: #e76f51; }"
+        "QPushButton:disabled { background: #555; }"
+        );
+
     QHBoxLayout *descriptionLayout = new QHBoxLayout;
     paragraphLabel = new QLabel(this);
     paragraphLabel->setText("<p></p>");
@@ -298,11 +631,17 @@ void MainWindow::setupUI()
         bar->setText(QString::number(value));
         bar->setFont(fontAcc);
         bar->setAlignment(Qt::AlignCenter);
+        bar->installEventFilter(this);
         barsLayout->addWidget(bar);
         bars.push_back(bar);
     }
 
     mainLayout->addLayout(barsLayout);
+    overview = new ArrayOverview(this);
+    overview->editRequested = [this](std::size_t index, bool many) { editLargeView(index, many); };
+    overview->hide();
+    mainLayout->addWidget(overview);
+    heapOverlay = new HeapTreeOverlay(bars, m_centralWidget);
     mainLayout->addLayout(descriptionLayout);
     m_centralWidget->setLayout(mainLayout);
     QScrollArea *scrollArea = new QScrollArea(this);
@@ -378,6 +717,10 @@ void MainWindow::resizeEvent(QResizeEvent *event)
 
     // Ensure proper layout update
     m_centralWidget->layout()->activate();
+    if (heapOverlay && heapOverlay->isVisible())
+    {
+        heapOverlay->setGeometry(m_centralWidget->rect());
+    }
 }
 
 // Start sorting animation
@@ -385,6 +728,16 @@ void MainWindow::startSorting()
 {
     QString selectedAlgorithm = algorithmSelector->currentText();
     resetBool = false;
+    replayingTrace = false;
+    cluster.reset();
+    heapOverlay->clear();
+    answerLast = answerFirst - 1;
+    traceSummary.clear();
+    overview->hide();
+    for (QLabel *bar : bars)
+    {
+        bar->show();
+    }
 
     if (selectedAlgorithm == "Bubble Sort")
     {
@@ -409,6 +762,7 @@ void MainWindow::startSorting()
                                 "<p>1. First partition: Choose last element (10) as pivot. Rearrange elements so all values ≤10 come before it. The array becomes {9, 10, 25, 54, 18, 14, 23, 41} with 10 in correct position.</p>"
                                 "<p>2. Recursively process left subarray {9} (already sorted) and right subarray {25,54,18,14,23,41}. New pivot 41 results in {25,23,18,14,41,54}.</p>"
                                 "<p>3. Repeat partitioning until all subarrays are single elements. Final sorted array emerges through recursive recombination of sorted partitions.</p>");
+        sortedness.assign(data.data(), data.size());
         currentIndex = 0;
         animationTimer->start(1000);
     }
@@ -419,8 +773,222 @@ void MainWindow::startSorting()
                                 "<p>1. Split into [23,41,25,54] and [18,14,9,10]. Recursively split until single elements.</p>"
                                 "<p>2. Merge pairs: [23,41] & [25,54] become [23,25,41,54], [14,18] & [9,10] become [9,10,14,18].</p>"
                                 "<p>3. Final merge combines [23,25,41,54] and [9,10,14,18] by comparing elements sequentially, resulting in the sorted array.</p>");
-        currentIndex = 0;
-        animationTimer->start(1000);
+        trace.clear();
+        std::vector<int> work = data;
+        topDownMergeSort(work.data(), work.size(), mergeWorkspace, trace);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Auto (Recommended)")
+    {
+        InputProfile profile = profileInput(data.data(), data.size());
+        KernelChoice choice = recommendKernel(profile);
+        statusLabel->setText(QString("Sorting using %1 (picked automatically)...").arg(kernelName(choice.kernel)));
+        paragraphLabel->setText(QString("<p>Before sorting, the input was measured in one pass plus a small random sample:</p>"
+                                        "<p>%1 elements, %2 ascending runs, %3% of sampled pairs out of order, "
+                                        "%4% of sampled values repeated, values from %5 to %6.</p>"
+                                        "<p>Choice: <b>%7</b>. %8</p>")
+                                    .arg(profile.size)
+                                    .arg(profile.runs)
+                                    .arg(profile.inversionRatio * 100, 0, 'f', 1)
+                                    .arg(profile.duplicateRatio * 100, 0, 'f', 1)
+                                    .arg(profile.minValue)
+                                    .arg(profile.maxValue)
+                                    .arg(kernelName(choice.kernel))
+                                    .arg(QString::fromStdString(choice.reason)));
+        trace.clear();
+        std::vector<int> work = data;
+        runKernel(choice.kernel, work.data(), work.size(), trace);
+        if (trace.size() == 0)
+        {
+            // std::sort is not instrumented; show its result in one sweep
+            for (std::size_t k = 0; k < work.size(); ++k)
+            {
+                trace.write(k, work[k]);
+            }
+        }
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Merge Sort (Bottom-Up)")
+    {
+        statusLabel->setText("Sorting using Bottom-Up Merge Sort...");
+        paragraphLabel->setText("<p>Bottom-Up Merge Sort skips the recursive splitting and merges runs that are already sorted. For {23,41,25,54,18,14,9,10}:</p>"
+                                "<p>1. Find natural runs: [23,41], [25,54], [18,14,9] (descending, so it is reversed to [9,14,18]) and [10]. Short runs are grown with insertion sort.</p>"
+                                "<p>2. Merge neighbouring runs into a second buffer: [23,25,41,54] and [9,10,14,18]. The next pass merges them back into the first buffer, so the buffers swap roles instead of copying.</p>"
+                                "<p>3. Every merge only starts once both of its runs are sorted, and the only memory used is one buffer the size of the array.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        MergeSortOptions options;
+        options.minRun = 2;
+        bottomUpMergeSort(work.data(), work.size(), mergeWorkspace, trace, options);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Streaming Sort (LSM)")
+    {
+        statusLabel->setText("Sorting using Streaming Sort (LSM)...");
+        paragraphLabel->setText("<p>Streaming Sort keeps values that keep arriving sorted, the way a log-structured merge tree does: it never re-sorts what it already has. The values of {23,41,25,54,18,14,9,10} arrive two at a time:</p>"
+                                "<p>1. Each batch (purple) is sorted on its own into a run: [23,41], then [25,54]. Fresh runs are tier 0.</p>"
+                                "<p>2. As soon as two runs of the same tier are the newest, they are compacted (olive) into one run of the next tier: [23,25,41,54]. [14,18] and [9,10] become [9,10,14,18] the same way.</p>"
+                                "<p>3. The two tier-1 runs make one tier-2 run, the sorted array. A live feed never ends, so questions like \"how many values are below 25\" are answered by searching each run; there are only logarithmically many. Real runs hold 65536 values and merge four at a time.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        StreamingSortOptions options;
+        options.batchSize = 2;
+        options.fanout = 2;
+        lsmSort(work.data(), work.size(), trace, options);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Quick Sort (Block Partition)")
+    {
+        statusLabel->setText("Sorting using Block Partition Quick Sort...");
+        paragraphLabel->setText("<p>Block Partition Quick Sort avoids the unpredictable branch of the classic partition. For {23,41,25,54,18,14,9,10}:</p>"
+                                "<p>1. The median of the first, middle and last element (18) becomes the pivot and moves to the end.</p>"
+                                "<p>2. A block on the left (cyan) is compared with the pivot and the positions of elements that are too big are written down; a block on the right gets the positions of elements that are too small. Writing down a position happens either way, so the processor never has to guess.</p>"
+                                "<p>3. The noted elements are swapped in pairs, the pivot moves between the two sides, and each side is sorted the same way. Real runs use blocks of 64.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        QuicksortOptions options;
+        options.blockSize = 2;
+        options.smallCutoff = 2;
+        quicksort(work.data(), work.size(), trace, options);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Quick Sort (Three-Way)")
+    {
+        statusLabel->setText("Sorting using Three-Way Quick Sort...");
+        paragraphLabel->setText("<p>Three-Way Quick Sort splits around the pivot into less than, equal to and greater than it, so repeated values are settled in one pass. For the Repeated Values sample {23,41,25,9,23,54,23,10}:</p>"
+                                "<p>1. The pivot (23) moves to the front, and one scan sorts every element into one of three bands: smaller ones go left, bigger ones go right, copies of 23 stay in the middle.</p>"
+                                "<p>2. The middle band (pink) holds all three 23s and is already in its final place; it is never looked at again.</p>"
+                                "<p>3. Only the smaller and bigger bands are sorted further. With few distinct values the bands run out quickly and the sort takes close to linear time.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        QuicksortOptions options;
+        options.partition = PartitionScheme::ThreeWay;
+        options.smallCutoff = 2;
+        quicksort(work.data(), work.size(), trace, options);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm.startsWith("Heap Sort"))
+    {
+        heapArity = heapArityOf(selectedAlgorithm);
+        statusLabel->setText(QString("Sorting using %1...").arg(selectedAlgorithm));
+        paragraphLabel->setText(QString("<p>Heap Sort arranges the array as a tree in which every node is at least as big as its children, without storing the tree: the children of position k are positions %1k+1 to %1k+%1. For {23,41,25,54,18,14,9,10}:</p>"
+                                        "<p>1. Build the heap from the last parent backwards: each parent sinks below any bigger child. The lines above the bars are the tree, so 54 ends up at the root on the left.</p>"
+                                        "<p>2. Swap the root, the biggest value, to the end of the heap. That spot is final, and the heap (outlined by the tree) shrinks by one.</p>"
+                                        "<p>3. The new root sinks back into place and the swap repeats. With %1 children per node the tree has fewer levels, and all children of a node sit next to each other in memory, so each level costs about one cache line.</p>")
+                                    .arg(heapArity));
+        trace.clear();
+        std::vector<int> work = data;
+        heapSortRange(work.data(), 0, work.size(), trace, heapArity);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Counting Sort")
+    {
+        statusLabel->setText("Sorting using Counting Sort...");
+        paragraphLabel->setText("<p>Counting Sort never compares two values; it counts them. For {23,41,25,54,18,14,9,10}:</p>"
+                                "<p>1. Find the smallest (9) and largest (54) value and set up one counter for every value in between: 46 counters.</p>"
+                                "<p>2. One pass over the array adds 1 to the counter of each value. On a large input every thread counts its own part into its own counters, and the counters are added up afterwards.</p>"
+                                "<p>3. Walk the counters in order and write each value back as many times as it was counted (teal). This only pays off when the values span fewer numbers than there are elements; here it is shown on a wide span to keep the example the same.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        if (!countingSort(work.data(), work.size(), trace))
+        {
+            bucketSort(work.data(), work.size(), trace);
+        }
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Bucket Sort")
+    {
+        statusLabel->setText("Sorting using Bucket Sort...");
+        paragraphLabel->setText("<p>Bucket Sort splits the values by their high bits instead of comparing them. For {23,41,25,54,18,14,9,10}, whose values span 9 to 54:</p>"
+                                "<p>1. Count how many values fall into each bucket of 16 numbers (9-24, 25-40 and 41-56), then swap every value to the next free slot of its bucket, without a second array.</p>"
+                                "<p>2. Each bucket (teal) is split again on the next bits until it is small enough for insertion sort, or holds as many values as its range has numbers, where counting sort takes over.</p>"
+                                "<p>3. Real runs use up to 2048 buckets per split, which is few enough for their write positions to stay in the fastest cache, and threads count and finish buckets in parallel.</p>");
+        trace.clear();
+        std::vector<int> work = data;
+        bucketSort(work.data(), work.size(), trace, 1, 2);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Top 3 (Partial Sort)" || selectedAlgorithm == "Median (Introselect)")
+    {
+        // Same small ranges as the Block Partition demo, so the full sort
+        // it is measured against is the one that animation shows
+        QuicksortOptions options;
+        options.blockSize = 2;
+        options.smallCutoff = 2;
+        SortTrace fullSort;
+        std::vector<int> work = data;
+        quicksort(work.data(), work.size(), fullSort, options);
+
+        trace.clear();
+        work = data;
+        QString answer;
+        if (selectedAlgorithm.startsWith("Top"))
+        {
+            statusLabel->setText("Finding the 3 smallest values in order...");
+            paragraphLabel->setText("<p>A Partial Sort only puts the k smallest values in order at the front. For the 3 smallest of {23,41,25,54,18,14,9,10}:</p>"
+                                    "<p>1. Partition around a pivot exactly as Quick Sort does.</p>"
+                                    "<p>2. A part that starts at position 3 or later can only hold values that are not among the 3 smallest, so it is dropped instead of sorted.</p>"
+                                    "<p>3. Only the parts that overlap the first 3 positions are sorted, and the sort stops as soon as those are final.</p>");
+            answerFirst = 0;
+            answerLast = std::min<int>(3, data.size()) - 1;
+            partialQuicksort(work.data(), work.size(), 3, trace, options);
+            answer = "The 3 smallest values";
+        }
+        else
+        {
+            statusLabel->setText("Finding the median...");
+            paragraphLabel->setText("<p>Introselect finds the value that belongs at one position, here the middle, without sorting anything else. For {23,41,25,54,18,14,9,10}:</p>"
+                                    "<p>1. Partition around a pivot. If the pivot lands on the middle position, it is the median and the work stops.</p>"
+                                    "<p>2. Otherwise only the side that contains the middle position is partitioned again; the other side is never looked at.</p>"
+                                    "<p>3. Each step halves the work on average, so the total is about twice the length of the array. If the pivots keep coming out badly, it switches to median of medians, which is linear even in the worst case.</p>");
+            answerFirst = answerLast = static_cast<int>(data.size() / 2);
+            nthElement(work.data(), work.size(), data.size() / 2, trace, options);
+            answer = "The median";
+        }
+        std::size_t saved = traceWork(fullSort) - std::min(traceWork(fullSort), traceWork(trace));
+        traceSummary = QString("%1 took %2 comparisons and moves; a full quicksort takes %3, so %4% was saved")
+                           .arg(answer)
+                           .arg(traceWork(trace))
+                           .arg(traceWork(fullSort))
+                           .arg(100 * saved / std::max<std::size_t>(1, traceWork(fullSort)));
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Sorting Network")
+    {
+        NetworkView network = sortingNetwork(data.size());
+        statusLabel->setText("Sorting using a Sorting Network...");
+        paragraphLabel->setText(QString("<p>A Sorting Network is a fixed list of compare-exchange steps that sorts any input of its size, so it never has to decide what to compare next. For 8 values it is %1 comparators in %2 layers (Batcher's odd-even merge sort):</p>"
+                                        "<p>1. Each comparator looks at two positions and puts the smaller value on the left. Nothing depends on the outcome, so the processor can use a conditional move instead of a jump.</p>"
+                                        "<p>2. Comparators in the same layer (purple) touch different positions and could all run at once.</p>"
+                                        "<p>3. The quick and merge kernels finish their small pieces (up to 32 values) with networks like this one, fully unrolled at compile time.</p>")
+                                    .arg(network.size)
+                                    .arg(network.layers));
+        trace.clear();
+        std::vector<int> work = data;
+        networkSortRange(work.data(), 0, work.size(), trace);
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
     }
     else if (selectedAlgorithm == "Insertion Sort")
     {
@@ -432,6 +1000,81 @@ void MainWindow::startSorting()
         currentIndex = 0;
         animationTimer->start(1000);
     }
+    else if (selectedAlgorithm == "String Sort (Multikey Quicksort)")
+    {
+        statusLabel->setText("Sorting strings using Multikey Quicksort...");
+        paragraphLabel->setText("<p>Multikey Quicksort partitions strings three ways on a key chunk instead of comparing whole strings. Each string caches its next 8 bytes as one integer, so a comparison never has to follow a pointer into the text:</p>"
+                                "<p>1. Pick a pivot chunk (median of three) and split the strings into less than, equal to and greater than it.</p>"
+                                "<p>2. The less and greater parts are sorted on the same chunk. The equal part already agrees on those 8 bytes, so it moves on to the next chunk.</p>"
+                                "<p>3. A part whose chunk ends the string is finished: every string in it is identical. Bars are ordered by the rank of their string.</p>");
+        loadStringData();
+        std::vector<StringRef> refs = makeStringRefs(stringArena);
+        multikeyQuicksort(stringArena, refs, trace, StringSortCutoffs{2, 2});
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "String Sort (MSD Radix)")
+    {
+        statusLabel->setText("Sorting strings using MSD Radix Sort...");
+        paragraphLabel->setText("<p>MSD Radix Sort distributes strings into 256 buckets by one byte at a time, starting from the first character:</p>"
+                                "<p>1. Count how many strings have each byte value, then copy every string into its bucket in a single pass through a scratch buffer.</p>"
+                                "<p>2. Each bucket with more than one string is sorted the same way on the next byte. Strings that ended are already in place.</p>"
+                                "<p>3. Small buckets switch to Multikey Quicksort, which is faster than a 256-way split for a handful of strings.</p>");
+        loadStringData();
+        std::vector<StringRef> refs = makeStringRefs(stringArena);
+        msdRadixSort(stringArena, refs, trace, StringSortCutoffs{2, 2});
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "String Sort (Collation)")
+    {
+        statusLabel->setText("Sorting strings in locale order using collation keys...");
+        paragraphLabel->setText("<p>Locale order ignores case and accents at first, so comparing bytes puts \"README.md\" before \"docs\". Asking the collator on every comparison is slow; a sort key does the work once per string:</p>"
+                                "<p>1. Each string is turned into its sort key, a byte string that compares byte by byte the way the string collates. Keys are built in parallel into one buffer.</p>"
+                                "<p>2. The keys are sorted with Multikey Quicksort, exactly as plain strings would be.</p>"
+                                "<p>3. Key i belongs to string i, so the sorted keys give the strings in locale order. Bars are ordered by the collation rank of their string.</p>");
+        loadStringData();
+        Collator collator;
+        if (!collator.open(QLocale::system().name().toStdString()) && !collator.open(""))
+        {
+            statusLabel->setText(QString::fromStdString(collator.errorString()));
+            return;
+        }
+        // Rank the bars by collation order instead of byte order
+        std::vector<std::uint32_t> order = collationOrder(collator, stringArena);
+        for (int rank = 0; rank < (int)order.size(); ++rank)
+        {
+            data[order[rank]] = rank;
+        }
+        StringArena keys = collationKeys(collator, stringArena);
+        std::vector<StringRef> refs = makeStringRefs(keys);
+        multikeyQuicksort(keys, refs, trace, StringSortCutoffs{2, 2});
+        traceIndex = 0;
+        replayingTrace = true;
+        animationTimer->start(500);
+    }
+    else if (selectedAlgorithm == "Cluster Sort (4 Processes)")
+    {
+        statusLabel->setText("Sorting across 4 worker processes...");
+        paragraphLabel->setText("<p>A cluster sorts data too big for one machine with a sample sort. Here each machine is a local process, and the network is shared memory. Colors show which process holds each value:</p>"
+                                "<p>1. Sampling: each process owns a slice of the array and draws random samples from it. All samples are pooled and sorted, and every process picks the same 3 splitters, so each one knows which range of values it will own.</p>"
+                                "<p>2. Exchange: each process counts how many of its values fall into every range, then writes them straight into the owner's part of a shared array, after those of the processes before it. Gray bars have not arrived yet.</p>"
+                                "<p>3. Local sort: each process sorts its own part on its own. The parts are already in range order, so together they are the sorted array.</p>");
+        ClusterSortOptions options;
+        options.processes = 4;
+        options.samplesPerProcess = 2;
+        options.paceMicros = 400000;  // Slow enough to watch every value move
+        cluster = std::make_unique<ClusterSort>();
+        if (!cluster->start(data.data(), data.size(), options))
+        {
+            statusLabel->setText(QString::fromStdString(cluster->errorString()));
+            cluster.reset();
+            return;
+        }
+        animationTimer->start(100);
+    }
     else
     {
         statusLabel->setText("Sorting using Selection Sort...");
@@ -447,7 +1090,15 @@ void MainWindow::startSorting()
 // Perform a step in the sorting animation
 void MainWindow::performStep()
 {
-    if (algorithmSelector->currentText() == "Bubble Sort")
+    if (cluster)
+    {
+        clusterStep(); // Worker processes do the sorting; the bars follow them
+    }
+    else if (replayingTrace)
+    {
+        traceStep(); // Algorithms that run as an engine kernel
+    }
+    else if (algorithmSelector->currentText() == "Bubble Sort")
     {
         bubbleSortStep();
     }
@@ -455,10 +1106,6 @@ void MainWindow::performStep()
     {
         quickSortStep();
     }
-    else if (algorithmSelector->currentText() == "Merge Sort")
-    {
-        mergeSortStep();
-    }
     else if ((algorithmSelector->currentText() == "Insertion Sort"))
     {
         insertionSortStep();
@@ -469,17 +1116,612 @@ void MainWindow::performStep()
     }
 }
 
-// Check if data is sorted
-bool MainWindow::isSorted()
+// Replace the demo integers with sample strings; each bar's value is the
+// rank of its string so isSorted() and the colors keep working unchanged
+void MainWindow::loadStringData()
+{
+    static const char *samples[] = {"src/mainwindow.cpp", "include/trace.h", "src/main.cpp", "README.md",
+                                    "src/mainwindow.h", "docs/index.md", "include/arena.h", "src/main.h"};
+
+    stringArena = StringArena();
+    for (std::size_t i = 0; i < bars.size(); ++i)
+    {
+        stringArena.add(samples[i % 8]);
+    }
+
+    std::vector<int> order(bars.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](int a, int b) { return stringArena.view(a) < stringArena.view(b); });
+
+    stringIds.resize(bars.size());
+    std::iota(stringIds.begin(), stringIds.end(), 0);
+    for (int rank = 0; rank < (int)order.size(); ++rank)
+    {
+        data[order[rank]] = rank;
+    }
+    for (int i = 0; i < (int)bars.size(); ++i)
+    {
+        updateBar(i);
+        bars[i]->setStyleSheet("background-color: blue;");
+    }
+    trace.clear();
+}
+
+// Show the value at `index`: the string for string data, otherwise the number
+void MainWindow::updateBar(int index)
+{
+    if (stringIds.empty())
+    {
+        bars[index]->setText(QString::number(data[index]));
+        return;
+    }
+    std::string_view s = stringArena.view(stringIds[index]);
+    bars[index]->setText(QString::fromUtf8(s.data(), (int)s.size()));
+}
+
+// Apply recorded events until one changes what is on screen
+void MainWindow::traceStep()
+{
+    const std::vector<TraceEvent> &events = trace.events();
+
+    for (QLabel *bar : bars)
+    {
+        bar->setStyleSheet("background-color: blue;");
+    }
+
+    while (traceIndex < events.size())
+    {
+        const TraceEvent &e = events[traceIndex++];
+        if (e.type == TraceEvent::Read)
+        {
+            continue;
+        }
+
+        if (e.type == TraceEvent::Compare)
+        {
+            bars[e.i]->setStyleSheet("background-color: yellow;");
+            bars[e.j]->setStyleSheet("background-color: yellow;");
+        }
+        else if (e.type == TraceEvent::Swap)
+        {
+            std::swap(data[e.i], data[e.j]);
+            if (!stringIds.empty())
+            {
+                std::swap(stringIds[e.i], stringIds[e.j]);
+            }
+            updateBar(e.i);
+            updateBar(e.j);
+            bars[e.i]->setStyleSheet("background-color: red;");
+            bars[e.j]->setStyleSheet("background-color: red;");
+        }
+        else if (e.type == TraceEvent::Write)
+        {
+            if (stringIds.empty())
+            {
+                data[e.i] = e.value;
+            }
+            else
+            {
+                // The written value is a string id; move its rank along with it
+                auto from = std::find(stringIds.begin(), stringIds.end(), e.value) - stringIds.begin();
+                std::swap(data[e.i], data[from]);
+                std::swap(stringIds[e.i], stringIds[from]);
+                updateBar(from);
+            }
+            updateBar(e.i);
+            bars[e.i]->setStyleSheet("background-color: red;");
+        }
+        else if (e.tag == TagHeap)
+        {
+            heapOverlay->showHeap(heapArity, e.i, e.j);
+            for (int k = e.i; k <= e.j; ++k)
+            {
+                bars[k]->setStyleSheet("background-color: slateblue;");
+            }
+        }
+        else
+        {
+            const char *color = e.tag == TagPivot ? "background-color: orange;"
+                                : e.tag == TagBucket ? "background-color: teal;"
+                                : e.tag == TagRun ? "background-color: olive;"
+                                : e.tag == TagBlock ? "background-color: cyan;"
+                                : e.tag == TagEqual ? "background-color: pink;"
+                                                  : "background-color: purple;";
+            for (int k = e.i; k <= e.j; ++k)
+            {
+                bars[k]->setStyleSheet(color);
+            }
+        }
+        QCoreApplication::processEvents();
+        return;
+    }
+
+    animationTimer->stop();
+    heapOverlay->clear();
+    statusLabel->setText(traceSummary.isEmpty() ? QString("Sorting complete!") : traceSummary);
+    for (int k = 0; k < (int)bars.size(); ++k)
+    {
+        bool answer = answerLast < answerFirst || (k >= answerFirst && k <= answerLast);
+        bars[k]->setStyleSheet(answer ? "background-color: green;" : "background-color: blue;");
+    }
+}
+
+// Show the array the cluster's processes share, each bar in the color of the
+// process holding it, until they are done
+void MainWindow::clusterStep()
+{
+    static const char *colors[] = {"background-color: orange;", "background-color: teal;",
+                                   "background-color: purple;", "background-color: olive;"};
+    static const char *phases[] = {"", "Sampling: picking splitters", "Exchange: values move to their owners",
+                                   "Local sort: each process sorts its part"};
+
+    ClusterPhase phase = cluster->poll();
+    if (phase == ClusterPhase::Failed)
+    {
+        animationTimer->stop();
+        statusLabel->setText(QString::fromStdString(cluster->errorString()));
+        cluster.reset();
+        return;
+    }
+    if (phase == ClusterPhase::Done)
+    {
+        animationTimer->stop();
+        ClusterSortStats stats;
+        if (!cluster->finish(data.data(), &stats))
+        {
+            statusLabel->setText(QString::fromStdString(cluster->errorString()));
+            cluster.reset();
+            return;
+        }
+        cluster.reset();
+        for (int k = 0; k < (int)bars.size(); ++k)
+        {
+            updateBar(k);
+            bars[k]->setStyleSheet("background-color: green;");
+        }
+        statusLabel->setText(QString("Sorting complete! Launch %1 ms, sampling %2 ms, exchange %3 ms, local sort %4 ms, "
+                                     "output %5 ms")
+                                 .arg(stats.launchMs, 0, 'f', 1)
+                                 .arg(stats.samplingMs, 0, 'f', 1)
+                                 .arg(stats.exchangeMs, 0, 'f', 1)
+                                 .arg(stats.localSortMs, 0, 'f', 1)
+                                 .arg(stats.outputMs, 0, 'f', 2));
+        return;
+    }
+
+    std::vector<int> values;
+    std::vector<std::uint8_t> owners;
+    cluster->snapshot(values, owners);
+    for (int k = 0; k < (int)bars.size() && k < (int)values.size(); ++k)
+    {
+        bool arrived = owners[k] != ClusterSort::kNoOwner;
+        data[k] = values[k];
+        bars[k]->setText(arrived ? QString::number(values[k]) : QString());
+        bars[k]->setStyleSheet(arrived ? colors[owners[k] % 4] : "background-color: gray;");
+    }
+    if (phase != ClusterPhase::Idle)
+    {
+        statusLabel->setText(phases[static_cast<int>(phase)]);
+    }
+}
+
+// Replay the selected algorithm through a tiny simulated cache hierarchy and
+// color each bar by how often it was touched: blue is cold, red is hot, and a
+// thicker border means more of those touches missed L1
+void MainWindow::showCacheHeatmap()
+{
+    animationTimer->stop();
+    replayingTrace = false;
+    cluster.reset();
+
+    std::vector<int> work = data;
+    SortTrace heatTrace;
+    MergeSortOptions options;
+    options.minRun = 2;
+    if (!runEngineKernel(algorithmSelector->currentText(), work.data(), work.size(), mergeWorkspace, heatTrace, options))
+    {
+        statusLabel->setText("The cache heatmap is available for the integer algorithms");
+        return;
+    }
+
+    CacheSimulator simulator(CacheConfig::teaching(), data.size(), sizeof(int));
+    simulator.consume(heatTrace);
+    const std::vector<std::uint32_t> &accesses = simulator.accessCounts();
+    const std::vector<std::uint32_t> &misses = simulator.missCounts();
+    std::uint32_t maxAccesses = std::max(1u, *std::max_element(accesses.begin(), accesses.end()));
+    std::uint32_t maxMisses = std::max(1u, *std::max_element(misses.begin(), misses.end()));
+
+    for (int i = 0; i < (int)bars.size(); ++i)
+    {
+        int heat = 255 * accesses[i] / maxAccesses;
+        int border = 1 + 4 * misses[i] / maxMisses;
+        bars[i]->setStyleSheet(QString("background-color: rgb(%1, 0, %2); border: %3px solid white;")
+                                   .arg(heat)
+                                   .arg(255 - heat)
+                                   .arg(border));
+        bars[i]->setToolTip(QString("%1 accesses, %2 L1 misses").arg(accesses[i]).arg(misses[i]));
+    }
+
+    QString rows;
+    for (const CacheLevelStats &level : simulator.stats())
+    {
+        rows += QString("<p>%1: %2 accesses, %3 misses (%4%)</p>")
+                    .arg(QString::fromStdString(level.name))
+                    .arg(level.accesses)
+                    .arg(level.misses)
+                    .arg(level.missRate() * 100, 0, 'f', 1);
+    }
+    statusLabel->setText(QString("Cache heatmap for %1").arg(algorithmSelector->currentText()));
+    paragraphLabel->setText(QString("<p>%1 recorded operations were replayed as memory reads through a cache "
+                                    "that holds 4 values in L1, 8 in L2 and 16 in the last level, with 2 values per line. "
+                                    "Hover a bar for its counts.</p>")
+                                .arg(simulator.eventCount()) + rows);
+}
+
+// Skip the animation: sort a large random input with the selected kernel on
+// a worker thread while the readout shows its hardware counters live
+void MainWindow::startFastForward()
+{
+    QString algorithm = algorithmSelector->currentText();
+    if (needsDemoInput(algorithm))
+    {
+        statusLabel->setText("Fast forward needs an integer algorithm that sorts any length");
+        return;
+    }
+    animationTimer->stop();
+    replayingTrace = false;
+
+    // Quadratic kernels get an input they finish in seconds
+    fastForwardSize = isQuadratic(algorithm) ? 30000 : 5000000;
+    std::vector<int> input = largeInput(algorithm, fastForwardSize, QRandomGenerator::global()->generate());
+
+    for (QPushButton *button : {startButton, resetButton, repeatsButton, cacheButton, fastForwardButton, largeButton})
+    {
+        button->setEnabled(false);
+    }
+    algorithmSelector->setEnabled(false);
+    statusLabel->setText(QString("Fast-forwarding %1 on %2 random values...").arg(algorithm).arg(fastForwardSize));
+    fastForwardDone = false;
+
+    // perf_event_open counts the thread that opens the counters, so the
+    // worker opens them and the GUI only reads
+    std::promise<void> opened;
+    std::future<void> ready = opened.get_future();
+    fastForwardThread = std::thread([this, algorithm, input = std::move(input), opened = std::move(opened)]() mutable {
+        fastForwardCounters = std::make_unique<PerfCounters>();
+        MergeWorkspace workspace;
+        NullTrace none;
+        fastForwardCounters->start();
+        opened.set_value();
+        runEngineKernel(algorithm, input.data(), input.size(), workspace, none);
+        fastForwardCounters->stop();
+        fastForwardDone = true;
+    });
+    ready.wait();
+    perfTimer->start(100);
+}
+
+void MainWindow::updatePerfReadout()
+{
+    bool done = fastForwardDone;
+    PerfSample s = fastForwardCounters->sample();
+
+    auto millions = [&](PerfEvent e) {
+        return s.has(e) ? QString::number(s.counts[e] / 1e6, 'f', 1) + " M" : QString("-");
+    };
+    QString text = QString("<p>%1 ms elapsed, %2 values</p>").arg(s.milliseconds, 0, 'f', 0).arg(fastForwardSize);
+    if (fastForwardCounters->available())
+    {
+        text += QString("<p>cycles %1, instructions %2, IPC %3</p>"
+                        "<p>branch misses %4, L1D misses %5, LLC misses %6, dTLB misses %7</p>")
+                    .arg(millions(PerfCycles))
+                    .arg(millions(PerfInstructions))
+                    .arg(s.ipc() > 0 ? QString::number(s.ipc(), 'f', 2) : QString("-"))
+                    .arg(millions(PerfBranchMisses))
+                    .arg(millions(PerfL1dMisses))
+                    .arg(millions(PerfLlcMisses))
+                    .arg(millions(PerfDtlbMisses));
+    }
+    if (!fastForwardCounters->errorString().empty())
+    {
+        text += QString("<p>Hardware counters %1: %2</p>")
+                    .arg(fastForwardCounters->available() ? "partly unavailable" : "unavailable, showing time only")
+                    .arg(QString::fromStdString(fastForwardCounters->errorString()));
+    }
+    paragraphLabel->setText(text);
+    if (!done)
+    {
+        return;
+    }
+
+    perfTimer->stop();
+    fastForwardThread.join();
+    for (QPushButton *button : {startButton, resetButton, repeatsButton, cacheButton, fastForwardButton, largeButton})
+    {
+        button->setEnabled(true);
+    }
+    algorithmSelector->setEnabled(true);
+
+    // Show the demo array in its final state as well
+    NullTrace none;
+    runEngineKernel(algorithmSelector->currentText(), data.data(), data.size(), mergeWorkspace, none);
+    for (int i = 0; i < (int)bars.size(); ++i)
+    {
+        updateBar(i);
+        bars[i]->setStyleSheet("background-color: green;");
+    }
+    statusLabel->setText(QString("Fast forward complete: %1 values in %2 ms")
+                             .arg(fastForwardSize)
+                             .arg(s.milliseconds, 0, 'f', 0));
+}
+
+// Watch the selected kernel sort an array far larger than the bars can
+// show. The kernel runs on a worker thread and streams its trace through a
+// bounded queue; each frame the GUI applies what has arrived to a segment
+// tree and draws one min/max column per pixel from it.
+void MainWindow::startLargeView()
+{
+    QString algorithm = algorithmSelector->currentText();
+    if (needsDemoInput(algorithm))
+    {
+        statusLabel->setText("The large view needs an integer algorithm that sorts any length");
+        return;
+    }
+    animationTimer->stop();
+    replayingTrace = false;
+    stopLargeView();
+
+    // Always the same input, so watching an algorithm again replays its
+    // recorded trace instead of running it
+    std::size_t size = isQuadratic(algorithm) ? 30000 : 10000000;
+    std::vector<int> input = largeInput(algorithm, size, 20240601);
+    TraceCacheKey key =
+        makeTraceCacheKey(algorithm.toStdString(), "large view, " + describeTuning(tuning()), input.data(), input.size());
+    overviewTree.assign(input);
+    overview->setTree(&overviewTree);
+    for (QLabel *bar : bars)
+    {
+        bar->hide();
+    }
+    overview->show();
+
+    for (QPushButton *button : {startButton, repeatsButton, cacheButton, fastForwardButton, largeButton})
+    {
+        button->setEnabled(false);
+    }
+    algorithmSelector->setEnabled(false);
+    statusLabel->setText(QString("Sorting %1 values with %2...").arg(size).arg(algorithm));
+    paragraphLabel->setText("<p>Each pixel column is a line from the smallest to the largest value it covers; "
+                            "red columns were touched in the latest frame, green ones are already in order. The columns come from a segment tree "
+                            "over blocks of the array that every traced write or swap updates in O(log n), so a "
+                            "frame costs the same at any size and any zoom.</p>"
+                            "<p>Scroll to zoom around the cursor, drag to pan, double-click to see the whole array. "
+                            "Once it is sorted, right-click to edit the value under the cursor, or Shift+right-click "
+                            "for 1000 random edits: the order is repaired in place instead of sorting again.</p>");
+
+    overviewDone = false;
+    overviewStamp = 1;
+    overviewEvents = 0;
+    overviewQueue = std::make_unique<TraceQueue>();
+    if (traceCache.lookup(key, overviewEntry))
+    {
+        statusLabel->setText(QString("Replaying %1 on %2 values from the trace cache...").arg(algorithm).arg(size));
+        overviewThread = std::thread([this] {
+            constexpr std::uint64_t kBatch = 4096;
+            for (std::uint64_t k = 0; k < overviewEntry.eventCount(); k += kBatch)
+            {
+                overviewQueue->consume(overviewEntry.events() + k,
+                                       std::min(kBatch, overviewEntry.eventCount() - k));
+            }
+            overviewDone = true;
+        });
+        overviewTimer->start(16);
+        return;
+    }
+
+    // The trace goes to the display and to the cache; if the view is
+    // stopped, the kernel still finishes and the recording is kept
+    std::unique_ptr<TraceCacheWriter> writer = traceCache.record(key, input.data(), overviewQueue.get());
+    overviewThread = std::thread([this, algorithm, input = std::move(input), writer = std::move(writer)]() mutable {
+        {
+            MergeWorkspace workspace;
+            StreamingTrace trace(writer ? static_cast<TraceSink &>(*writer) : *overviewQueue);
+            runEngineKernel(algorithm, input.data(), input.size(), workspace, trace);
+        }
+        if (writer)
+        {
+            writer->commit();
+        }
+        overviewDone = true;
+    });
+    overviewTimer->start(16);
+}
+
+void MainWindow::largeViewStep()
 {
-    for (int i = 0; i < data.size() - 1; ++i)
+    // Read the flag first: once it is set, everything it covers is queued
+    bool done = overviewDone;
+    bool drained = true;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(8))
     {
-        if (data[i] > data[i + 1])
+        if (!overviewQueue->pop(overviewBatch))
         {
-            return false; // Not sorted in ascending order
+            break;
         }
+        overviewTree.apply(overviewBatch.data(), overviewBatch.size(), overviewStamp);
+        overviewEvents += overviewBatch.size();
+        for (auto e = overviewBatch.rbegin(); e != overviewBatch.rend(); ++e)
+        {
+            if (e->type == TraceEvent::Mark)
+            {
+                overview->setMark(e->tag, e->i, e->j);
+                break;
+            }
+        }
+        drained = false;
+    }
+    overview->setRecent(overviewStamp++);
+    statusLabel->setText(QString("%1 trace events applied").arg(overviewEvents));
+    if (!done || !drained)
+    {
+        return;
     }
-    return true; // Sorted in ascending order
+
+    overviewTimer->stop();
+    overviewThread.join();
+    overviewQueue.reset();
+    bool replayed = overviewEntry.isOpen();
+    overviewEntry.close();
+    overview->clearMark();
+    for (QPushButton *button : {startButton, repeatsButton, cacheButton, fastForwardButton, largeButton})
+    {
+        button->setEnabled(true);
+    }
+    algorithmSelector->setEnabled(true);
+    TraceCacheStats cacheStats = traceCache.stats();
+    statusLabel->setText(QString("%1 values %2 after %3 trace events, %4. Trace cache: %5 hits, %6 misses, "
+                                 "%7 traces in %8 MB")
+                             .arg(overviewTree.size())
+                             .arg(overviewTree.sorted() ? "sorted" : "NOT sorted")
+                             .arg(overviewEvents)
+                             .arg(replayed ? "replayed from the cache" : "recorded")
+                             .arg(cacheStats.hits)
+                             .arg(cacheStats.misses)
+                             .arg(cacheStats.entries)
+                             .arg(cacheStats.bytes >> 20));
+}
+
+// Edits one value of the sorted large array, or 1000 random ones, and
+// repairs the order around them
+void MainWindow::editLargeView(std::size_t index, bool many)
+{
+    if (overviewTimer->isActive() || !overviewTree.sorted())
+    {
+        statusLabel->setText("Values can be edited once the large array is sorted");
+        return;
+    }
+    int *values = overviewTree.mutableData();
+    std::size_t n = overviewTree.size();
+    EditRange changed;
+    QString what;
+    auto start = std::chrono::steady_clock::now();
+    if (many)
+    {
+        ColumnSummary all = overviewTree.query(0, n);
+        std::mt19937 rng(QRandomGenerator::global()->generate());
+        std::uniform_int_distribution<int> value(all.minValue, all.maxValue);
+        std::vector<ValueEdit> edits(1000);
+        for (ValueEdit &edit : edits)
+        {
+            edit = {rng() % n, value(rng)};
+        }
+        start = std::chrono::steady_clock::now();
+        changed = applyEdits(values, n, std::move(edits));
+        what = "1000 random edits merged in";
+    }
+    else
+    {
+        bool ok = false;
+        int value = QInputDialog::getInt(this, "Edit value", QString("New value for element %1").arg(index),
+                                         values[index], std::numeric_limits<int>::min(),
+                                         std::numeric_limits<int>::max(), 1, &ok);
+        if (!ok)
+        {
+            return;
+        }
+        start = std::chrono::steady_clock::now();
+        std::size_t to = editSorted(values, n, index, value);
+        changed = {std::min(index, to), std::max(index, to) + 1};
+        what = QString("Element %1 moved to %2").arg(index).arg(to);
+    }
+    double editMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    overviewTree.refresh(changed.first, changed.last, overviewStamp);
+    overview->setRecent(overviewStamp++);
+    statusLabel->setText(QString("%1 in %2 ms; %3 values shifted, %4")
+                             .arg(what)
+                             .arg(editMs, 0, 'f', 3)
+                             .arg(changed.last - changed.first)
+                             .arg(overviewTree.sorted() ? "still sorted" : "NOT sorted"));
+}
+
+// Abandons a running large view; the kernel finishes without tracing
+void MainWindow::stopLargeView()
+{
+    overviewTimer->stop();
+    if (overviewQueue)
+    {
+        overviewQueue->cancel();
+    }
+    if (overviewThread.joinable())
+    {
+        overviewThread.join();
+    }
+    overviewQueue.reset();
+    overviewEntry.close();
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::MouseButtonPress)
+    {
+        auto bar = std::find(bars.begin(), bars.end(), watched);
+        if (bar != bars.end())
+        {
+            editBar(static_cast<int>(bar - bars.begin()));
+            return true;
+        }
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+// Edit the clicked bar. If the bars are sorted, the value is moved to where
+// it now belongs by a binary search and a shift, replayed like a kernel.
+void MainWindow::editBar(int index)
+{
+    if (animationTimer->isActive() || fastForwardThread.joinable() || !stringIds.empty())
+    {
+        return;
+    }
+    bool ok = false;
+    int value = QInputDialog::getInt(this, "Edit value", QString("New value for bar %1").arg(index + 1), data[index],
+                                     0, 999, 1, &ok);
+    if (!ok)
+    {
+        return;
+    }
+    if (!std::is_sorted(data.begin(), data.end()))
+    {
+        data[index] = value;
+        updateBar(index);
+        statusLabel->setText("Value changed; sort the bars first and later edits keep them in order");
+        return;
+    }
+
+    trace.clear();
+    std::vector<int> work = data;
+    std::size_t to = editSorted(work.data(), work.size(), index, value, trace);
+    heapOverlay->clear();
+    answerLast = answerFirst - 1;
+    traceSummary = QString("%1 moved from bar %2 to bar %3 without sorting again")
+                       .arg(value)
+                       .arg(index + 1)
+                       .arg(to + 1);
+    statusLabel->setText("Repairing the order...");
+    paragraphLabel->setText("<p>The bars were sorted, so one new value only has to move to where it belongs. "
+                            "A binary search on the side it moves towards finds the spot (the probes are not shown), "
+                            "and the values in between (purple) shift over by one, which in memory is a single "
+                            "memmove. That costs O(log n) comparisons plus the distance moved, instead of a whole "
+                            "sort. Many edits at once are sorted among themselves and merged into the rest.</p>");
+    traceIndex = 0;
+    replayingTrace = true;
+    animationTimer->start(500);
+}
+
+// Check if data is sorted; the steps that ask keep `sortedness` current
+bool MainWindow::isSorted()
+{
+    return sortedness.sorted();
 }
 
 void MainWindow::bubbleSortStep()
@@ -605,6 +1847,7 @@ void MainWindow::quickSortStep()
             { // Ascending order comparison
                 // Swap elements
                 std::swap(data[left], data[right]);
+                sortedness.swapped(data.data(), left, right);
 
                 // Update visuals
                 bars[left]->setText(QString::number(data[left]));
@@ -630,6 +1873,7 @@ void MainWindow::quickSortStep()
         {
             // Place pivot in its correct position
             std::swap(data[left], data[pivotIndex]);
+            sortedness.swapped(data.data(), left, pivotIndex);
 
             // Update visuals
             bars[left]->setText(QString::number(data[left]));
@@ -678,136 +1922,6 @@ void MainWindow::quickSortStep()
     }
 }
 
-void MainWindow::mergeSortStep()
-{
-    static QVector<QPair<int, int>> stack; // Stack to store sub-array ranges
-    static QVector<int> tempData;
-    static int start = -1, end = -1, mid = -1;
-
-    // Check if sorting is complete
-    if (isSorted())
-    {
-        statusLabel->setText("Sorting complete!");
-
-        // Update all bars to show sorted state
-        for (QLabel *bar : bars)
-        {
-            setStyleSheet("background-color: green;");
-        }
-
-        // Reset static variables for future sorting
-        stack.clear();
-        start = end = mid = -1; // Reset the partitioning variables
-        animationTimer->stop();
-    }
-
-    // Initialize stack with the full range during the first call
-    if (stack.isEmpty() || resetBool)
-    {
-        stack.push_back({0, data.size() - 1});
-        resetBool = false;
-    }
-
-    // If no current partitioning step is active, set up a new range
-    if (start == -1 && !stack.isEmpty())
-    {
-        // Pop the range from the stack
-        auto range = stack.takeLast();
-        start = range.first;
-        end = range.second;
-
-        // Calculate mid-point of the range
-        mid = (start + end) / 2;
-
-        // Push new sub-ranges onto the stack for further processing
-        if (start < mid)
-        {
-            stack.push_back({start, mid});
-        }
-        if (mid + 1 < end)
-        {
-            stack.push_back({mid + 1, end});
-        }
-
-        // Animate division of the array (highlight the current sub-array being processed)
-        for (int i = start; i <= end; ++i)
-        {
-            if (i >= 0 && i < bars.size() && !isSorted())
-            {
-                bars[i]->setStyleSheet("background-color: red;");
-            }
-        }
-        QCoreApplication::processEvents(); // UI update
-        return;
-    }
-
-    // Perform merge step once the range is split
-    if (start <= mid && mid + 1 <= end)
-    {
-        int n1 = mid - start + 1;
-        int n2 = end - mid;
-
-        // Create temp vectors
-        QVector<int> L(n1), R(n2);
-
-        // Copy data to temp vectors L[] and R[]
-        for (int i = 0; i < n1; ++i)
-            L[i] = data[start + i];
-        for (int j = 0; j < n2; ++j)
-            R[j] = data[mid + 1 + j];
-
-        int i = 0, j = 0, k = start;
-
-        // Merge the temp vectors back into data[start..end]
-        while (i < n1 && j < n2)
-        {
-            if (L[i] <= R[j])
-            {
-                data[k] = L[i];
-                i++;
-            }
-            else
-            {
-                data[k] = R[j];
-                j++;
-            }
-            k++;
-        }
-
-        // Copy the remaining elements of L[], if there are any
-        while (i < n1)
-        {
-            data[k] = L[i];
-            i++;
-            k++;
-        }
-
-        // Copy the remaining elements of R[], if there are any
-        while (j < n2)
-        {
-            data[k] = R[j];
-            j++;
-            k++;
-        }
-
-        // Update visuals after merging
-        for (int i = start; i <= end; ++i)
-        {
-            if (i >= 0 && i < bars.size())
-            {
-                bars[i]->setText(QString::number(data[i]));
-                bars[i]->setStyleSheet("background-color: blue;");
-            }
-        }
-
-        QCoreApplication::processEvents(); // Ensure UI updates
-
-        // Reset indices to process the next range
-        start = end = mid = -1; // Reset after a merge step
-        return;
-    }
-}
-
 void MainWindow::insertionSortStep()
 {
     static int i = 1;
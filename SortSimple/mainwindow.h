@@ -8,8 +8,24 @@
 #include <QHBoxLayout>
 #include <QWidget>
 #include <QTimer>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <QLabel>
+#include "clustersort.h"
+#include "columntree.h"
+#include "editsort.h"
+#include "inputprofile.h"
+#include "mergesort.h"
+#include "perfcounters.h"
+#include "sortedness.h"
+#include "sorttrace.h"
+#include "stringsort.h"
+#include "tracecache.h"
+
+class ArrayOverview;
+class HeapTreeOverlay;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -22,33 +38,82 @@ private slots:
     void startSorting(); // Slot to handle sorting
     void performStep();  // Slot to handle animation steps
     void resetSorting();  // Slot for resetting the sorting
+    void loadRepeatedValues(); // Slot to put a sample with repeated values on the bars
+    void showCacheHeatmap(); // Slot to color the bars by simulated cache traffic
+    void startFastForward(); // Slot to run the selected kernel on a large input
+    void updatePerfReadout(); // Slot to show the fast-forward counters so far
+    void startLargeView(); // Slot to watch the selected kernel sort 10M values
+    void largeViewStep(); // Slot to apply and draw one frame of that run
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;  // Clicks on the bars
 
 private:
     void setupUI();      // Function to set up the UI
     void bubbleSortStep(); // Step for bubble sort animation
     void quickSortStep(); // Step for quick sort animation
-    void mergeSortStep(); // Step for merge sort animation
     void insertionSortStep(); // Step for insertion sort animation
     void selectionSortStep(); // Step for selection sort animation
+    void traceStep();     // Replays one recorded kernel operation
+    void clusterStep();   // Shows the cluster's global array, colored by owning process
     bool isSorted();
     void applyStyles();
+    void loadStringData();
+    void updateBar(int index);
+    void stopLargeView();
+    void editBar(int index);
+    void editLargeView(std::size_t index, bool many);
 
     QWidget *m_centralWidget;
     QComboBox *algorithmSelector;
     QPushButton *startButton;
     QPushButton *resetButton;
+    QPushButton *repeatsButton;
+    QPushButton *cacheButton;
+    QPushButton *fastForwardButton;
+    QPushButton *largeButton;
     QLabel *statusLabel;
     QLabel *paragraphLabel;
 
     std::vector<int> data;       // Array to sort
+    SortednessTracker sortedness; // Descents of data, kept current by the quick and merge sort steps
     std::vector<QLabel *> bars;  // Bar widgets for visualization
     int currentIndex;            // Index for sorting steps
     int currentSwapIndex;
     bool resetBool = false;
     QTimer *animationTimer;      // Timer for step animation
+
+    SortTrace trace;             // Operations recorded by an engine kernel
+    std::size_t traceIndex = 0;  // Next event to replay
+    bool replayingTrace = false; // performStep() replays `trace` instead of a step function
+    StringArena stringArena;     // Sample strings for the string kernels
+    std::vector<int> stringIds;  // Id of the string shown on each bar; empty for ints
+    MergeWorkspace mergeWorkspace;
+    HeapTreeOverlay *heapOverlay = nullptr;  // Tree drawn over the bars by the heap sorts
+    unsigned heapArity = 2;                  // Children per node of the heap being replayed
+    int answerFirst = 0;                     // Selection modes: the bars that hold the answer,
+    int answerLast = -1;                     // turned green at the end; last < first means all
+    QString traceSummary;                    // Shown instead of "Sorting complete!" when set
+    std::unique_ptr<ClusterSort> cluster;    // Worker processes sorting the bars; performStep() polls them
+
+    QTimer *perfTimer;                            // Refreshes the readout during fast-forward
+    std::thread fastForwardThread;                // Sorts the large input off the GUI thread
+    std::unique_ptr<PerfCounters> fastForwardCounters; // Opened by, and counting, that thread
+    std::atomic<bool> fastForwardDone{false};
+    std::size_t fastForwardSize = 0;
+
+    QTimer *overviewTimer;                         // One frame of the large run per tick
+    ArrayOverview *overview = nullptr;             // Replaces the bars during a large run
+    ColumnTree overviewTree;                       // The large array, as the trace has left it so far
+    std::unique_ptr<TraceQueue> overviewQueue;     // Trace batches from the kernel's thread
+    std::thread overviewThread;
+    std::atomic<bool> overviewDone{false};
+    std::vector<TraceEvent> overviewBatch;
+    std::uint32_t overviewStamp = 1;               // Frame number, used as the tree's touch stamp
+    std::uint64_t overviewEvents = 0;
+    TraceCache traceCache;                         // Large runs recorded on disk, replayed when run again
+    TraceCacheEntry overviewEntry;                 // The cached run being replayed, if any
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,207 @@
+#include "mergesort.h"
+#include <algorithm>
+
+namespace {
+
+template <typename Trace>
+void insertionSort(int *a, std::size_t first, std::size_t sortedEnd, std::size_t last, Trace &trace)
+{
+    for (std::size_t i = sortedEnd; i < last; ++i)
+    {
+        int key = a[i];
+        std::size_t j = i;
+        while (j > first)
+        {
+            trace.compare(j - 1, i);
+            if (a[j - 1] <= key)
+            {
+                break;
+            }
+            a[j] = a[j - 1];
+            trace.write(j, a[j]);
+            --j;
+        }
+        a[j] = key;
+        trace.write(j, key);
+    }
+}
+
+// Splits a[0, n) into sorted runs of at least minRun elements (except the
+// last) and returns how many there are; runs[0..count] are their bounds
+template <typename Trace>
+std::size_t findRuns(int *a, std::size_t n, std::size_t *runs, std::size_t minRun, bool network, Trace &trace)
+{
+    std::size_t count = 0;
+    std::size_t start = 0;
+    while (start < n)
+    {
+        std::size_t end = start + 1;
+        if (end < n)
+        {
+            trace.compare(start, end);
+            if (a[end] < a[start])
+            {
+                // Strictly descending, so reversing keeps the sort stable
+                while (end + 1 < n && a[end + 1] < a[end])
+                {
+                    trace.compare(end, end + 1);
+                    ++end;
+                }
+                ++end;
+                for (std::size_t lo = start, hi = end - 1; lo < hi; ++lo, --hi)
+                {
+                    std::swap(a[lo], a[hi]);
+                    trace.swap(lo, hi);
+                }
+            }
+            else
+            {
+                while (end + 1 < n && a[end + 1] >= a[end])
+                {
+                    trace.compare(end, end + 1);
+                    ++end;
+                }
+                ++end;
+            }
+        }
+
+        std::size_t target = std::min(n, start + minRun);
+        if (end < target)
+        {
+            trace.mark(TagRun, start, target - 1);
+            // Equal ints are interchangeable, so an unstable network is fine
+            if (network && target - start <= kMaxNetworkSize)
+            {
+                networkSortRange(a, start, target, trace);
+            }
+            else
+            {
+                insertionSort(a, start, end, target, trace);
+            }
+            end = target;
+        }
+        runs[count++] = start;
+        start = end;
+    }
+    runs[count] = n;
+    return count;
+}
+
+// Merge of src[lo, mid) and src[mid, hi) into dst[lo, hi). Untraced runs
+// use `kernel`; the traced path merges one stable step per event.
+template <typename Trace>
+void merge(const int *src, int *dst, int dstBuffer, std::size_t lo, std::size_t mid, std::size_t hi,
+           MergeKernel kernel, Trace &trace)
+{
+    if (!Trace::enabled)
+    {
+        mergeSorted(src + lo, mid - lo, src + mid, hi - mid, dst + lo, kernel);
+        return;
+    }
+    std::size_t i = lo, j = mid, k = lo;
+    while (i < mid && j < hi)
+    {
+        trace.compare(i, j, dstBuffer ^ 1);
+        dst[k] = src[j] < src[i] ? src[j++] : src[i++];
+        trace.write(k, dst[k], dstBuffer);
+        ++k;
+    }
+    while (i < mid)
+    {
+        dst[k] = src[i++];
+        trace.write(k, dst[k], dstBuffer);
+        ++k;
+    }
+    while (j < hi)
+    {
+        dst[k] = src[j++];
+        trace.write(k, dst[k], dstBuffer);
+        ++k;
+    }
+}
+
+template <typename Trace>
+void mergeSort(int *a, std::size_t n, int *aux, std::size_t *runs, Trace &trace, MergeSortOptions options)
+{
+    std::size_t minRun = std::max<std::size_t>(1, options.minRun);
+    std::size_t count = findRuns(a, n, runs, minRun, options.smallSort == SmallSort::Network, trace);
+
+    int *src = a;
+    int *dst = aux;
+    int dstBuffer = 1;
+    while (count > 1)
+    {
+        std::size_t merged = 0;
+        for (std::size_t r = 0; r < count; r += 2)
+        {
+            std::size_t lo = runs[r];
+            if (r + 1 < count)
+            {
+                std::size_t mid = runs[r + 1], hi = runs[r + 2];
+                trace.mark(TagRange, lo, hi - 1);
+                merge(src, dst, dstBuffer, lo, mid, hi, options.mergeKernel, trace);
+            }
+            else
+            {
+                // Odd run out still has to move so the buffers stay whole
+                for (std::size_t k = lo; k < runs[r + 1]; ++k)
+                {
+                    dst[k] = src[k];
+                    trace.write(k, dst[k], dstBuffer);
+                }
+            }
+            runs[merged++] = lo;
+        }
+        runs[merged] = n;
+        count = merged;
+        std::swap(src, dst);
+        dstBuffer ^= 1;
+    }
+
+    if (src != a)
+    {
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            a[k] = src[k];
+            trace.write(k, a[k]);
+        }
+    }
+}
+
+} // namespace
+
+template <typename Trace>
+void bottomUpMergeSort(int *a, std::size_t n, MergeWorkspace &workspace, Trace &trace, MergeSortOptions options)
+{
+    if (n < 2)
+    {
+        return;
+    }
+    std::size_t minRun = std::max<std::size_t>(1, options.minRun);
+    if (workspace.aux.size() < n || workspace.runs.size() < n / minRun + 2)
+    {
+        workspace.reserve(n, minRun);
+    }
+    mergeSort(a, n, workspace.aux.data(), workspace.runs.data(), trace, options);
+}
+
+void bottomUpMergeSort(int *a, std::size_t n, int *aux, std::size_t *runs, MergeSortOptions options)
+{
+    if (n < 2)
+    {
+        return;
+    }
+    NullTrace trace;
+    mergeSort(a, n, aux, runs, trace, options);
+}
+
+void bottomUpMergeSort(int *a, std::size_t n, MergeWorkspace &workspace)
+{
+    NullTrace trace;
+    bottomUpMergeSort(a, n, workspace, trace);
+}
+
+template void bottomUpMergeSort<SortTrace>(int *, std::size_t, MergeWorkspace &, SortTrace &, MergeSortOptions);
+template void bottomUpMergeSort<NullTrace>(int *, std::size_t, MergeWorkspace &, NullTrace &, MergeSortOptions);
+template void bottomUpMergeSort<StreamingTrace>(int *, std::size_t, MergeWorkspace &, StreamingTrace &,
+                                                MergeSortOptions);
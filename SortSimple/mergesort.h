@@ -0,0 +1,48 @@
+#ifndef MERGESORT_H
+#define MERGESORT_H
+
+#include "bitonicmerge.h"
+#include "sortnetwork.h"
+#include "sorttrace.h"
+#include <cstddef>
+#include <vector>
+
+struct MergeSortOptions
+{
+    std::size_t minRun = 32;  // Natural runs shorter than this are extended to this length
+    // Network sorts the whole minRun chunk when it fits kMaxNetworkSize;
+    // Insertion grows the natural run one element at a time
+    SmallSort smallSort = SmallSort::Network;
+    // Merge step for untraced runs; traced runs always merge one element at a time
+    MergeKernel mergeKernel = MergeKernel::Bitonic8;
+};
+
+// Scratch space for bottomUpMergeSort. Reserve it once for the largest input
+// and every later sort runs without touching the heap.
+struct MergeWorkspace
+{
+    void reserve(std::size_t n, std::size_t minRun = MergeSortOptions().minRun)
+    {
+        aux.resize(n);
+        runs.resize(n / minRun + 2);
+    }
+
+    std::vector<int> aux;             // Ping-pong partner of the input array
+    std::vector<std::size_t> runs;    // Start index of every run, plus the end
+};
+
+// Stable bottom-up merge sort. The first pass finds natural runs (reversing
+// descending ones) and grows short runs to minRun; each
+// later pass merges neighbouring runs from one buffer into the other and
+// swaps their roles, so no data is copied between passes. In the trace,
+// buffer 1 shares the index space of the input array.
+template <typename Trace>
+void bottomUpMergeSort(int *a, std::size_t n, MergeWorkspace &workspace, Trace &trace,
+                       MergeSortOptions options = {});
+void bottomUpMergeSort(int *a, std::size_t n, MergeWorkspace &workspace);
+
+// The same sort in scratch the caller owns: `aux` holds n ints and `runs`
+// n / minRun + 2 entries
+void bottomUpMergeSort(int *a, std::size_t n, int *aux, std::size_t *runs, MergeSortOptions options = {});
+
+#endif // MERGESORT_H
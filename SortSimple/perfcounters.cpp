@@ -0,0 +1,210 @@
+#include "perfcounters.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *perfEventName(PerfEvent event)
+{
+    switch (event)
+    {
+    case PerfCycles:
+        return "cycles";
+    case PerfInstructions:
+        return "instructions";
+    case PerfBranchMisses:
+        return "branch-misses";
+    case PerfL1dMisses:
+        return "L1D-misses";
+    case PerfLlcMisses:
+        return "LLC-misses";
+    case PerfDtlbMisses:
+        return "dTLB-misses";
+    default:
+        return "?";
+    }
+}
+
+double PerfSample::ipc() const
+{
+    if (!has(PerfCycles) || !has(PerfInstructions) || counts[PerfCycles] == 0)
+    {
+        return 0.0;
+    }
+    return double(counts[PerfInstructions]) / counts[PerfCycles];
+}
+
+#ifdef __linux__
+
+namespace {
+
+std::uint64_t cacheMiss(std::uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+int openCounter(PerfEvent event)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event)
+    {
+    case PerfCycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfInstructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfBranchMisses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PerfL1dMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cacheMiss(PERF_COUNT_HW_CACHE_L1D);
+        break;
+    case PerfLlcMisses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cacheMiss(PERF_COUNT_HW_CACHE_DTLB);
+        break;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    for (int e = 0; e < PerfEventCount; ++e)
+    {
+        fds[e] = openCounter(PerfEvent(e));
+        if (fds[e] >= 0)
+        {
+            ++opened;
+        }
+        else if (error.empty())
+        {
+            error = std::string("perf_event_open(") + perfEventName(PerfEvent(e)) + "): " + std::strerror(errno);
+            if (errno == EACCES || errno == EPERM)
+            {
+                error += " (see /proc/sys/kernel/perf_event_paranoid)";
+            }
+        }
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start()
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+    startTime = Clock::now();
+    running.store(true, std::memory_order_release);
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop()
+{
+    for (int fd : fds)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    stopTime = Clock::now();
+    running.store(false, std::memory_order_release);
+}
+
+PerfSample PerfCounters::sample() const
+{
+    PerfSample s;
+    bool live = running.load(std::memory_order_acquire);
+    s.milliseconds = std::chrono::duration<double, std::milli>((live ? Clock::now() : stopTime) - startTime).count();
+    for (int e = 0; e < PerfEventCount; ++e)
+    {
+        // value, time enabled, time running
+        std::uint64_t buffer[3];
+        if (fds[e] < 0 || ::read(fds[e], buffer, sizeof(buffer)) != sizeof(buffer) || buffer[2] == 0)
+        {
+            continue;
+        }
+        // Scale up when the kernel had to time-share the counter with others
+        s.counts[e] = buffer[2] < buffer[1] ? std::uint64_t(double(buffer[0]) * buffer[1] / buffer[2]) : buffer[0];
+        s.measured[e] = true;
+    }
+    return s;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : error("hardware counters need Linux perf_event_open")
+{
+    for (int &fd : fds)
+    {
+        fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start()
+{
+    startTime = Clock::now();
+    running.store(true, std::memory_order_release);
+}
+
+void PerfCounters::stop()
+{
+    stopTime = Clock::now();
+    running.store(false, std::memory_order_release);
+}
+
+PerfSample PerfCounters::sample() const
+{
+    PerfSample s;
+    bool live = running.load(std::memory_order_acquire);
+    s.milliseconds = std::chrono::duration<double, std::milli>((live ? Clock::now() : stopTime) - startTime).count();
+    return s;
+}
+
+#endif
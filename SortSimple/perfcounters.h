@@ -0,0 +1,67 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum PerfEvent
+{
+    PerfCycles = 0,
+    PerfInstructions,
+    PerfBranchMisses,
+    PerfL1dMisses,
+    PerfLlcMisses,
+    PerfDtlbMisses,
+    PerfEventCount
+};
+
+const char *perfEventName(PerfEvent event);
+
+struct PerfSample
+{
+    double milliseconds = 0;
+    std::uint64_t counts[PerfEventCount] = {};
+    bool measured[PerfEventCount] = {};  // False when the counter could not be opened
+
+    bool has(PerfEvent event) const { return measured[event]; }
+    double perElement(PerfEvent event, std::size_t n) const { return n ? double(counts[event]) / n : 0.0; }
+    double ipc() const;  // Instructions per cycle, 0 without both counters
+};
+
+// Hardware counters for the calling thread through Linux perf_event_open,
+// user space only. Each counter is opened on its own so one the CPU or the
+// container does not offer leaves the others working; with none available
+// the object still measures wall-clock time, which is all other platforms get.
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const { return opened > 0; }
+    // Why some or all counters are missing; empty when every one opened
+    const std::string &errorString() const { return error; }
+
+    void start();  // Resets and enables every counter
+    void stop();
+    // Counts so far, scaled for multiplexing. Safe to call from another
+    // thread while the owning thread runs between start() and stop().
+    PerfSample sample() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int fds[PerfEventCount];
+    int opened = 0;
+    std::string error;
+    Clock::time_point startTime;
+    Clock::time_point stopTime;
+    std::atomic<bool> running{false};
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,669 @@
+#include "quicksort.h"
+#include "heapsort.h"
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kMaxBlock = 128;
+
+// Insertion sort of a[first, last) with absolute indices so the trace lines up
+template <typename Trace>
+void insertionRange(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    for (std::size_t i = first + 1; i < last; ++i)
+    {
+        int key = a[i];
+        std::size_t j = i;
+        while (j > first)
+        {
+            trace.compare(j - 1, j);
+            if (a[j - 1] <= key)
+            {
+                break;
+            }
+            a[j] = a[j - 1];
+            trace.write(j, a[j]);
+            --j;
+        }
+        a[j] = key;
+        trace.write(j, key);
+    }
+}
+
+template <typename Trace>
+void swapAt(int *a, std::size_t i, std::size_t j, Trace &trace)
+{
+    std::swap(a[i], a[j]);
+    trace.swap(i, j);
+}
+
+// Orders a[i] <= a[j] <= a[k] in place, leaving the median at j. The
+// smallest and largest samples end up on their own sides of the pivot,
+// which keeps reversed and similar inputs from splitting off two at a time.
+template <typename Trace>
+void sort3(int *a, std::size_t i, std::size_t j, std::size_t k, Trace &trace)
+{
+    if ((trace.compare(i, j), a[j] < a[i]))
+    {
+        swapAt(a, i, j, trace);
+    }
+    if ((trace.compare(j, k), a[k] < a[j]))
+    {
+        swapAt(a, j, k, trace);
+        if ((trace.compare(i, j), a[j] < a[i]))
+        {
+            swapAt(a, i, j, trace);
+        }
+    }
+}
+
+// Index of the median of a[i], a[j] and a[k]; compares only, moves nothing
+template <typename Trace>
+std::size_t median3(int *a, std::size_t i, std::size_t j, std::size_t k, Trace &trace)
+{
+    trace.compare(i, j);
+    if (a[i] < a[j])
+    {
+        trace.compare(j, k);
+        if (a[j] < a[k])
+        {
+            return j;
+        }
+        trace.compare(i, k);
+        return a[i] < a[k] ? k : i;
+    }
+    trace.compare(i, k);
+    if (a[i] < a[k])
+    {
+        return i;
+    }
+    trace.compare(j, k);
+    return a[j] < a[k] ? k : j;
+}
+
+// splitmix64
+std::uint64_t nextRandom(std::uint64_t &state)
+{
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Insertion sort by adjacent swaps, for groups of at most five
+template <typename Trace>
+void sortGroup(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    for (std::size_t i = first + 1; i < last; ++i)
+    {
+        for (std::size_t j = i; j > first && (trace.compare(j - 1, j), a[j] < a[j - 1]); --j)
+        {
+            swapAt(a, j - 1, j, trace);
+        }
+    }
+}
+
+template <typename Trace>
+void selectNth(int *a, std::size_t first, std::size_t last, std::size_t nth, Trace &trace);
+
+// Median of the medians of groups of five (Blum, Floyd, Pratt, Rivest and
+// Tarjan). The group medians are gathered at the front of the range and
+// the exact median among them selected there; at least 3/10 of the range
+// is then on either side of it. Returns its index.
+template <typename Trace>
+std::size_t medianOfMedians(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    if (last - first <= 5)
+    {
+        sortGroup(a, first, last, trace);
+        return first + (last - first - 1) / 2;
+    }
+    std::size_t medians = first;
+    for (std::size_t group = first; group < last; group += 5)
+    {
+        std::size_t end = std::min(group + 5, last);
+        sortGroup(a, group, end, trace);
+        std::size_t median = group + (end - group - 1) / 2;
+        if (median != medians)
+        {
+            swapAt(a, medians, median, trace);
+        }
+        ++medians;
+    }
+    std::size_t mid = first + (medians - first - 1) / 2;
+    selectNth(a, first, medians, mid, trace);
+    return mid;
+}
+
+// Moves the pivot chosen by `strategy` for a[first, last) to a[last - 1]
+template <typename Trace>
+void pivotToBack(int *a, std::size_t first, std::size_t last, PivotStrategy strategy, std::uint64_t &random,
+                 Trace &trace)
+{
+    std::size_t n = last - first;
+    std::size_t back = last - 1;
+    std::size_t mid = first + n / 2;
+    std::size_t pick = back;
+    switch (strategy)
+    {
+    case PivotStrategy::Last:
+        break;
+    case PivotStrategy::Random:
+        pick = first + nextRandom(random) % n;
+        break;
+    case PivotStrategy::MedianOfThree:
+        sort3(a, first, mid, back, trace);
+        pick = mid;
+        break;
+    case PivotStrategy::Ninther:
+        if (n < 128)
+        {
+            sort3(a, first, mid, back, trace);
+            pick = mid;
+        }
+        else
+        {
+            std::size_t d = n / 8;
+            pick = median3(a, median3(a, first, first + d, first + 2 * d, trace), median3(a, mid - d, mid, mid + d, trace),
+                           median3(a, back - 2 * d, back - d, back, trace), trace);
+        }
+        break;
+    case PivotStrategy::MedianOfMedians:
+        pick = medianOfMedians(a, first, last, trace);
+        break;
+    }
+    if (pick != back)
+    {
+        swapAt(a, pick, back, trace);
+    }
+}
+
+// Hoare-style scan of a[l, r) against `pivot`. Returns the split: everything
+// before it is <= pivot, everything from it on is >= pivot.
+template <typename Trace>
+std::size_t hoareScan(int *a, std::size_t l, std::size_t r, int pivot, std::size_t pivotIndex, Trace &trace)
+{
+    while (true)
+    {
+        while (l < r && (trace.compare(l, pivotIndex), a[l] < pivot))
+        {
+            ++l;
+        }
+        while (l < r && (trace.compare(r - 1, pivotIndex), a[r - 1] > pivot))
+        {
+            --r;
+        }
+        if (r - l < 2)
+        {
+            return l;  // A single element left over equals the pivot
+        }
+        swapAt(a, l, r - 1, trace);
+        ++l;
+        --r;
+    }
+}
+
+// Partitions a[l, r) in blocks: each side records the offsets of elements
+// that belong on the other side, with the comparison result added to a
+// counter instead of branched on, then matched offsets are swapped. The
+// last few blocks' worth is finished by hoareScan.
+template <typename Trace>
+std::size_t blockScan(int *a, std::size_t l, std::size_t r, int pivot, std::size_t pivotIndex,
+                      std::size_t block, Trace &trace)
+{
+    std::uint8_t offsetsL[kMaxBlock];
+    std::uint8_t offsetsR[kMaxBlock];
+    std::size_t numL = 0, numR = 0, startL = 0, startR = 0;
+
+    while (r - l > 2 * block)
+    {
+        if (numL == 0)
+        {
+            startL = 0;
+            trace.mark(TagBlock, l, l + block - 1);
+            for (std::size_t i = 0; i < block; ++i)
+            {
+                trace.compare(l + i, pivotIndex);
+                offsetsL[numL] = static_cast<std::uint8_t>(i);
+                numL += a[l + i] >= pivot;
+            }
+        }
+        if (numR == 0)
+        {
+            startR = 0;
+            trace.mark(TagBlock, r - block, r - 1);
+            for (std::size_t i = 0; i < block; ++i)
+            {
+                trace.compare(r - 1 - i, pivotIndex);
+                offsetsR[numR] = static_cast<std::uint8_t>(i);
+                numR += a[r - 1 - i] <= pivot;
+            }
+        }
+
+        std::size_t num = std::min(numL, numR);
+        for (std::size_t k = 0; k < num; ++k)
+        {
+            swapAt(a, l + offsetsL[startL + k], r - 1 - offsetsR[startR + k], trace);
+        }
+        numL -= num;
+        numR -= num;
+        startL += num;
+        startR += num;
+        // A block is done once all its misplaced elements were swapped out
+        if (numL == 0)
+        {
+            l += block;
+        }
+        if (numR == 0)
+        {
+            r -= block;
+        }
+    }
+    // A half-finished block still holds misplaced elements; the scan fixes them
+    return hoareScan(a, l, r, pivot, pivotIndex, trace);
+}
+
+// Dijkstra's Dutch national flag pass over a[first, last) with the pivot at
+// a[last - 1]. Returns {lt, gt}: [first, lt) < pivot, [lt, gt) == pivot and
+// [gt, last) > pivot. The pivot starts at the front so the equal band is
+// never empty and a[lt] always holds a copy to compare against.
+template <typename Trace>
+std::pair<std::size_t, std::size_t> threeWayScan(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    swapAt(a, first, last - 1, trace);
+    int pivot = a[first];
+    std::size_t lt = first, i = first + 1, gt = last;
+    while (i < gt)
+    {
+        trace.compare(i, lt);
+        if (a[i] < pivot)
+        {
+            swapAt(a, lt++, i++, trace);
+        }
+        else if (pivot < a[i])
+        {
+            swapAt(a, i, --gt, trace);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return {lt, gt};
+}
+
+// Moves every key <= pivot in a[first, last) to the front and returns where
+// they end. Used when a[first - 1], which no key in the range is below,
+// equals the pivot: the keys moved are then exactly its copies.
+template <typename Trace>
+std::size_t gatherEqual(int *a, std::size_t first, std::size_t last, int pivot, std::size_t pivotIndex, Trace &trace)
+{
+    std::size_t equal = first;
+    for (std::size_t i = first; i < last; ++i)
+    {
+        trace.compare(i, pivotIndex);
+        if (!(pivot < a[i]))
+        {
+            if (equal != i)
+            {
+                swapAt(a, equal, i, trace);
+            }
+            ++equal;
+        }
+    }
+    return equal;
+}
+
+// Puts the nth smallest key of a[first, last) at a[nth], with smaller keys
+// before it and larger ones after: quickselect on median-of-medians pivots,
+// so linear in the worst case
+template <typename Trace>
+void selectNth(int *a, std::size_t first, std::size_t last, std::size_t nth, Trace &trace)
+{
+    while (last - first > 5)
+    {
+        std::size_t pick = medianOfMedians(a, first, last, trace);
+        if (pick != last - 1)
+        {
+            swapAt(a, pick, last - 1, trace);
+        }
+        trace.mark(TagPivot, last - 1, last - 1);
+        auto bands = threeWayScan(a, first, last, trace);
+        if (nth < bands.first)
+        {
+            last = bands.first;
+        }
+        else if (nth >= bands.second)
+        {
+            first = bands.second;
+        }
+        else
+        {
+            return;
+        }
+    }
+    sortGroup(a, first, last, trace);
+}
+
+// Stands in for the trace to build a killer input, answering comparisons
+// as McIlroy's adversary does. Keys start as "gas", encoded as n + their
+// original position, which is bigger than every value given out so far; a
+// gas key is frozen to the next free value when it becomes the pivot or
+// is compared with another gas key. Every comparison is announced before
+// its keys are read, so freezing in the callback changes what it sees.
+class AdversaryTrace
+{
+public:
+    static constexpr bool enabled = true;
+
+    AdversaryTrace(int *a, std::size_t n) : a(a), gas(static_cast<int>(n)), frozen(n, -1) {}
+
+    void read(std::size_t, int = 0) {}
+    void compare(std::size_t i, std::size_t j, int = 0)
+    {
+        if (isGas(i) && isGas(j))
+        {
+            freeze(a[i] - gas == candidate ? i : j);
+        }
+        if (isGas(i))
+        {
+            candidate = a[i] - gas;
+        }
+        else if (isGas(j))
+        {
+            candidate = a[j] - gas;
+        }
+    }
+    void swap(std::size_t, std::size_t) {}
+    void write(std::size_t, int, int = 0) {}
+    void mark(TraceTag tag, std::size_t first, std::size_t)
+    {
+        if (tag == TagPivot && isGas(first))
+        {
+            freeze(first);
+        }
+    }
+
+    // The input that makes the same comparisons come out the same way. Keys
+    // never frozen get the remaining, largest values.
+    std::vector<int> input()
+    {
+        for (std::size_t k = 0; k < frozen.size(); ++k)
+        {
+            if (isGas(k))
+            {
+                freeze(k);
+            }
+        }
+        return frozen;
+    }
+
+private:
+    bool isGas(std::size_t i) const { return a[i] >= gas; }
+    void freeze(std::size_t i)
+    {
+        frozen[a[i] - gas] = next;
+        a[i] = next++;
+    }
+
+    int *a;
+    int gas;
+    int next = 0;
+    int candidate = -1;
+    std::vector<int> frozen;  // Value given to each original position
+};
+
+// Ranges that finish with the small sort or heapsort are never looked at
+// again, so any order they end in agrees with the adversary's answers. It
+// skips them: the small sorts read keys without announcing each comparison.
+template <typename Trace>
+void finishSmall(int *a, std::size_t first, std::size_t last, bool network, Trace &trace)
+{
+    if (network)
+    {
+        networkSortRange(a, first, last, trace);
+    }
+    else
+    {
+        insertionRange(a, first, last, trace);
+    }
+}
+
+template <typename Trace>
+void finishDeep(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    heapSortRange(a, first, last, trace);
+}
+
+void finishSmall(int *, std::size_t, std::size_t, bool, AdversaryTrace &) {}
+void finishDeep(int *, std::size_t, std::size_t, AdversaryTrace &) {}
+
+} // namespace
+
+const char *pivotStrategyName(PivotStrategy strategy)
+{
+    switch (strategy)
+    {
+    case PivotStrategy::Last:
+        return "last";
+    case PivotStrategy::Random:
+        return "random";
+    case PivotStrategy::MedianOfThree:
+        return "median of 3";
+    case PivotStrategy::Ninther:
+        return "ninther";
+    case PivotStrategy::MedianOfMedians:
+        return "median of medians";
+    }
+    return "?";
+}
+
+namespace {
+
+// Settings derived once per call from QuicksortOptions
+struct PartitionSetup
+{
+    explicit PartitionSetup(std::size_t n, const QuicksortOptions &options)
+        : options(options), block(std::max<std::size_t>(1, std::min(options.blockSize, kMaxBlock))),
+          network(options.smallSort == SmallSort::Network), cutoff(std::max<std::size_t>(options.smallCutoff, 2)),
+          random(options.seed)
+    {
+        if (network)
+        {
+            cutoff = std::min(cutoff, kMaxNetworkSize);
+        }
+        // Partition levels a range may go through before the fallback takes it
+        if (options.depthLimit)
+        {
+            budget = 0;
+            for (std::size_t m = n; m > 1; m /= 2)
+            {
+                budget += 2;
+            }
+        }
+    }
+
+    const QuicksortOptions &options;
+    std::size_t block;
+    bool network;
+    std::size_t cutoff;
+    std::uint64_t random;
+    unsigned budget = ~0u;
+};
+
+// Chooses a pivot for a[first, last) and partitions around it. Returns
+// {lessEnd, greaterBegin}: nothing before lessEnd is bigger than the pivot,
+// nothing from greaterBegin on is smaller, and the keys in between equal it
+// and are in their final place. Each side keeps the invariant that
+// a[first - 1] is no bigger than any key in it.
+template <typename Trace>
+std::pair<std::size_t, std::size_t> partitionRange(int *a, std::size_t first, std::size_t last,
+                                                   PartitionSetup &setup, Trace &trace)
+{
+    trace.mark(TagRange, first, last - 1);
+    pivotToBack(a, first, last, setup.options.pivot, setup.random, trace);
+    std::size_t pivotIndex = last - 1;
+    trace.mark(TagPivot, pivotIndex, pivotIndex);
+    int pivot = a[pivotIndex];
+
+    if (setup.options.partition == PartitionScheme::ThreeWay)
+    {
+        auto bands = threeWayScan(a, first, last, trace);
+        trace.mark(TagEqual, bands.first, bands.second - 1);
+        return bands;
+    }
+    if (setup.options.groupDuplicates && first > 0 &&
+        (trace.compare(first - 1, pivotIndex), !(a[first - 1] < pivot)))
+    {
+        std::size_t equal = gatherEqual(a, first, last, pivot, pivotIndex, trace);
+        trace.mark(TagEqual, first, equal - 1);
+        return {first, equal};
+    }
+    std::size_t split = setup.options.partition == PartitionScheme::Block
+                            ? blockScan(a, first, pivotIndex, pivot, pivotIndex, setup.block, trace)
+                            : hoareScan(a, first, pivotIndex, pivot, pivotIndex, trace);
+    swapAt(a, split, pivotIndex, trace);
+    return {split, split + 1};
+}
+
+// Quicksort that only finishes ranges starting before `keep`: the rest are
+// partitioned away from the front and then dropped
+template <typename Trace>
+void quicksortPrefix(int *a, std::size_t n, std::size_t keep, Trace &trace, const QuicksortOptions &options)
+{
+    PartitionSetup setup(n, options);
+
+    // Explicit stack of pending ranges. The larger side is pushed and the
+    // smaller one sorted first, so each entry is at most half the one below.
+    struct Range
+    {
+        std::size_t first;
+        std::size_t last;
+        unsigned budget;
+    };
+    Range stack[64];
+    std::size_t depth = 0;
+    std::size_t first = 0, last = n;
+    while (true)
+    {
+        if (first < keep)
+        {
+            if (last - first > setup.cutoff && setup.budget > 0)
+            {
+                --setup.budget;
+                auto bands = partitionRange(a, first, last, setup, trace);
+                if (bands.first - first < last - bands.second)
+                {
+                    stack[depth++] = {bands.second, last, setup.budget};
+                    last = bands.first;
+                }
+                else
+                {
+                    stack[depth++] = {first, bands.first, setup.budget};
+                    first = bands.second;
+                }
+                continue;
+            }
+            if (last - first <= setup.cutoff)
+            {
+                finishSmall(a, first, last, setup.network, trace);
+            }
+            else
+            {
+                trace.mark(TagRange, first, last - 1);
+                finishDeep(a, first, last, trace);
+            }
+        }
+        if (depth == 0)
+        {
+            return;
+        }
+        --depth;
+        first = stack[depth].first;
+        last = stack[depth].last;
+        setup.budget = stack[depth].budget;
+    }
+}
+
+} // namespace
+
+template <typename Trace>
+void quicksort(int *a, std::size_t n, Trace &trace, QuicksortOptions options)
+{
+    quicksortPrefix(a, n, n, trace, options);
+}
+
+template <typename Trace>
+void partialQuicksort(int *a, std::size_t n, std::size_t k, Trace &trace, QuicksortOptions options)
+{
+    quicksortPrefix(a, n, std::min(k, n), trace, options);
+}
+
+template <typename Trace>
+void nthElement(int *a, std::size_t n, std::size_t nth, Trace &trace, QuicksortOptions options)
+{
+    if (nth >= n)
+    {
+        return;
+    }
+    PartitionSetup setup(n, options);
+    std::size_t first = 0, last = n;
+    while (last - first > setup.cutoff)
+    {
+        if (setup.budget == 0)
+        {
+            // Median of medians is linear whatever the input
+            trace.mark(TagRange, first, last - 1);
+            selectNth(a, first, last, nth, trace);
+            return;
+        }
+        --setup.budget;
+        auto bands = partitionRange(a, first, last, setup, trace);
+        if (nth < bands.first)
+        {
+            last = bands.first;
+        }
+        else if (nth >= bands.second)
+        {
+            first = bands.second;
+        }
+        else
+        {
+            return;  // a[nth] equals the pivot and is already in place
+        }
+    }
+    finishSmall(a, first, last, setup.network, trace);
+}
+
+void quicksort(int *a, std::size_t n, QuicksortOptions options)
+{
+    NullTrace trace;
+    quicksort(a, n, trace, options);
+}
+
+template void quicksort<SortTrace>(int *, std::size_t, SortTrace &, QuicksortOptions);
+template void quicksort<NullTrace>(int *, std::size_t, NullTrace &, QuicksortOptions);
+template void quicksort<StreamingTrace>(int *, std::size_t, StreamingTrace &, QuicksortOptions);
+
+template void partialQuicksort<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, QuicksortOptions);
+template void partialQuicksort<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, QuicksortOptions);
+template void partialQuicksort<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, QuicksortOptions);
+
+template void nthElement<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, QuicksortOptions);
+template void nthElement<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, QuicksortOptions);
+template void nthElement<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, QuicksortOptions);
+
+std::vector<int> quicksortAdversary(std::size_t n, QuicksortOptions options)
+{
+    std::vector<int> keys(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        keys[k] = static_cast<int>(n + k);
+    }
+    AdversaryTrace adversary(keys.data(), n);
+    quicksort(keys.data(), n, adversary, options);
+    return adversary.input();
+}
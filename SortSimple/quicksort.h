@@ -0,0 +1,76 @@
+#ifndef QUICKSORT_H
+#define QUICKSORT_H
+
+#include "sortnetwork.h"
+#include "sorttrace.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class PartitionScheme
+{
+    Hoare,     // Scans from both ends; one unpredictable branch per comparison
+    Block,     // BlockQuicksort: comparisons fill offset buffers, swaps follow
+    ThreeWay,  // Dutch national flag: less, equal and greater bands in one pass
+};
+
+enum class PivotStrategy
+{
+    Last,             // a[last - 1]; sorted input makes every split empty
+    Random,           // Uniform position from a generator seeded by `seed`
+    MedianOfThree,    // Median of the first, middle and last element
+    Ninther,          // Median of three medians of three (Tukey); median of three below 128 elements
+    MedianOfMedians,  // Exact median of the medians of groups of five: every split is at least 30/70
+};
+
+const char *pivotStrategyName(PivotStrategy strategy);
+
+struct QuicksortOptions
+{
+    PartitionScheme partition = PartitionScheme::Block;
+    PivotStrategy pivot = PivotStrategy::Ninther;
+    std::uint64_t seed = 1;                    // Random only
+    std::size_t blockSize = 64;                // Block only: elements scanned per side at a time, at most 128
+    std::size_t smallCutoff = 16;              // Ranges this small finish with `smallSort`
+    SmallSort smallSort = SmallSort::Network;  // Network cutoffs are capped at kMaxNetworkSize
+    // A range partitioned more than 2 log2(n) levels deep finishes with
+    // heapsort, so no pivot strategy or input can make the sort quadratic
+    bool depthLimit = true;
+    // Hoare and Block only: when the pivot equals the element just before the
+    // range, which bounds the range from below, gather its copies at the
+    // front and drop them instead of partitioning them again
+    bool groupDuplicates = true;
+};
+
+// Quicksort with a selectable pivot, recursing into the smaller side. The block
+// scheme (Edelkamp and Weiss) records the positions of misplaced elements
+// without branching on the comparison, then swaps pairs of them, so random
+// input no longer costs a branch miss per element. Keys equal to the pivot
+// leave the recursion after one pass with ThreeWay or groupDuplicates, so
+// inputs with few distinct values sort in close to linear time.
+template <typename Trace>
+void quicksort(int *a, std::size_t n, Trace &trace, QuicksortOptions options = {});
+void quicksort(int *a, std::size_t n, QuicksortOptions options = {});
+
+// Sorts only the k smallest keys into a[0, k); the rest end up in a[k, n)
+// in no particular order. Ranges that start at or after k are dropped as
+// soon as a partition separates them from the front.
+template <typename Trace>
+void partialQuicksort(int *a, std::size_t n, std::size_t k, Trace &trace, QuicksortOptions options = {});
+
+// Introselect: puts the key that belongs at a[nth] there, with nothing
+// bigger before it and nothing smaller after, by partitioning only the side
+// that holds nth. Stops as soon as nth lands among the copies of a pivot;
+// past the depth limit it switches to median-of-medians selection, which
+// is linear in the worst case. With nth = k - 1, a[0, k) are the k smallest.
+template <typename Trace>
+void nthElement(int *a, std::size_t n, std::size_t nth, Trace &trace, QuicksortOptions options = {});
+
+// Builds a permutation of 0..n-1 that drives quicksort with `options`
+// towards its worst case, with McIlroy's adversary ("A Killer Adversary
+// for Quicksort"): values are fixed only when a comparison needs them, and
+// each pivot gets the smallest value still free. The depth limit is
+// honoured, so with it off the sort runs in quadratic time.
+std::vector<int> quicksortAdversary(std::size_t n, QuicksortOptions options = {});
+
+#endif // QUICKSORT_H
@@ -0,0 +1,154 @@
+#include "radixsort.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// The sort for a digit width of Width bits, or of `digitBits` if Width is 0.
+// A fixed width makes the shifts, mask and bucket count constants. The
+// histograms go in `counts` when given, else on the heap.
+template <unsigned Width, typename Trace>
+void radixPasses(int *a, std::size_t n, int *aux, std::size_t *counts, Trace &trace, unsigned digitBits)
+{
+    if (Width != 0)
+    {
+        digitBits = Width;
+    }
+    auto [lowest, highest] = std::minmax_element(a, a + n);
+    const std::uint32_t base = static_cast<std::uint32_t>(*lowest);
+    const std::uint32_t range = static_cast<std::uint32_t>(*highest) - base;
+    if (range == 0)
+    {
+        return;
+    }
+    unsigned bits = 0;
+    while (bits < 32 && (range >> bits) != 0)
+    {
+        ++bits;
+    }
+    const unsigned passes = (bits + digitBits - 1) / digitBits;
+    const std::size_t buckets = std::size_t(1) << digitBits;
+    const std::uint32_t mask = static_cast<std::uint32_t>(buckets - 1);
+
+    // All histograms in one read of the input
+    std::vector<std::size_t> owned;
+    if (counts)
+    {
+        std::fill(counts, counts + passes * buckets, 0);
+    }
+    else
+    {
+        owned.assign(passes * buckets, 0);
+        counts = owned.data();
+    }
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        std::uint32_t key = static_cast<std::uint32_t>(a[k]) - base;
+        for (unsigned p = 0; p < passes; ++p)
+        {
+            ++counts[p * buckets + ((key >> (p * digitBits)) & mask)];
+        }
+    }
+
+    int *src = a;
+    int *dst = aux;
+    int dstBuffer = 1;
+    for (unsigned p = 0; p < passes; ++p)
+    {
+        std::size_t *count = counts + p * buckets;
+        unsigned shift = p * digitBits;
+        std::uint32_t firstDigit = ((static_cast<std::uint32_t>(src[0]) - base) >> shift) & mask;
+        if (count[firstDigit] == n)
+        {
+            continue; // Every key has the same digit here
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t b = 0; b < buckets; ++b)
+        {
+            std::size_t size = count[b];
+            count[b] = offset;
+            offset += size;
+        }
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            std::uint32_t digit = ((static_cast<std::uint32_t>(src[k]) - base) >> shift) & mask;
+            std::size_t slot = count[digit]++;
+            dst[slot] = src[k];
+            trace.write(slot, dst[slot], dstBuffer);
+        }
+        std::swap(src, dst);
+        dstBuffer ^= 1;
+    }
+
+    if (src != a)
+    {
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            a[k] = src[k];
+            trace.write(k, a[k]);
+        }
+    }
+}
+
+unsigned clampDigitBits(unsigned digitBits)
+{
+    return std::min(16u, std::max(1u, digitBits));
+}
+
+template <typename Trace>
+void radixSort(int *a, std::size_t n, int *aux, std::size_t *counts, Trace &trace, unsigned digitBits)
+{
+    if (n < 2)
+    {
+        return;
+    }
+    digitBits = clampDigitBits(digitBits);
+    switch (digitBits)
+    {
+    case 8:
+        radixPasses<8>(a, n, aux, counts, trace, 8);
+        break;
+    case 11:
+        radixPasses<11>(a, n, aux, counts, trace, 11);
+        break;
+    case 16:
+        radixPasses<16>(a, n, aux, counts, trace, 16);
+        break;
+    default:
+        radixPasses<0>(a, n, aux, counts, trace, digitBits);
+        break;
+    }
+}
+
+} // namespace
+
+template <typename Trace>
+void lsdRadixSort(int *a, std::size_t n, int *aux, Trace &trace, unsigned digitBits)
+{
+    radixSort(a, n, aux, nullptr, trace, digitBits);
+}
+
+void lsdRadixSort(int *a, std::size_t n, int *aux, unsigned digitBits)
+{
+    NullTrace trace;
+    lsdRadixSort(a, n, aux, trace, digitBits);
+}
+
+// One histogram per pass, and at most ceil(32 / digitBits) passes
+std::size_t radixCountsSize(unsigned digitBits)
+{
+    digitBits = clampDigitBits(digitBits);
+    return ((32 + digitBits - 1) / digitBits) * (std::size_t(1) << digitBits);
+}
+
+void lsdRadixSort(int *a, std::size_t n, int *aux, std::size_t *counts, unsigned digitBits)
+{
+    NullTrace trace;
+    radixSort(a, n, aux, counts, trace, digitBits);
+}
+
+template void lsdRadixSort<SortTrace>(int *, std::size_t, int *, SortTrace &, unsigned);
+template void lsdRadixSort<NullTrace>(int *, std::size_t, int *, NullTrace &, unsigned);
+template void lsdRadixSort<StreamingTrace>(int *, std::size_t, int *, StreamingTrace &, unsigned);
@@ -0,0 +1,20 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include "sorttrace.h"
+#include <cstddef>
+
+// Least-significant-digit radix sort. Keys are taken relative to the minimum,
+// so a narrow value range needs only as many passes as its width requires,
+// and a pass whose digit is the same for every key is skipped. Passes
+// alternate between `a` and `aux` (n ints, same index space in the trace).
+template <typename Trace>
+void lsdRadixSort(int *a, std::size_t n, int *aux, Trace &trace, unsigned digitBits = 8);
+void lsdRadixSort(int *a, std::size_t n, int *aux, unsigned digitBits = 8);
+
+// The same sort with its histograms in `counts`, radixCountsSize(digitBits)
+// entries, so it never touches the heap
+std::size_t radixCountsSize(unsigned digitBits);
+void lsdRadixSort(int *a, std::size_t n, int *aux, std::size_t *counts, unsigned digitBits);
+
+#endif // RADIXSORT_H
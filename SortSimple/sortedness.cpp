@@ -0,0 +1,132 @@
+#include "sortedness.h"
+#include <algorithm>
+#include <utility>
+
+void SortednessTracker::assign(const int *a, std::size_t size)
+{
+    n = size;
+    total = 0;
+    std::size_t pairs = n > 0 ? n - 1 : 0;
+    blockDescents.assign((pairs + kBlock - 1) / kBlock, 0);
+    for (std::size_t k = 0; k < pairs; ++k)
+    {
+        bool descent = a[k] > a[k + 1];
+        blockDescents[k / kBlock] += descent;
+        total += descent;
+    }
+}
+
+// Moves pair (k, k + 1) from `was` to its current state. Branch-free: with
+// random positions a mispredicted branch here would also stall the cache
+// misses of the caller's next writes, which otherwise overlap.
+void SortednessTracker::recount(const int *a, std::size_t k, bool was)
+{
+    int delta = int(a[k] > a[k + 1]) - int(was);
+    total += delta;
+    blockDescents[k / kBlock] += delta;
+}
+
+void SortednessTracker::changed(const int *a, std::size_t i, int old)
+{
+    if (i > 0)
+    {
+        recount(a, i - 1, a[i - 1] > old);
+    }
+    if (i + 1 < n)
+    {
+        recount(a, i, old > a[i + 1]);
+    }
+}
+
+void SortednessTracker::swapped(const int *a, std::size_t i, std::size_t j)
+{
+    if (i > j)
+    {
+        std::swap(i, j);
+    }
+    if (j - i <= 1)
+    {
+        // Neighbours or the same position: pairs i - 1, i and j share one change
+        if (i > 0)
+        {
+            recount(a, i - 1, a[i - 1] > a[j]);
+        }
+        if (i < j)
+        {
+            recount(a, i, a[j] > a[i]);
+        }
+        if (j + 1 < n)
+        {
+            recount(a, j, a[i] > a[j + 1]);
+        }
+        return;
+    }
+    // Before the swap a[i] held the value now at a[j] and the other way round
+    if (i > 0)
+    {
+        recount(a, i - 1, a[i - 1] > a[j]);
+    }
+    recount(a, i, a[j] > a[i + 1]);
+    recount(a, j - 1, a[j - 1] > a[i]);
+    if (j + 1 < n)
+    {
+        recount(a, j, a[i] > a[j + 1]);
+    }
+}
+
+// The old values are gone, so the blocks holding the affected pairs are
+// counted again from scratch: O(last - first + kBlock)
+void SortednessTracker::refresh(const int *a, std::size_t first, std::size_t last)
+{
+    if (first >= last || n < 2)
+    {
+        return;
+    }
+    std::size_t pairs = n - 1;
+    std::size_t fromBlock = (first > 0 ? first - 1 : 0) / kBlock;
+    std::size_t toBlock = (std::min(last, pairs) - 1) / kBlock;
+    for (std::size_t b = fromBlock; b <= toBlock; ++b)
+    {
+        std::size_t count = 0;
+        for (std::size_t k = b * kBlock; k < std::min(pairs, (b + 1) * kBlock); ++k)
+        {
+            count += a[k] > a[k + 1];
+        }
+        total = total - blockDescents[b] + count;
+        blockDescents[b] = static_cast<std::uint8_t>(count);
+    }
+}
+
+bool SortednessTracker::rangeSorted(const int *a, std::size_t first, std::size_t last) const
+{
+    if (last <= first + 1)
+    {
+        return true;
+    }
+    // Pairs first .. last - 2: loose pairs up to a block boundary, whole
+    // blocks, then the loose pairs after the last whole block
+    std::size_t k = first;
+    std::size_t end = last - 1;
+    for (; k < end && k % kBlock != 0; ++k)
+    {
+        if (a[k] > a[k + 1])
+        {
+            return false;
+        }
+    }
+    for (; k + kBlock <= end; k += kBlock)
+    {
+        if (blockDescents[k / kBlock])
+        {
+            return false;
+        }
+    }
+    for (; k < end; ++k)
+    {
+        if (a[k] > a[k + 1])
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SORTEDNESS_H
+#define SORTEDNESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Keeps count of the descents (positions k with a[k] > a[k + 1]) of an array
+// the caller owns and edits, so "is it sorted yet" is answered without a
+// scan. After each write or swap the caller reports it, and only the pairs
+// next to the changed positions are looked at: O(1) per change. Descents are
+// also counted per block of kBlock pairs, so a range can be asked whether it
+// is in order by checking whole-block counts and the pairs at its ends.
+// Nothing per element is stored; the array must not be resized between
+// assign() calls.
+class SortednessTracker
+{
+public:
+    static constexpr std::size_t kBlock = 64;
+
+    void assign(const int *a, std::size_t n);
+
+    void changed(const int *a, std::size_t i, int old);          // a[i] was `old` and has just been written
+    void swapped(const int *a, std::size_t i, std::size_t j);   // a[i] and a[j] have just been exchanged
+    void refresh(const int *a, std::size_t first, std::size_t last);  // a[first, last) was rewritten in bulk
+
+    std::size_t size() const { return n; }
+    std::size_t descents() const { return total; }
+    std::size_t runs() const { return n == 0 ? 0 : total + 1; }  // Maximal non-descending runs, as in InputProfile
+    bool sorted() const { return total == 0; }
+
+    // Block b holds the pairs starting at b * kBlock up to (b + 1) * kBlock - 1,
+    // so elements b * kBlock to (b + 1) * kBlock are in order when it is sorted
+    std::size_t blocks() const { return blockDescents.size(); }
+    bool blockSorted(std::size_t b) const { return blockDescents[b] == 0; }
+
+    // Whether a[first, last) is in order; O(kBlock + (last - first) / kBlock)
+    bool rangeSorted(const int *a, std::size_t first, std::size_t last) const;
+
+private:
+    void recount(const int *a, std::size_t k, bool was);
+
+    std::size_t n = 0;
+    std::size_t total = 0;
+    std::vector<std::uint8_t> blockDescents;
+};
+
+#endif // SORTEDNESS_H
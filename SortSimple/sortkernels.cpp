@@ -0,0 +1,109 @@
+#include "sortkernels.h"
+#include "classicsorts.h"
+#include "countingsort.h"
+#include "heapsort.h"
+#include "mergesort.h"
+#include "quicksort.h"
+#include "radixsort.h"
+#include "tuning.h"
+#include <algorithm>
+#include <vector>
+
+const char *kernelName(SortKernel kernel)
+{
+    switch (kernel)
+    {
+    case SortKernel::Insertion:
+        return "Insertion Sort";
+    case SortKernel::BottomUpMerge:
+        return "Bottom-Up Merge Sort";
+    case SortKernel::LsdRadix:
+        return "LSD Radix Sort";
+    case SortKernel::CountingSort:
+        return "Counting Sort";
+    case SortKernel::BucketSort:
+        return "Bucket Sort";
+    case SortKernel::BlockQuicksort:
+        return "Block Quicksort";
+    case SortKernel::ThreeWayQuicksort:
+        return "Three-Way Quicksort";
+    case SortKernel::HeapSort:
+        return "Heap Sort";
+    case SortKernel::StdSort:
+        return "std::sort";
+    }
+    return "?";
+}
+
+namespace {
+
+QuicksortOptions tunedQuicksortOptions()
+{
+    QuicksortOptions options;
+    options.smallCutoff = tuning().quicksortCutoff;
+    options.blockSize = tuning().quicksortBlock;
+    return options;
+}
+
+} // namespace
+
+template <typename Trace>
+void runKernel(SortKernel kernel, int *a, std::size_t n, Trace &trace)
+{
+    switch (kernel)
+    {
+    case SortKernel::Insertion:
+        insertionSort(a, n, trace);
+        break;
+    case SortKernel::BottomUpMerge:
+    {
+        MergeSortOptions options;
+        options.minRun = tuning().mergeMinRun;
+        options.mergeKernel = tuning().mergeKernel;
+        MergeWorkspace workspace;
+        bottomUpMergeSort(a, n, workspace, trace, options);
+        break;
+    }
+    case SortKernel::LsdRadix:
+    {
+        std::vector<int> aux(n);
+        lsdRadixSort(a, n, aux.data(), trace, tuning().radixDigitBits);
+        break;
+    }
+    case SortKernel::CountingSort:
+        if (!countingSort(a, n, trace))
+        {
+            bucketSort(a, n, trace);
+        }
+        break;
+    case SortKernel::BucketSort:
+        bucketSort(a, n, trace);
+        break;
+    case SortKernel::BlockQuicksort:
+        quicksort(a, n, trace, tunedQuicksortOptions());
+        break;
+    case SortKernel::ThreeWayQuicksort:
+    {
+        QuicksortOptions options = tunedQuicksortOptions();
+        options.partition = PartitionScheme::ThreeWay;
+        quicksort(a, n, trace, options);
+        break;
+    }
+    case SortKernel::HeapSort:
+        heapSortRange(a, 0, n, trace);
+        break;
+    case SortKernel::StdSort:
+        std::sort(a, a + n);
+        break;
+    }
+}
+
+void runKernel(SortKernel kernel, int *a, std::size_t n)
+{
+    NullTrace trace;
+    runKernel(kernel, a, n, trace);
+}
+
+template void runKernel<SortTrace>(SortKernel, int *, std::size_t, SortTrace &);
+template void runKernel<NullTrace>(SortKernel, int *, std::size_t, NullTrace &);
+template void runKernel<StreamingTrace>(SortKernel, int *, std::size_t, StreamingTrace &);
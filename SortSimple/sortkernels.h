@@ -0,0 +1,30 @@
+#ifndef SORTKERNELS_H
+#define SORTKERNELS_H
+
+#include "sorttrace.h"
+#include <cstddef>
+
+// Every integer kernel the engine can pick on its own
+enum class SortKernel
+{
+    Insertion,
+    BottomUpMerge,
+    LsdRadix,
+    CountingSort,
+    BucketSort,
+    BlockQuicksort,
+    ThreeWayQuicksort,
+    HeapSort,
+    StdSort,
+};
+
+const char *kernelName(SortKernel kernel);
+
+// Sorts a[0, n) with `kernel`, allocating whatever scratch space it needs.
+// StdSort has no instrumented version and records nothing in the trace;
+// CountingSort falls back to BucketSort when the key range is too wide.
+template <typename Trace>
+void runKernel(SortKernel kernel, int *a, std::size_t n, Trace &trace);
+void runKernel(SortKernel kernel, int *a, std::size_t n);
+
+#endif // SORTKERNELS_H
@@ -0,0 +1,72 @@
+#include "sortnetwork.h"
+#include <algorithm>
+
+namespace {
+
+template <std::size_t... N>
+constexpr std::array<NetworkView, sizeof...(N)> makeViews(std::index_sequence<N...>)
+{
+    return {{{kSortingNetwork<N>.data(), kSortingNetwork<N>.size(),
+              kSortingNetwork<N>.size() ? std::size_t(kSortingNetwork<N>.back().layer) + 1 : 0}...}};
+}
+
+template <std::size_t... N>
+constexpr std::array<void (*)(int *), sizeof...(N)> makeSorters(std::index_sequence<N...>)
+{
+    return {{&sortNetwork<N>...}};
+}
+
+const auto views = makeViews(std::make_index_sequence<kMaxNetworkSize + 1>());
+const auto sorters = makeSorters(std::make_index_sequence<kMaxNetworkSize + 1>());
+
+} // namespace
+
+NetworkView sortingNetwork(std::size_t n)
+{
+    return views[std::min(n, kMaxNetworkSize)];
+}
+
+void sortSmall(int *a, std::size_t n)
+{
+    sorters[n](a);
+}
+
+template <typename Trace>
+void networkSortRange(int *a, std::size_t first, std::size_t last, Trace &trace)
+{
+    if (!Trace::enabled)
+    {
+        sortSmall(a + first, last - first);
+        return;
+    }
+
+    NetworkView network = sortingNetwork(last - first);
+    std::size_t c = 0;
+    while (c < network.size)
+    {
+        // Mark the span of the whole layer before stepping through it
+        std::size_t end = c;
+        std::size_t lo = kMaxNetworkSize, hi = 0;
+        for (; end < network.size && network.comparators[end].layer == network.comparators[c].layer; ++end)
+        {
+            lo = std::min<std::size_t>(lo, network.comparators[end].i);
+            hi = std::max<std::size_t>(hi, network.comparators[end].j);
+        }
+        trace.mark(TagRange, first + lo, first + hi);
+        for (; c < end; ++c)
+        {
+            std::size_t i = first + network.comparators[c].i;
+            std::size_t j = first + network.comparators[c].j;
+            trace.compare(i, j);
+            if (a[j] < a[i])
+            {
+                std::swap(a[i], a[j]);
+                trace.swap(i, j);
+            }
+        }
+    }
+}
+
+template void networkSortRange<SortTrace>(int *, std::size_t, std::size_t, SortTrace &);
+template void networkSortRange<NullTrace>(int *, std::size_t, std::size_t, NullTrace &);
+template void networkSortRange<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &);
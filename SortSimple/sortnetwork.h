@@ -0,0 +1,126 @@
+#ifndef SORTNETWORK_H
+#define SORTNETWORK_H
+
+#include "sorttrace.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// How recursive kernels finish ranges below their cutoff
+enum class SmallSort
+{
+    Insertion,
+    Network,
+};
+
+constexpr std::size_t kMaxNetworkSize = 32;
+
+struct NetworkComparator
+{
+    std::uint8_t i;      // Receives the smaller value
+    std::uint8_t j;      // Receives the larger value
+    std::uint8_t layer;  // Comparators in one layer touch disjoint positions
+};
+
+// Calls visit(i, j, layer) for every comparator of Batcher's odd-even merge
+// sort on n inputs. Non-powers of two simply drop comparators past the end.
+template <typename Visit>
+constexpr void visitBatcherNetwork(std::size_t n, Visit &&visit)
+{
+    std::size_t layer = 0;
+    for (std::size_t p = 1; p < n; p += p)
+    {
+        for (std::size_t k = p; k >= 1; k /= 2)
+        {
+            bool used = false;
+            for (std::size_t j = k % p; j + k < n; j += 2 * k)
+            {
+                for (std::size_t i = 0; i < k && i + j + k < n; ++i)
+                {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                    {
+                        visit(i + j, i + j + k, layer);
+                        used = true;
+                    }
+                }
+            }
+            layer += used;
+        }
+    }
+}
+
+template <std::size_t N>
+constexpr std::size_t networkSize()
+{
+    std::size_t count = 0;
+    visitBatcherNetwork(N, [&count](std::size_t, std::size_t, std::size_t) { ++count; });
+    return count;
+}
+
+template <std::size_t N>
+constexpr std::array<NetworkComparator, networkSize<N>()> makeNetwork()
+{
+    std::array<NetworkComparator, networkSize<N>()> network{};
+    std::size_t c = 0;
+    visitBatcherNetwork(N, [&](std::size_t i, std::size_t j, std::size_t layer) {
+        network[c++] = {static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(j),
+                        static_cast<std::uint8_t>(layer)};
+    });
+    return network;
+}
+
+template <std::size_t N>
+inline constexpr auto kSortingNetwork = makeNetwork<N>();
+
+// min/max on ints compile to conditional moves, so nothing here branches
+inline void compareExchange(int *v, std::size_t i, std::size_t j)
+{
+    int x = v[i];
+    int y = v[j];
+    v[i] = x < y ? x : y;
+    v[j] = x < y ? y : x;
+}
+
+template <std::size_t N, std::size_t... C>
+inline void applyNetwork([[maybe_unused]] int *v, std::index_sequence<C...>)
+{
+    (compareExchange(v, kSortingNetwork<N>[C].i, kSortingNetwork<N>[C].j), ...);
+}
+
+// Sorts a[0, N) with a fully unrolled network; the values live in registers
+// in between, so the only memory traffic is one load and one store each
+template <std::size_t N>
+inline void sortNetwork(int *a)
+{
+    int v[N > 0 ? N : 1];
+    for (std::size_t k = 0; k < N; ++k)
+    {
+        v[k] = a[k];
+    }
+    applyNetwork<N>(v, std::make_index_sequence<kSortingNetwork<N>.size()>());
+    for (std::size_t k = 0; k < N; ++k)
+    {
+        a[k] = v[k];
+    }
+}
+
+// The network for n <= kMaxNetworkSize inputs, for code that walks it at run time
+struct NetworkView
+{
+    const NetworkComparator *comparators;
+    std::size_t size;
+    std::size_t layers;
+};
+NetworkView sortingNetwork(std::size_t n);
+
+// Sorts a[0, n), n <= kMaxNetworkSize, through a table of the unrolled networks
+void sortSmall(int *a, std::size_t n);
+
+// Sorts a[first, last) with the network for its length. Traced runs record a
+// Compare per comparator, a Swap when it exchanges and a TagRange mark over
+// the span of each layer; untraced runs go through sortSmall.
+template <typename Trace>
+void networkSortRange(int *a, std::size_t first, std::size_t last, Trace &trace);
+
+#endif // SORTNETWORK_H
@@ -0,0 +1,127 @@
+#ifndef SORTTRACE_H
+#define SORTTRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One recorded operation of a sorting kernel. Indices refer to the buffer
+// named by `buffer`: 0 is the array being sorted, 1 is an auxiliary buffer
+// of the same length whose index k stands in for position k of the array.
+struct TraceEvent
+{
+    enum Type : std::uint8_t { Read, Compare, Swap, Write, Mark };
+
+    std::uint8_t type;
+    std::uint8_t buffer;
+    std::uint16_t tag;   // Mark only: what the highlighted range means
+    std::int32_t i;
+    std::int32_t j;      // Second index for Compare/Swap, last index for Mark
+    std::int32_t value;  // Value stored by Write
+};
+
+// Meaning of a Mark event, used by the visualizer to pick a color
+enum TraceTag : std::uint16_t
+{
+    TagRange = 0,  // Sub-array currently being worked on
+    TagPivot,      // Pivot element
+    TagBucket,     // Radix bucket being filled
+    TagRun,        // Run being extended or merged
+    TagBlock,      // Block of a block partition being scanned
+    TagEqual,      // Keys equal to the pivot, already in their final place
+    TagHeap,       // Part of the array that is still a heap
+};
+
+// Records every operation of a kernel so the GUI can replay it step by step.
+// Kernels are templates over the trace type; NullTrace compiles to nothing.
+class SortTrace
+{
+public:
+    static constexpr bool enabled = true;
+
+    void read(std::size_t i, int buffer = 0) { push(TraceEvent::Read, buffer, 0, i, i, 0); }
+    void compare(std::size_t i, std::size_t j, int buffer = 0) { push(TraceEvent::Compare, buffer, 0, i, j, 0); }
+    void swap(std::size_t i, std::size_t j) { push(TraceEvent::Swap, 0, 0, i, j, 0); }
+    void write(std::size_t i, int value, int buffer = 0) { push(TraceEvent::Write, buffer, 0, i, i, value); }
+    void mark(TraceTag tag, std::size_t first, std::size_t last) { push(TraceEvent::Mark, 0, tag, first, last, 0); }
+
+    const std::vector<TraceEvent> &events() const { return log; }
+    std::size_t size() const { return log.size(); }
+    void clear() { log.clear(); }
+
+private:
+    void push(TraceEvent::Type type, int buffer, std::uint16_t tag, std::size_t i, std::size_t j, int value)
+    {
+        log.push_back({type, static_cast<std::uint8_t>(buffer), tag,
+                       static_cast<std::int32_t>(i), static_cast<std::int32_t>(j), value});
+    }
+
+    std::vector<TraceEvent> log;
+};
+
+// Receives events in batches from a StreamingTrace
+class TraceSink
+{
+public:
+    virtual ~TraceSink() = default;
+    virtual void consume(const TraceEvent *events, std::size_t count) = 0;
+};
+
+// Same interface as SortTrace, but events go to a sink in fixed-size batches
+// instead of being kept, so arbitrarily long runs use constant memory
+class StreamingTrace
+{
+public:
+    static constexpr bool enabled = true;
+
+    explicit StreamingTrace(TraceSink &sink) : sink(sink) { batch.reserve(kBatchSize); }
+    ~StreamingTrace() { flush(); }
+    StreamingTrace(const StreamingTrace &) = delete;
+    StreamingTrace &operator=(const StreamingTrace &) = delete;
+
+    void read(std::size_t i, int buffer = 0) { push(TraceEvent::Read, buffer, 0, i, i, 0); }
+    void compare(std::size_t i, std::size_t j, int buffer = 0) { push(TraceEvent::Compare, buffer, 0, i, j, 0); }
+    void swap(std::size_t i, std::size_t j) { push(TraceEvent::Swap, 0, 0, i, j, 0); }
+    void write(std::size_t i, int value, int buffer = 0) { push(TraceEvent::Write, buffer, 0, i, i, value); }
+    void mark(TraceTag tag, std::size_t first, std::size_t last) { push(TraceEvent::Mark, 0, tag, first, last, 0); }
+
+    void flush()
+    {
+        if (!batch.empty())
+        {
+            sink.consume(batch.data(), batch.size());
+            batch.clear();
+        }
+    }
+
+private:
+    static constexpr std::size_t kBatchSize = 4096;
+
+    void push(TraceEvent::Type type, int buffer, std::uint16_t tag, std::size_t i, std::size_t j, int value)
+    {
+        batch.push_back({type, static_cast<std::uint8_t>(buffer), tag,
+                         static_cast<std::int32_t>(i), static_cast<std::int32_t>(j), value});
+        if (batch.size() == kBatchSize)
+        {
+            flush();
+        }
+    }
+
+    TraceSink &sink;
+    std::vector<TraceEvent> batch;
+};
+
+// Its calls do nothing, but their arguments are still evaluated; kernels
+// guard arguments that cost anything to compute with Trace::enabled.
+struct NullTrace
+{
+    static constexpr bool enabled = false;
+
+    void read(std::size_t, int = 0) {}
+    void compare(std::size_t, std::size_t, int = 0) {}
+    void swap(std::size_t, std::size_t) {}
+    void write(std::size_t, int, int = 0) {}
+    void mark(TraceTag, std::size_t, std::size_t) {}
+};
+
+#endif // SORTTRACE_H
@@ -0,0 +1,493 @@
+#include "streamsort.h"
+#include "heapsort.h"
+#include "radixsort.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+
+// First of `fanout` consecutive idle runs of the lowest tier that has that
+// many, or kNone. Tiers never increase from oldest to newest, so the runs of
+// one tier are consecutive anyway. `busy` is null when nothing is merging.
+std::size_t pickCompaction(const std::vector<unsigned> &tiers, const std::vector<bool> *busy, unsigned fanout)
+{
+    std::size_t best = kNone;
+    for (std::size_t first = 0; first < tiers.size();)
+    {
+        std::size_t last = first;
+        while (last < tiers.size() && tiers[last] == tiers[first] && !(busy && (*busy)[last]))
+        {
+            ++last;
+        }
+        if (last - first >= fanout && (best == kNone || tiers[first] < tiers[best]))
+        {
+            best = first;
+        }
+        first = std::max(last, first + 1);
+    }
+    return best;
+}
+
+template <typename Trace>
+void mergeStep(const int *src, int *dst, int dstBuffer, std::size_t lo, std::size_t mid, std::size_t hi,
+               MergeKernel kernel, Trace &trace)
+{
+    if (!Trace::enabled)
+    {
+        mergeSorted(src + lo, mid - lo, src + mid, hi - mid, dst + lo, kernel);
+        return;
+    }
+    std::size_t i = lo, j = mid, k = lo;
+    while (i < mid && j < hi)
+    {
+        trace.compare(i, j, dstBuffer ^ 1);
+        dst[k] = src[j] < src[i] ? src[j++] : src[i++];
+        trace.write(k, dst[k], dstBuffer);
+        ++k;
+    }
+    for (; i < mid; ++i, ++k)
+    {
+        dst[k] = src[i];
+        trace.write(k, dst[k], dstBuffer);
+    }
+    for (; j < hi; ++j, ++k)
+    {
+        dst[k] = src[j];
+        trace.write(k, dst[k], dstBuffer);
+    }
+}
+
+// Merges the sorted runs of a between bounds[0] < ... < bounds[count] in
+// pairs, ping-ponging with aux (same index space), until one run is left.
+// Returns the buffer holding it.
+template <typename Trace>
+int *mergeRuns(int *a, int *aux, std::vector<std::size_t> bounds, MergeKernel kernel, Trace &trace)
+{
+    std::size_t count = bounds.size() - 1;
+    int *src = a;
+    int *dst = aux;
+    int dstBuffer = 1;
+    while (count > 1)
+    {
+        std::size_t merged = 0;
+        for (std::size_t r = 0; r < count; r += 2)
+        {
+            std::size_t lo = bounds[r];
+            if (r + 1 < count)
+            {
+                mergeStep(src, dst, dstBuffer, lo, bounds[r + 1], bounds[r + 2], kernel, trace);
+            }
+            else
+            {
+                for (std::size_t k = lo; k < bounds[r + 1]; ++k)
+                {
+                    dst[k] = src[k];
+                    trace.write(k, dst[k], dstBuffer);
+                }
+            }
+            bounds[merged++] = lo;
+        }
+        bounds[merged] = bounds[count];
+        count = merged;
+        std::swap(src, dst);
+        dstBuffer ^= 1;
+    }
+    return src;
+}
+
+// mergeRuns, with the result moved back into a
+template <typename Trace>
+void mergeRunsInPlace(int *a, int *aux, std::vector<std::size_t> bounds, MergeKernel kernel, Trace &trace)
+{
+    std::size_t lo = bounds.front(), hi = bounds.back();
+    if (mergeRuns(a, aux, std::move(bounds), kernel, trace) != a)
+    {
+        for (std::size_t k = lo; k < hi; ++k)
+        {
+            a[k] = aux[k];
+            trace.write(k, a[k]);
+        }
+    }
+}
+
+template <typename Trace>
+void sortBatch(int *a, int *aux, std::size_t first, std::size_t last, Trace &trace)
+{
+    if (Trace::enabled)
+    {
+        // Heap sort traces positions of the whole array, radix sort would not
+        heapSortRange(a, first, last, trace);
+    }
+    else
+    {
+        lsdRadixSort(a + first, last - first, aux + first);
+    }
+}
+
+// A sorted slice of a run or of the buffer
+struct Part
+{
+    const std::int32_t *data;
+    std::size_t size;
+};
+
+// Merges sorted parts into one run: the first round reads the parts where
+// they are and writes one flat array, later rounds go through mergeRuns
+std::vector<std::int32_t> mergeParts(const std::vector<Part> &parts, MergeKernel kernel)
+{
+    std::vector<std::size_t> bounds(1, 0);
+    for (std::size_t p = 0; p < parts.size(); p += 2)
+    {
+        std::size_t size = parts[p].size + (p + 1 < parts.size() ? parts[p + 1].size : 0);
+        bounds.push_back(bounds.back() + size);
+    }
+    std::vector<std::int32_t> out(bounds.back());
+    std::vector<std::int32_t> aux(bounds.size() > 2 ? out.size() : 0);
+    for (std::size_t p = 0; p < parts.size(); p += 2)
+    {
+        int *dst = out.data() + bounds[p / 2];
+        if (p + 1 < parts.size())
+        {
+            mergeSorted(parts[p].data, parts[p].size, parts[p + 1].data, parts[p + 1].size, dst, kernel);
+        }
+        else
+        {
+            std::copy(parts[p].data, parts[p].data + parts[p].size, dst);
+        }
+    }
+    NullTrace none;
+    if (bounds.size() > 2 && mergeRuns(out.data(), aux.data(), std::move(bounds), kernel, none) != out.data())
+    {
+        out.swap(aux);
+    }
+    return out;
+}
+
+} // namespace
+
+template <typename Trace>
+void lsmSort(int *a, std::size_t n, Trace &trace, StreamingSortOptions options)
+{
+    std::size_t batch = std::max<std::size_t>(1, options.batchSize);
+    unsigned fanout = std::max(2u, options.fanout);
+    std::vector<int> aux(n);
+    std::vector<std::size_t> starts;  // First index of each run, oldest first
+    std::vector<unsigned> tiers;
+    for (std::size_t first = 0; first < n; first += batch)
+    {
+        std::size_t last = std::min(n, first + batch);
+        trace.mark(TagRange, first, last - 1);
+        sortBatch(a, aux.data(), first, last, trace);
+        starts.push_back(first);
+        tiers.push_back(0);
+
+        std::size_t oldest;
+        while ((oldest = pickCompaction(tiers, nullptr, fanout)) != kNone)
+        {
+            std::vector<std::size_t> bounds(starts.begin() + oldest, starts.begin() + oldest + fanout);
+            bounds.push_back(oldest + fanout < starts.size() ? starts[oldest + fanout] : last);
+            trace.mark(TagRun, bounds.front(), bounds.back() - 1);
+            mergeRunsInPlace(a, aux.data(), std::move(bounds), options.mergeKernel, trace);
+            starts.erase(starts.begin() + oldest + 1, starts.begin() + oldest + fanout);
+            tiers.erase(tiers.begin() + oldest + 1, tiers.begin() + oldest + fanout);
+            ++tiers[oldest];
+        }
+    }
+    if (starts.size() > 1)
+    {
+        trace.mark(TagRun, 0, n - 1);
+        starts.push_back(n);
+        mergeRunsInPlace(a, aux.data(), std::move(starts), options.mergeKernel, trace);
+    }
+}
+
+void lsmSort(int *a, std::size_t n, StreamingSortOptions options)
+{
+    NullTrace trace;
+    lsmSort(a, n, trace, options);
+}
+
+template void lsmSort<SortTrace>(int *, std::size_t, SortTrace &, StreamingSortOptions);
+template void lsmSort<NullTrace>(int *, std::size_t, NullTrace &, StreamingSortOptions);
+template void lsmSort<StreamingTrace>(int *, std::size_t, StreamingTrace &, StreamingSortOptions);
+
+StreamingSort::StreamingSort(StreamingSortOptions options) : options(options)
+{
+    this->options.batchSize = std::max<std::size_t>(1, options.batchSize);
+    this->options.fanout = std::max(2u, options.fanout);
+    this->options.maxRuns = std::max<std::size_t>(options.maxRuns, 2 * this->options.fanout);
+    buffer.reserve(this->options.batchSize);
+    if (options.background)
+    {
+        worker = std::thread([this] { compactor(); });
+    }
+}
+
+StreamingSort::~StreamingSort()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void StreamingSort::push(const std::int32_t *values, std::size_t count)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (count > 0)
+    {
+        std::size_t room = options.batchSize - buffer.size();
+        std::size_t take = std::min(room, count);
+        buffer.insert(buffer.end(), values, values + take);
+        // Counted as they are stored: seal() may unlock, and queries must
+        // not see values that are not there yet
+        counters.values += take;
+        bufferSorted = buffer.size() <= 1;
+        values += take;
+        count -= take;
+        if (buffer.size() == options.batchSize)
+        {
+            seal(lock);
+        }
+    }
+}
+
+void StreamingSort::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!buffer.empty())
+    {
+        seal(lock);
+    }
+}
+
+// Turns the buffer into a tier-0 run. Background compaction is started,
+// and waited for if too many runs are piling up; otherwise it runs here.
+void StreamingSort::seal(std::unique_lock<std::mutex> &lock)
+{
+    sortBuffer();
+    auto run = std::make_shared<std::vector<std::int32_t>>(buffer.begin(), buffer.end());
+    buffer.clear();
+    bufferSorted = true;
+    list.push_back({std::move(run), 0, false});
+    ++counters.batches;
+    if (worker.joinable())
+    {
+        changed.notify_all();
+        changed.wait(lock, [this] { return list.size() < options.maxRuns || !compactionPending() || stopping; });
+    }
+    else
+    {
+        while (compactOnce(lock))
+        {
+        }
+    }
+}
+
+// Merges one group of runs if one is due; the merge itself runs unlocked
+bool StreamingSort::compactOnce(std::unique_lock<std::mutex> &lock)
+{
+    std::size_t first = dueCompaction();
+    if (first == kNone)
+    {
+        return false;
+    }
+    // The runs stay listed, and so alive, until the merged run replaces them
+    std::vector<Part> parts;
+    for (std::size_t r = first; r < first + options.fanout; ++r)
+    {
+        list[r].busy = true;
+        parts.push_back({list[r].values->data(), list[r].values->size()});
+    }
+    unsigned tier = list[first].tier + 1;
+    const std::vector<std::int32_t> *head = list[first].values.get();
+
+    lock.unlock();
+    auto merged = std::make_shared<std::vector<std::int32_t>>(mergeParts(parts, options.mergeKernel));
+    lock.lock();
+
+    // Another push() may have merged an earlier group in the meantime and
+    // moved this one down, so find it again by its first run. Its runs stay
+    // together: they are busy, and runs are only added at the end.
+    first = static_cast<std::size_t>(
+        std::find_if(list.begin(), list.end(), [head](const Run &run) { return run.values.get() == head; }) -
+        list.begin());
+    counters.mergedValues += merged->size();
+    ++counters.compactions;
+    list[first] = {std::move(merged), tier, false};
+    list.erase(list.begin() + first + 1, list.begin() + first + options.fanout);
+    changed.notify_all();
+    return true;
+}
+
+void StreamingSort::compactor()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        if (!compactOnce(lock))
+        {
+            changed.wait(lock);
+        }
+    }
+}
+
+std::size_t StreamingSort::dueCompaction() const
+{
+    std::vector<unsigned> tiers(list.size());
+    std::vector<bool> busy(list.size());
+    for (std::size_t r = 0; r < list.size(); ++r)
+    {
+        tiers[r] = list[r].tier;
+        busy[r] = list[r].busy;
+    }
+    return pickCompaction(tiers, &busy, options.fanout);
+}
+
+bool StreamingSort::compactionPending() const
+{
+    return dueCompaction() != kNone ||
+           std::any_of(list.begin(), list.end(), [](const Run &run) { return run.busy; });
+}
+
+void StreamingSort::waitForCompaction()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    // Every compaction notifies, so the condition is re-checked after each
+    changed.wait(lock, [this] { return !worker.joinable() || !compactionPending() || stopping; });
+}
+
+// The buffer is kept unsorted while values arrive and sorted when a query
+// or a seal needs it
+void StreamingSort::sortBuffer() const
+{
+    if (!bufferSorted)
+    {
+        scratch.resize(buffer.size());
+        lsdRadixSort(buffer.data(), buffer.size(), scratch.data());
+        bufferSorted = true;
+    }
+}
+
+std::uint64_t StreamingSort::countBelow(std::int64_t bound) const
+{
+    auto below = [bound](const std::vector<std::int32_t> &values) {
+        return std::uint64_t(std::partition_point(values.begin(), values.end(),
+                                                  [bound](std::int32_t v) { return v < bound; }) -
+                             values.begin());
+    };
+    std::uint64_t count = below(buffer);
+    for (const Run &run : list)
+    {
+        count += below(*run.values);
+    }
+    return count;
+}
+
+std::uint64_t StreamingSort::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters.values;
+}
+
+std::uint64_t StreamingSort::rank(std::int32_t value) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    sortBuffer();
+    return countBelow(value);
+}
+
+bool StreamingSort::select(std::uint64_t k, std::int32_t &value) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (k >= counters.values)
+    {
+        return false;
+    }
+    sortBuffer();
+    // Smallest v with more than k values <= v, by bisecting the value range
+    std::int64_t lo = std::numeric_limits<std::int32_t>::min();
+    std::int64_t hi = std::numeric_limits<std::int32_t>::max();
+    while (lo < hi)
+    {
+        std::int64_t mid = lo + (hi - lo) / 2;
+        if (countBelow(mid + 1) > k)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    value = static_cast<std::int32_t>(lo);
+    return true;
+}
+
+// The slices of every run, and of the buffer, that fall in [lo, hi],
+// merged. Runs are immutable, so under the lock only their handles and the
+// buffer are copied; the merge runs unlocked.
+std::vector<std::int32_t> StreamingSort::collect(std::int32_t lo, std::int32_t hi) const
+{
+    std::vector<std::shared_ptr<const std::vector<std::int32_t>>> held;
+    std::vector<std::int32_t> buffered;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sortBuffer();
+        for (const Run &run : list)
+        {
+            held.push_back(run.values);
+        }
+        auto first = std::lower_bound(buffer.begin(), buffer.end(), lo);
+        buffered.assign(first, std::upper_bound(first, buffer.end(), hi));
+    }
+    std::vector<Part> parts;
+    auto slice = [&](const std::vector<std::int32_t> &values) {
+        auto first = std::lower_bound(values.begin(), values.end(), lo);
+        auto last = std::upper_bound(first, values.end(), hi);
+        if (first != last)
+        {
+            parts.push_back({&*first, std::size_t(last - first)});
+        }
+    };
+    for (const auto &run : held)
+    {
+        slice(*run);
+    }
+    slice(buffered);
+    return mergeParts(parts, options.mergeKernel);
+}
+
+std::vector<std::int32_t> StreamingSort::range(std::int32_t lo, std::int32_t hi) const
+{
+    return lo <= hi ? collect(lo, hi) : std::vector<std::int32_t>();
+}
+
+std::vector<std::int32_t> StreamingSort::sorted() const
+{
+    return collect(std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max());
+}
+
+std::vector<StreamingRun> StreamingSort::runs() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<StreamingRun> result;
+    for (const Run &run : list)
+    {
+        result.push_back({run.values->size(), run.tier, run.busy});
+    }
+    return result;
+}
+
+StreamingSortStats StreamingSort::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
@@ -0,0 +1,111 @@
+#ifndef STREAMSORT_H
+#define STREAMSORT_H
+
+#include "bitonicmerge.h"
+#include "sorttrace.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct StreamingSortOptions
+{
+    std::size_t batchSize = std::size_t(1) << 16;  // Values buffered before they are sorted into a run
+    unsigned fanout = 4;                          // Runs of one tier merged together into one of the next
+    bool background = true;                       // Compact on a worker thread; otherwise inside push()
+    std::size_t maxRuns = 64;                     // push() waits for the compactor beyond this many runs
+    MergeKernel mergeKernel = MergeKernel::Bitonic8;
+};
+
+// Sorts a[0, n) as if its values arrived one batch at a time, the way
+// StreamingSort ingests a feed: each batch is sorted into a run, whenever
+// `fanout` runs of the same tier are newest they are merged into one run of
+// the next tier, and the runs left at the end are merged once. Runs stay in
+// arrival order, so every run is a contiguous range of `a` and the trace
+// shows each compaction as a Mark of its range (TagRun) followed by the
+// merge. Traced runs sort batches with heap sort, the others with LSD radix
+// sort. Every value is written about log_fanout(n / batchSize) + 1 times.
+template <typename Trace>
+void lsmSort(int *a, std::size_t n, Trace &trace, StreamingSortOptions options = {});
+void lsmSort(int *a, std::size_t n, StreamingSortOptions options = {});
+
+// One run of a StreamingSort, for display
+struct StreamingRun
+{
+    std::size_t size;
+    unsigned tier;     // Batches are tier 0; merging `fanout` runs of tier t makes one of tier t + 1
+    bool compacting;   // Being merged right now
+};
+
+struct StreamingSortStats
+{
+    std::uint64_t values = 0;        // Pushed so far
+    std::uint64_t batches = 0;       // Runs sealed from the buffer
+    std::uint64_t compactions = 0;
+    std::uint64_t mergedValues = 0;  // Values written by compactions; / values is the write amplification
+};
+
+// A sorted view of a feed that never ends. Pushed values collect in a
+// buffer; a full buffer is sorted into an immutable run, and runs are
+// merged in tiers, `fanout` at a time, by a background thread, so the
+// number of runs stays logarithmic in the number of values and ingest
+// never waits for a full re-sort. Queries search each run and the buffer
+// (sorted on demand) and are answered at any time from the current state,
+// including while a compaction is in progress: the runs being merged stay
+// visible until their merged run replaces them. All members are safe to
+// call from any thread.
+class StreamingSort
+{
+public:
+    explicit StreamingSort(StreamingSortOptions options = {});
+    ~StreamingSort();
+    StreamingSort(const StreamingSort &) = delete;
+    StreamingSort &operator=(const StreamingSort &) = delete;
+
+    void push(const std::int32_t *values, std::size_t count);
+    void flush();               // Seals the buffered values into a run now
+    void waitForCompaction();   // Returns once no compaction is running or due
+
+    std::uint64_t size() const;
+    std::uint64_t rank(std::int32_t value) const;                 // How many values are smaller
+    bool select(std::uint64_t k, std::int32_t &value) const;      // k-th smallest, from 0; false if k >= size()
+    std::vector<std::int32_t> range(std::int32_t lo, std::int32_t hi) const;  // Values in [lo, hi], in order
+    std::vector<std::int32_t> sorted() const;                     // Everything, in order
+
+    std::vector<StreamingRun> runs() const;  // Oldest first; the buffer is not included
+    StreamingSortStats stats() const;
+
+private:
+    struct Run
+    {
+        std::shared_ptr<const std::vector<std::int32_t>> values;
+        unsigned tier;
+        bool busy;
+    };
+
+    void seal(std::unique_lock<std::mutex> &lock);
+    bool compactOnce(std::unique_lock<std::mutex> &lock);
+    std::size_t dueCompaction() const;     // First run of the group to merge next, if any
+    bool compactionPending() const;        // One is due or running
+    void sortBuffer() const;
+    std::uint64_t countBelow(std::int64_t bound) const;  // Values < bound; needs the lock and a sorted buffer
+    std::vector<std::int32_t> collect(std::int32_t lo, std::int32_t hi) const;
+    void compactor();
+
+    StreamingSortOptions options;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    mutable std::vector<std::int32_t> buffer;
+    mutable std::vector<std::int32_t> scratch;
+    mutable bool bufferSorted = true;
+    std::vector<Run> list;  // Oldest first; tiers never increase along it, except briefly while two
+                            // push() calls compact in the foreground at once
+    StreamingSortStats counters;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif // STREAMSORT_H
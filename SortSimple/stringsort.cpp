@@ -0,0 +1,311 @@
+#include "stringsort.h"
+#include <algorithm>
+#include <cstring>
+
+void StringArena::reserve(std::size_t strings, std::size_t bytes)
+{
+    chars.reserve(bytes);
+    offsets.reserve(strings);
+    lengths.reserve(strings);
+}
+
+std::uint32_t StringArena::add(std::string_view s)
+{
+    offsets.push_back(static_cast<std::uint32_t>(chars.size()));
+    lengths.push_back(static_cast<std::uint32_t>(s.size()));
+    chars.insert(chars.end(), s.begin(), s.end());
+    return static_cast<std::uint32_t>(offsets.size() - 1);
+}
+
+void StringArena::append(const StringArena &other)
+{
+    std::uint32_t base = static_cast<std::uint32_t>(chars.size());
+    chars.insert(chars.end(), other.chars.begin(), other.chars.end());
+    for (std::uint32_t offset : other.offsets)
+    {
+        offsets.push_back(base + offset);
+    }
+    lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+}
+
+std::uint32_t StringArena::idOf(const StringRef &ref) const
+{
+    // Empty strings share their offset with the next string, so they are the
+    // first ids at that offset and a non-empty string is the last one
+    if (ref.length == 0)
+    {
+        auto it = std::lower_bound(offsets.begin(), offsets.end(), ref.offset);
+        return static_cast<std::uint32_t>(it - offsets.begin());
+    }
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), ref.offset);
+    return static_cast<std::uint32_t>(it - offsets.begin() - 1);
+}
+
+namespace {
+
+// Eight bytes of the string starting at `depth`, big-endian, zero padded
+std::uint64_t loadPrefix(const char *base, const StringRef &r, std::size_t depth)
+{
+    std::uint64_t key = 0;
+    std::size_t available = r.length > depth ? r.length - depth : 0;
+    std::size_t count = available < 8 ? available : 8;
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(base + r.offset + depth);
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        key |= std::uint64_t(p[k]) << (56 - 8 * k);
+    }
+    return key;
+}
+
+void refreshPrefixes(const char *base, StringRef *a, std::size_t n, std::size_t depth)
+{
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        a[k].prefix = loadPrefix(base, a[k], depth);
+    }
+}
+
+// A chunk whose last byte is zero means the string ended inside it
+bool chunkEndsString(std::uint64_t prefix)
+{
+    return (prefix & 0xFF) == 0;
+}
+
+// Full comparison of two strings whose bytes before `depth` are known equal
+// and whose prefixes hold the chunk at `depth`
+int compareFrom(const char *base, const StringRef &x, const StringRef &y, std::size_t depth)
+{
+    if (x.prefix != y.prefix)
+    {
+        return x.prefix < y.prefix ? -1 : 1;
+    }
+    if (chunkEndsString(x.prefix))
+    {
+        return 0;
+    }
+    std::size_t from = depth + 8;
+    std::size_t xn = x.length - from;
+    std::size_t yn = y.length - from;
+    int c = std::memcmp(base + x.offset + from, base + y.offset + from, xn < yn ? xn : yn);
+    if (c != 0)
+    {
+        return c;
+    }
+    return xn < yn ? -1 : (xn > yn ? 1 : 0);
+}
+
+template <typename Trace>
+struct StringSorter
+{
+    const StringArena &arena;
+    const char *base;
+    StringRef *first;  // Start of the whole array, for trace indices
+    StringRef *aux;
+    Trace &trace;
+    StringSortCutoffs cutoffs;
+
+    std::size_t at(const StringRef *p) const { return static_cast<std::size_t>(p - first); }
+
+    int idOf(const StringRef &r) const { return static_cast<int>(arena.idOf(r)); }
+
+    void exchange(StringRef *a, std::size_t i, std::size_t j)
+    {
+        std::swap(a[i], a[j]);
+        trace.swap(at(a + i), at(a + j));
+    }
+
+    void insertionSort(StringRef *a, std::size_t n, std::size_t depth)
+    {
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            for (std::size_t j = i; j > 0; --j)
+            {
+                trace.compare(at(a + j - 1), at(a + j));
+                if (compareFrom(base, a[j - 1], a[j], depth) <= 0)
+                {
+                    break;
+                }
+                exchange(a, j - 1, j);
+            }
+        }
+    }
+
+    // Expects a[k].prefix to hold the chunk at `depth` for every k
+    void multikey(StringRef *a, std::size_t n, std::size_t depth)
+    {
+        while (n > 1)
+        {
+            if (n < cutoffs.insertion)
+            {
+                insertionSort(a, n, depth);
+                return;
+            }
+            trace.mark(TagRange, at(a), at(a + n - 1));
+
+            // Median of three prefixes, moved to the front
+            std::size_t mid = n / 2;
+            std::size_t last = n - 1;
+            if (a[mid].prefix < a[0].prefix) exchange(a, 0, mid);
+            if (a[last].prefix < a[0].prefix) exchange(a, 0, last);
+            if (a[last].prefix < a[mid].prefix) exchange(a, mid, last);
+            exchange(a, 0, mid);
+            std::uint64_t pivot = a[0].prefix;
+            trace.mark(TagPivot, at(a), at(a));
+
+            // Dijkstra three-way partition: [0,lt) < pivot, [lt,i) == pivot, (gt,n) > pivot
+            std::size_t lt = 0, i = 1, gt = n - 1;
+            while (i <= gt)
+            {
+                trace.compare(at(a + i), at(a + lt));
+                if (a[i].prefix < pivot)
+                {
+                    exchange(a, lt++, i++);
+                }
+                else if (a[i].prefix > pivot)
+                {
+                    exchange(a, i, gt--);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            multikey(a, lt, depth);
+            multikey(a + gt + 1, n - gt - 1, depth);
+
+            // The equal band shares the whole chunk; continue one chunk deeper
+            a += lt;
+            n = gt + 1 - lt;
+            if (chunkEndsString(pivot))
+            {
+                return;
+            }
+            depth += 8;
+            refreshPrefixes(base, a, n, depth);
+        }
+    }
+
+    // Expects a[k].prefix to hold the chunk starting at `chunkStart`
+    void radix(StringRef *a, std::size_t n, std::size_t depth, std::size_t chunkStart)
+    {
+        if (n < cutoffs.radix)
+        {
+            if (depth != chunkStart)
+            {
+                refreshPrefixes(base, a, n, depth);
+            }
+            multikey(a, n, depth);
+            return;
+        }
+        if (depth - chunkStart == 8)
+        {
+            refreshPrefixes(base, a, n, depth);
+            chunkStart = depth;
+        }
+        trace.mark(TagRange, at(a), at(a + n - 1));
+
+        unsigned shift = static_cast<unsigned>(56 - 8 * (depth - chunkStart));
+        std::size_t count[257] = {};
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            ++count[((a[k].prefix >> shift) & 0xFF) + 1];
+        }
+        for (int b = 1; b < 257; ++b)
+        {
+            count[b] += count[b - 1];
+        }
+
+        // Scatter into the auxiliary buffer and copy back, both passes sequential
+        StringRef *buffer = aux + at(a);
+        std::size_t next[256];
+        std::copy(count, count + 256, next);
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            std::size_t slot = next[(a[k].prefix >> shift) & 0xFF]++;
+            buffer[slot] = a[k];
+            if (Trace::enabled)
+            {
+                trace.write(at(a + slot), idOf(a[k]), 1);  // idOf() is a search, so only when traced
+            }
+        }
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            a[k] = buffer[k];
+            if (Trace::enabled)
+            {
+                trace.write(at(a + k), idOf(a[k]));
+            }
+        }
+
+        // Bucket 0 holds strings that ended at this depth; they are all equal
+        for (int b = 1; b < 256; ++b)
+        {
+            std::size_t size = count[b + 1] - count[b];
+            if (size > 1)
+            {
+                trace.mark(TagBucket, at(a + count[b]), at(a + count[b + 1] - 1));
+                radix(a + count[b], size, depth + 1, chunkStart);
+            }
+        }
+    }
+};
+
+} // namespace
+
+std::vector<StringRef> makeStringRefs(const StringArena &arena)
+{
+    std::vector<StringRef> refs(arena.size());
+    for (std::uint32_t id = 0; id < arena.size(); ++id)
+    {
+        std::string_view s = arena.view(id);
+        refs[id].offset = static_cast<std::uint32_t>(s.data() - arena.data());
+        refs[id].length = static_cast<std::uint32_t>(s.size());
+        refs[id].prefix = loadPrefix(arena.data(), refs[id], 0);
+    }
+    return refs;
+}
+
+template <typename Trace>
+void multikeyQuicksort(const StringArena &arena, std::vector<StringRef> &refs, Trace &trace,
+                       StringSortCutoffs cutoffs)
+{
+    refreshPrefixes(arena.data(), refs.data(), refs.size(), 0);
+    StringSorter<Trace> sorter{arena, arena.data(), refs.data(), nullptr, trace, cutoffs};
+    sorter.multikey(refs.data(), refs.size(), 0);
+}
+
+void multikeyQuicksort(const StringArena &arena, std::vector<StringRef> &refs)
+{
+    NullTrace trace;
+    multikeyQuicksort(arena, refs, trace);
+}
+
+template <typename Trace>
+void msdRadixSort(const StringArena &arena, std::vector<StringRef> &refs, Trace &trace,
+                  StringSortCutoffs cutoffs)
+{
+    refreshPrefixes(arena.data(), refs.data(), refs.size(), 0);
+    std::vector<StringRef> aux(refs.size());
+    StringSorter<Trace> sorter{arena, arena.data(), refs.data(), aux.data(), trace, cutoffs};
+    sorter.radix(refs.data(), refs.size(), 0, 0);
+}
+
+void msdRadixSort(const StringArena &arena, std::vector<StringRef> &refs)
+{
+    NullTrace trace;
+    msdRadixSort(arena, refs, trace);
+}
+
+template void multikeyQuicksort<SortTrace>(const StringArena &, std::vector<StringRef> &, SortTrace &,
+                                          StringSortCutoffs);
+template void multikeyQuicksort<NullTrace>(const StringArena &, std::vector<StringRef> &, NullTrace &,
+                                          StringSortCutoffs);
+template void multikeyQuicksort<StreamingTrace>(const StringArena &, std::vector<StringRef> &, StreamingTrace &,
+                                                StringSortCutoffs);
+template void msdRadixSort<SortTrace>(const StringArena &, std::vector<StringRef> &, SortTrace &,
+                                     StringSortCutoffs);
+template void msdRadixSort<NullTrace>(const StringArena &, std::vector<StringRef> &, NullTrace &,
+                                     StringSortCutoffs);
+template void msdRadixSort<StreamingTrace>(const StringArena &, std::vector<StringRef> &, StreamingTrace &,
+                                           StringSortCutoffs);
@@ -0,0 +1,64 @@
+#ifndef STRINGSORT_H
+#define STRINGSORT_H
+
+#include "sorttrace.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// What the kernels actually move around. `prefix` caches eight bytes of the
+// string starting at the current sort depth, big-endian and zero padded, so
+// most comparisons are one integer compare with no pointer chasing.
+struct StringRef
+{
+    std::uint64_t prefix;
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+// All strings live back to back in one buffer, so building a data set costs
+// two vector growths instead of one heap allocation per string. Strings must
+// not contain NUL bytes; the kernels use 0 as the end-of-string marker.
+class StringArena
+{
+public:
+    void reserve(std::size_t strings, std::size_t bytes);
+    std::uint32_t add(std::string_view s);
+    void append(const StringArena &other);  // Adds all of its strings, in order
+
+    std::size_t size() const { return offsets.size(); }
+    std::string_view view(std::uint32_t id) const { return {chars.data() + offsets[id], lengths[id]}; }
+    const char *data() const { return chars.data(); }
+
+    // Maps a StringRef back to the id returned by add()
+    std::uint32_t idOf(const StringRef &ref) const;
+
+private:
+    std::vector<char> chars;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+};
+
+std::vector<StringRef> makeStringRefs(const StringArena &arena);
+
+// Below these sizes the kernels hand off to a simpler one. The GUI lowers them
+// so that eight sample strings still show the partitioning steps.
+struct StringSortCutoffs
+{
+    std::size_t insertion = 16;  // multikeyQuicksort -> insertion sort
+    std::size_t radix = 64;      // msdRadixSort -> multikeyQuicksort
+};
+
+// Three-way radix quicksort (Bentley & Sedgewick) over eight-byte key chunks
+template <typename Trace>
+void multikeyQuicksort(const StringArena &arena, std::vector<StringRef> &refs, Trace &trace,
+                       StringSortCutoffs cutoffs = {});
+void multikeyQuicksort(const StringArena &arena, std::vector<StringRef> &refs);
+
+// Most-significant-byte radix sort; small buckets finish with multikeyQuicksort
+template <typename Trace>
+void msdRadixSort(const StringArena &arena, std::vector<StringRef> &refs, Trace &trace,
+                  StringSortCutoffs cutoffs = {});
+void msdRadixSort(const StringArena &arena, std::vector<StringRef> &refs);
+
+#endif // STRINGSORT_H
@@ -0,0 +1,83 @@
+#include "topk.h"
+#include "heapsort.h"
+#include <algorithm>
+#include <utility>
+
+template <typename Trace>
+void heapSelect(int *a, std::size_t n, std::size_t k, Trace &trace, unsigned arity)
+{
+    k = std::min(k, n);
+    if (k == 0)
+    {
+        return;
+    }
+    makeHeap(a, 0, k, trace, arity);
+    for (std::size_t i = k; i < n; ++i)
+    {
+        trace.compare(i, 0);
+        if (a[i] < a[0])
+        {
+            std::swap(a[i], a[0]);
+            trace.swap(i, 0);
+            siftHeapTop(a, 0, k, trace, arity);
+        }
+    }
+}
+
+template <typename Trace>
+void heapPartialSort(int *a, std::size_t n, std::size_t k, Trace &trace, unsigned arity)
+{
+    k = std::min(k, n);
+    heapSelect(a, n, k, trace, arity);
+    sortHeap(a, 0, k, trace, arity);
+}
+
+template void heapSelect<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void heapSelect<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void heapSelect<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
+
+template void heapPartialSort<SortTrace>(int *, std::size_t, std::size_t, SortTrace &, unsigned);
+template void heapPartialSort<NullTrace>(int *, std::size_t, std::size_t, NullTrace &, unsigned);
+template void heapPartialSort<StreamingTrace>(int *, std::size_t, std::size_t, StreamingTrace &, unsigned);
+
+StreamingTopK::StreamingTopK(std::size_t k, unsigned arity) : k(k), arity(arity)
+{
+    heap.reserve(k);
+}
+
+void StreamingTopK::push(const std::int32_t *values, std::size_t n)
+{
+    NullTrace none;
+    count += n;
+    std::size_t i = 0;
+    if (heap.size() < k)
+    {
+        std::size_t take = std::min(n, k - heap.size());
+        heap.insert(heap.end(), values, values + take);
+        i = take;
+        if (heap.size() == k)
+        {
+            makeHeap(heap.data(), 0, k, none, arity);
+        }
+    }
+    if (heap.size() < k || k == 0)
+    {
+        return;
+    }
+    for (; i < n; ++i)
+    {
+        if (values[i] < heap[0])
+        {
+            heap[0] = values[i];
+            siftHeapTop(heap.data(), 0, k, none, arity);
+            ++replaced;
+        }
+    }
+}
+
+std::vector<std::int32_t> StreamingTopK::sorted() const
+{
+    std::vector<std::int32_t> result = heap;
+    std::sort(result.begin(), result.end());
+    return result;
+}
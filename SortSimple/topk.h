@@ -0,0 +1,44 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "sorttrace.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Top-k with a bounded max-heap: a[0, k) starts as the heap, and each later
+// key costs one comparison with the heap's top unless it is smaller, in
+// which case it replaces the top. Afterwards a[0, k) holds the k smallest
+// keys, as a heap; O(n + m log k) for m replacements, which is close to n
+// when k is small. Quickselect (nthElement) is faster for large k, the heap
+// for small k and for data that arrives in pieces.
+template <typename Trace>
+void heapSelect(int *a, std::size_t n, std::size_t k, Trace &trace, unsigned arity = 4);
+
+// heapSelect, then a[0, k) sorted: the k smallest keys in order
+template <typename Trace>
+void heapPartialSort(int *a, std::size_t n, std::size_t k, Trace &trace, unsigned arity = 4);
+
+// The k smallest of a sequence too large to hold, fed in pieces of any size.
+// Memory is k keys whatever the length of the input.
+class StreamingTopK
+{
+public:
+    explicit StreamingTopK(std::size_t k, unsigned arity = 4);
+
+    void push(const std::int32_t *values, std::size_t count);
+    std::uint64_t seen() const { return count; }
+    std::uint64_t replacements() const { return replaced; }  // Keys that entered the heap after it filled
+
+    // The k smallest keys so far (fewer if fewer were pushed), in order
+    std::vector<std::int32_t> sorted() const;
+
+private:
+    std::size_t k;
+    unsigned arity;
+    std::vector<std::int32_t> heap;
+    std::uint64_t count = 0;
+    std::uint64_t replaced = 0;
+};
+
+#endif // TOPK_H
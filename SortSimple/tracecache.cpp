@@ -0,0 +1,521 @@
+#include "tracecache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr std::uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr std::uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr std::uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr std::uint64_t kPrime5 = 2870177450012600261ULL;
+
+std::uint64_t rotateLeft(std::uint64_t x, int bits)
+{
+    return (x << bits) | (x >> (64 - bits));
+}
+
+std::uint64_t read64(const unsigned char *p)
+{
+    std::uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+std::uint32_t read32(const unsigned char *p)
+{
+    std::uint32_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+std::uint64_t hashRound(std::uint64_t lane, std::uint64_t input)
+{
+    return rotateLeft(lane + input * kPrime2, 31) * kPrime1;
+}
+
+std::uint64_t mergeLane(std::uint64_t hash, std::uint64_t lane)
+{
+    return (hash ^ hashRound(0, lane)) * kPrime1 + kPrime4;
+}
+
+// The start of every entry file, followed by the key's two strings, then,
+// from eventsOffset, the events; from keyframesOffset, the keyframe
+// positions and then the keyframe states
+struct EntryHeader
+{
+    char magic[8];
+    std::uint64_t inputHash;
+    std::uint64_t inputSize;
+    std::uint64_t eventCount;
+    std::uint64_t keyframeCount;
+    std::uint64_t eventsOffset;
+    std::uint64_t keyframesOffset;
+    std::uint32_t algorithmLength;
+    std::uint32_t parametersLength;
+};
+
+static_assert(sizeof(EntryHeader) == 64, "entry header layout");
+static_assert(sizeof(TraceEvent) == 16, "cached events are stored as they are in memory");
+
+constexpr char kMagic[8] = {'S', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr std::uint64_t kAlignment = sizeof(TraceEvent);  // Keeps the keyframe positions after the events aligned too
+
+std::uint64_t eventsOffsetOf(const TraceCacheKey &key)
+{
+    std::uint64_t end = sizeof(EntryHeader) + key.algorithm.size() + key.parameters.size();
+    return (end + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Events change the array, buffer 0, only by writes and swaps
+void applyEvent(const TraceEvent &e, std::int32_t *state, std::uint64_t n)
+{
+    if (e.type == TraceEvent::Write && e.buffer == 0 && static_cast<std::uint64_t>(e.i) < n)
+    {
+        state[e.i] = e.value;
+    }
+    else if (e.type == TraceEvent::Swap && static_cast<std::uint64_t>(e.i) < n && static_cast<std::uint64_t>(e.j) < n)
+    {
+        std::swap(state[e.i], state[e.j]);
+    }
+}
+
+} // namespace
+
+std::uint64_t hashBytes(const void *data, std::size_t size, std::uint64_t seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + size;
+    std::uint64_t hash;
+    if (size >= 32)
+    {
+        std::uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+        for (; end - p >= 32; p += 32)
+        {
+            for (int l = 0; l < 4; ++l)
+            {
+                lanes[l] = hashRound(lanes[l], read64(p + 8 * l));
+            }
+        }
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        for (std::uint64_t lane : lanes)
+        {
+            hash = mergeLane(hash, lane);
+        }
+    }
+    else
+    {
+        hash = seed + kPrime5;
+    }
+    hash += size;
+
+    for (; end - p >= 8; p += 8)
+    {
+        hash = rotateLeft(hash ^ hashRound(0, read64(p)), 27) * kPrime1 + kPrime4;
+    }
+    if (end - p >= 4)
+    {
+        hash = rotateLeft(hash ^ (read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        hash = rotateLeft(hash ^ (*p * kPrime5), 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+TraceCacheKey makeTraceCacheKey(const std::string &algorithm, const std::string &parameters, const int *input,
+                                std::size_t n)
+{
+    TraceCacheKey key;
+    key.algorithm = algorithm;
+    key.parameters = parameters;
+    key.inputHash = hashBytes(input, n * sizeof(int));
+    key.inputSize = n;
+    return key;
+}
+
+bool TraceCacheEntry::open(const std::string &path, const TraceCacheKey &key)
+{
+    close();
+    if (!file.open(path))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    // Anything that does not match, including a different key whose name
+    // hashed the same, is not this entry
+    EntryHeader header;
+    std::uint64_t length = file.size();
+    bool valid = length >= sizeof(header);
+    if (valid)
+    {
+        std::memcpy(&header, file.data(), sizeof(header));
+        const char *strings = file.data() + sizeof(header);
+        std::uint64_t keyframeBytes = sizeof(std::uint64_t) + header.inputSize * sizeof(std::int32_t);
+        valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.inputHash == key.inputHash &&
+                header.inputSize == key.inputSize && header.algorithmLength == key.algorithm.size() &&
+                header.parametersLength == key.parameters.size() && header.eventsOffset == eventsOffsetOf(key) &&
+                header.eventsOffset <= length &&
+                std::memcmp(strings, key.algorithm.data(), key.algorithm.size()) == 0 &&
+                std::memcmp(strings + key.algorithm.size(), key.parameters.data(), key.parameters.size()) == 0 &&
+                header.eventCount <= (length - header.eventsOffset) / sizeof(TraceEvent) &&
+                header.keyframesOffset == header.eventsOffset + header.eventCount * sizeof(TraceEvent) &&
+                header.keyframeCount >= 1 && header.keyframeCount <= (length - header.keyframesOffset) / keyframeBytes &&
+                length == header.keyframesOffset + header.keyframeCount * keyframeBytes;
+    }
+    if (!valid)
+    {
+        error = path + " is not a trace for this key";
+        close();
+        return false;
+    }
+
+    eventData = reinterpret_cast<const TraceEvent *>(file.data() + header.eventsOffset);
+    count = header.eventCount;
+    size = header.inputSize;
+    keyframes = header.keyframeCount;
+    positions = reinterpret_cast<const std::uint64_t *>(file.data() + header.keyframesOffset);
+    states = reinterpret_cast<const std::int32_t *>(positions + keyframes);
+    error.clear();
+    return true;
+}
+
+void TraceCacheEntry::close()
+{
+    file.close();
+    eventData = nullptr;
+    positions = nullptr;
+    states = nullptr;
+    count = size = keyframes = 0;
+}
+
+void TraceCacheEntry::stateAt(std::uint64_t position, std::vector<int> &state) const
+{
+    position = std::min(position, count);
+    std::size_t k = static_cast<std::size_t>(std::upper_bound(positions, positions + keyframes, position) - positions);
+    --k;  // The first keyframe is at 0
+    state.assign(keyframe(k), keyframe(k) + size);
+    for (std::uint64_t e = positions[k]; e < position; ++e)
+    {
+        applyEvent(eventData[e], state.data(), size);
+    }
+}
+
+TraceCacheWriter::TraceCacheWriter(TraceCache &cache, const TraceCacheKey &key, const int *input, TraceSink *forward,
+                                   std::uint64_t keyframeInterval)
+    : cache(cache), key(key), forward(forward), path(cache.pathOf(key)), state(input, input + key.inputSize),
+      interval(keyframeInterval ? keyframeInterval : std::max<std::uint64_t>(1, 16 * key.inputSize))
+{
+    // Unique among threads and processes writing the same key
+    static std::atomic<unsigned> serial{0};
+    temporary = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "-" +
+                std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" +
+                std::to_string(serial++);
+    out = std::fopen(eventTemporary().c_str(), "wb");
+    keyframeFile = out ? std::fopen(keyframeTemporary().c_str(), "w+b") : nullptr;
+    if (!keyframeFile)
+    {
+        drop();
+        return;
+    }
+
+    // The header is written last, once the counts are known
+    std::vector<char> front(static_cast<std::size_t>(eventsOffsetOf(key)), '\0');
+    std::memcpy(front.data() + sizeof(EntryHeader), key.algorithm.data(), key.algorithm.size());
+    std::memcpy(front.data() + sizeof(EntryHeader) + key.algorithm.size(), key.parameters.data(), key.parameters.size());
+    std::fwrite(front.data(), 1, front.size(), out);
+    bytes = front.size();
+    takeKeyframe();
+}
+
+TraceCacheWriter::~TraceCacheWriter()
+{
+    drop();
+}
+
+void TraceCacheWriter::takeKeyframe()
+{
+    positions.push_back(written);
+    std::fwrite(state.data(), sizeof(std::int32_t), state.size(), keyframeFile);
+    bytes += sizeof(std::uint64_t) + state.size() * sizeof(std::int32_t);
+}
+
+void TraceCacheWriter::drop()
+{
+    if (out)
+    {
+        std::fclose(out);
+        std::remove(eventTemporary().c_str());
+        out = nullptr;
+    }
+    if (keyframeFile)
+    {
+        std::fclose(keyframeFile);
+        std::remove(keyframeTemporary().c_str());
+        keyframeFile = nullptr;
+    }
+    dropped = true;
+}
+
+void TraceCacheWriter::consume(const TraceEvent *events, std::size_t count)
+{
+    if (forward)
+    {
+        forward->consume(events, count);
+    }
+    if (dropped)
+    {
+        return;
+    }
+
+    std::uint64_t nextKeyframe = positions.back() + interval;
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        applyEvent(events[k], state.data(), state.size());
+        if (++written == nextKeyframe)
+        {
+            takeKeyframe();
+            nextKeyframe += interval;
+        }
+    }
+    std::fwrite(events, sizeof(TraceEvent), count, out);
+    bytes += count * sizeof(TraceEvent);
+
+    // Room is kept for the last keyframe
+    if (bytes + sizeof(std::uint64_t) + state.size() * sizeof(std::int32_t) > cache.capacity)
+    {
+        drop();
+        cache.droppedAsTooLarge(path);
+    }
+}
+
+bool TraceCacheWriter::commit()
+{
+    if (dropped)
+    {
+        return false;
+    }
+    if (positions.back() != written)
+    {
+        takeKeyframe();
+    }
+
+    EntryHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.inputHash = key.inputHash;
+    header.inputSize = key.inputSize;
+    header.eventCount = written;
+    header.keyframeCount = positions.size();
+    header.eventsOffset = eventsOffsetOf(key);
+    header.keyframesOffset = header.eventsOffset + written * sizeof(TraceEvent);
+    header.algorithmLength = static_cast<std::uint32_t>(key.algorithm.size());
+    header.parametersLength = static_cast<std::uint32_t>(key.parameters.size());
+
+    std::fwrite(positions.data(), sizeof(std::uint64_t), positions.size(), out);
+    std::rewind(keyframeFile);
+    std::vector<char> buffer(1 << 20);
+    for (std::size_t got; (got = std::fread(buffer.data(), 1, buffer.size(), keyframeFile)) > 0;)
+    {
+        std::fwrite(buffer.data(), 1, got, out);
+    }
+    std::fseek(out, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, out);
+    bool ok = !std::ferror(out) && !std::ferror(keyframeFile);
+    ok = std::fclose(out) == 0 && ok;
+    out = nullptr;
+
+    // Replaces an entry another writer may have stored meanwhile
+    std::error_code failure;
+    fs::rename(eventTemporary(), path, failure);
+    if (failure)
+    {
+        fs::remove(path, failure);
+        fs::rename(eventTemporary(), path, failure);
+    }
+    if (!ok || failure)
+    {
+        std::remove(eventTemporary().c_str());
+        drop();
+        return false;
+    }
+    drop();
+    cache.stored();
+    return true;
+}
+
+bool TraceCache::open(const std::string &path, std::uint64_t newCapacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code failure;
+    fs::create_directories(path, failure);
+    if (failure)
+    {
+        error = "cannot create " + path + ": " + failure.message();
+        directory.clear();
+        return false;
+    }
+    directory = path;
+    capacity = newCapacity;
+    counts = TraceCacheStats();
+
+    // Writers that died left their temporaries behind; those an hour old
+    // are not being written any more
+    auto stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, failure))
+    {
+        std::error_code ignored;
+        if (file.path().extension() == ".tmp" && file.last_write_time(ignored) < stale)
+        {
+            fs::remove(file.path(), ignored);
+        }
+    }
+    evict();
+    error.clear();
+    return true;
+}
+
+std::string TraceCache::pathOf(const TraceCacheKey &key) const
+{
+    std::string name = key.algorithm;
+    name.push_back('\0');
+    name += key.parameters;
+    name.push_back('\0');
+    name.append(reinterpret_cast<const char *>(&key.inputHash), sizeof(key.inputHash));
+    name.append(reinterpret_cast<const char *>(&key.inputSize), sizeof(key.inputSize));
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hashBytes(name.data(), name.size())));
+    return (fs::path(directory) / (std::string(hex) + ".trace")).string();
+}
+
+bool TraceCache::lookup(const TraceCacheKey &key, TraceCacheEntry &entry)
+{
+    bool hit = isOpen() && entry.open(pathOf(key), key);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hit)
+    {
+        ++counts.misses;
+        return false;
+    }
+    ++counts.hits;
+    std::error_code ignored;
+    fs::last_write_time(pathOf(key), fs::file_time_type::clock::now(), ignored);  // Most recently used
+    return true;
+}
+
+std::unique_ptr<TraceCacheWriter> TraceCache::record(const TraceCacheKey &key, const int *input, TraceSink *forward,
+                                                     std::uint64_t keyframeInterval)
+{
+    if (!isOpen() || fitsNowhere(pathOf(key)))
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<TraceCacheWriter>(new TraceCacheWriter(*this, key, input, forward, keyframeInterval));
+}
+
+void TraceCache::stored()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ++counts.stores;
+    evict();
+}
+
+// A trace that did not fit leaves an empty marker behind, named after the
+// capacity it was too large for, so the same run is not recorded again
+// until the capacity grows
+void TraceCache::droppedAsTooLarge(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ++counts.tooLarge;
+    if (std::FILE *marker = std::fopen((path + "." + std::to_string(capacity) + ".toolarge").c_str(), "wb"))
+    {
+        std::fclose(marker);
+    }
+}
+
+bool TraceCache::fitsNowhere(const std::string &path) const
+{
+    std::string prefix = fs::path(path).filename().string() + ".";
+    std::error_code failure;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, failure))
+    {
+        std::string name = file.path().filename().string();
+        if (file.path().extension() == ".toolarge" && name.compare(0, prefix.size(), prefix) == 0 &&
+            std::strtoull(name.c_str() + prefix.size(), nullptr, 10) >= capacity)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TraceCache::evict()
+{
+    struct File
+    {
+        fs::path path;
+        fs::file_time_type used;
+        std::uint64_t size;
+    };
+    std::vector<File> files;
+    std::uint64_t total = 0;
+    std::error_code failure;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, failure))
+    {
+        std::error_code ignored;
+        if (file.path().extension() == ".trace")
+        {
+            files.push_back({file.path(), file.last_write_time(ignored), file.file_size(ignored)});
+            total += files.back().size;
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.used < b.used; });
+    for (const File &file : files)
+    {
+        if (total <= capacity)
+        {
+            break;
+        }
+        // Mapped entries stay readable on POSIX; elsewhere they cannot be
+        // removed until they are closed
+        std::error_code ignored;
+        if (fs::remove(file.path, ignored))
+        {
+            total -= file.size;
+            ++counts.evictions;
+        }
+    }
+}
+
+TraceCacheStats TraceCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TraceCacheStats result = counts;
+    std::error_code failure;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, failure))
+    {
+        std::error_code ignored;
+        if (file.path().extension() == ".trace")
+        {
+            ++result.entries;
+            result.bytes += file.file_size(ignored);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,165 @@
+#ifndef TRACECACHE_H
+#define TRACECACHE_H
+
+#include "inputloader.h"
+#include "sorttrace.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 64-bit hash of a byte range, computed like XXH64: four independent lanes
+// over 32-byte stripes, then a final avalanche. Reads native byte order, so
+// hashes are only comparable on machines of the same endianness.
+std::uint64_t hashBytes(const void *data, std::size_t size, std::uint64_t seed = 0);
+
+// What a cached trace was recorded from. Two runs with equal keys record
+// the same events, so one can be replayed in place of the other.
+struct TraceCacheKey
+{
+    std::string algorithm;
+    std::string parameters;      // Anything else the kernel's choices depend on
+    std::uint64_t inputHash = 0; // hashBytes() of the input values
+    std::uint64_t inputSize = 0; // Values
+};
+
+TraceCacheKey makeTraceCacheKey(const std::string &algorithm, const std::string &parameters, const int *input,
+                                std::size_t n);
+
+struct TraceCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t stores = 0;
+    std::uint64_t tooLarge = 0;   // Recordings dropped for not fitting under the size cap
+    std::uint64_t evictions = 0;
+    std::uint64_t entries = 0;    // On disk now
+    std::uint64_t bytes = 0;
+};
+
+// One cached trace, read straight from a read-only mapping of its file: the
+// events are an array of TraceEvent, followed by keyframes, copies of the
+// array as it stood before given events. A keyframe lets a replay start
+// anywhere without applying everything before it.
+class TraceCacheEntry
+{
+public:
+    bool open(const std::string &path, const TraceCacheKey &key);
+    void close();
+    bool isOpen() const { return file.data() != nullptr; }
+    const std::string &errorString() const { return error; }
+
+    const TraceEvent *events() const { return eventData; }
+    std::uint64_t eventCount() const { return count; }
+    std::uint64_t inputSize() const { return size; }
+
+    std::size_t keyframeCount() const { return static_cast<std::size_t>(keyframes); }
+    std::uint64_t keyframePosition(std::size_t k) const { return positions[k]; }
+    const std::int32_t *keyframe(std::size_t k) const { return states + k * size; }
+
+    // The array after the first `position` events: the nearest keyframe at
+    // or before it, then the events in between
+    void stateAt(std::uint64_t position, std::vector<int> &state) const;
+
+private:
+    MappedFile file;
+    const TraceEvent *eventData = nullptr;
+    std::uint64_t count = 0;
+    std::uint64_t size = 0;
+    std::uint64_t keyframes = 0;
+    const std::uint64_t *positions = nullptr;
+    const std::int32_t *states = nullptr;
+    std::string error;
+};
+
+class TraceCache;
+
+// Records a trace into the cache while passing every batch on to `forward`,
+// if any. Events go to a temporary file as they arrive; commit() adds the
+// keyframes and publishes the entry. A recording that outgrows the cache's
+// size cap is dropped, but still forwarded. Must not outlive its cache.
+class TraceCacheWriter : public TraceSink
+{
+public:
+    ~TraceCacheWriter() override;  // Drops the recording unless committed
+    TraceCacheWriter(const TraceCacheWriter &) = delete;
+    TraceCacheWriter &operator=(const TraceCacheWriter &) = delete;
+
+    void consume(const TraceEvent *events, std::size_t count) override;
+
+    // False if the recording was dropped or could not be written
+    bool commit();
+
+private:
+    friend class TraceCache;
+    TraceCacheWriter(TraceCache &cache, const TraceCacheKey &key, const int *input, TraceSink *forward,
+                     std::uint64_t keyframeInterval);
+
+    void takeKeyframe();
+    void drop();
+    std::string eventTemporary() const { return temporary + ".tmp"; }
+    std::string keyframeTemporary() const { return temporary + ".keyframes.tmp"; }
+
+    TraceCache &cache;
+    TraceCacheKey key;
+    TraceSink *forward;
+    std::string path;        // Final name
+    std::string temporary;   // Stem of the files written until commit()
+    std::FILE *out = nullptr;
+    std::FILE *keyframeFile = nullptr;  // Keyframe states until commit()
+    std::vector<std::int32_t> state;    // The array as the events so far have left it
+    std::vector<std::uint64_t> positions;
+    std::uint64_t interval;
+    std::uint64_t written = 0;  // Events
+    std::uint64_t bytes = 0;    // The entry's size so far
+    bool dropped = false;
+};
+
+// Traces on disk, one file per key, in a directory that outlives the
+// program. Lookups map the entry's file; entries are evicted least recently
+// used first, by file modification time, which a hit refreshes, once the
+// directory holds more than `capacity` bytes. Safe to use from several
+// threads; several processes may share a directory.
+class TraceCache
+{
+public:
+    static constexpr std::uint64_t kDefaultCapacity = std::uint64_t(1) << 30;
+
+    bool open(const std::string &directory, std::uint64_t capacity = kDefaultCapacity);
+    bool isOpen() const { return !directory.empty(); }
+    const std::string &errorString() const { return error; }
+
+    // Maps the entry for `key` into `entry`; false, counting a miss, if
+    // there is none
+    bool lookup(const TraceCacheKey &key, TraceCacheEntry &entry);
+
+    // A writer for the trace of a run over `input`, which must hold
+    // key.inputSize values, or null if an earlier recording of the same key
+    // outgrew the capacity. Keyframes are taken every `keyframeInterval`
+    // events, 0 meaning every 16 events per value; the first is the input
+    // itself and the last the sorted result.
+    std::unique_ptr<TraceCacheWriter> record(const TraceCacheKey &key, const int *input, TraceSink *forward = nullptr,
+                                             std::uint64_t keyframeInterval = 0);
+
+    TraceCacheStats stats() const;
+
+private:
+    friend class TraceCacheWriter;
+
+    std::string pathOf(const TraceCacheKey &key) const;
+    void stored();  // Counts a new entry and evicts down to the capacity
+    void droppedAsTooLarge(const std::string &path);
+    bool fitsNowhere(const std::string &path) const;
+    void evict();
+
+    mutable std::mutex mutex;
+    std::string directory;
+    std::uint64_t capacity = kDefaultCapacity;
+    TraceCacheStats counts;  // Entries and bytes are filled in by stats()
+    std::string error;
+};
+
+#endif // TRACECACHE_H
@@ -0,0 +1,342 @@
+#include "tuning.h"
+#include "cpufeatures.h"
+#include "sortkernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+TuningConfig &active()
+{
+    static TuningConfig config = [] {
+        TuningConfig loaded;
+        loadTuning(tuningPath(), loaded);  // Keeps the defaults if there is no usable file
+        return loaded;
+    }();
+    return config;
+}
+
+std::string trim(const std::string &s)
+{
+    std::size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+    {
+        return std::string();
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool parseSize(const std::string &text, std::size_t low, std::size_t high, std::size_t &value)
+{
+    char *end = nullptr;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || parsed < low || parsed > high)
+    {
+        return false;
+    }
+    value = static_cast<std::size_t>(parsed);
+    return true;
+}
+
+// One tunable: how to show its value, the values to try and the kernel
+// whose time decides
+struct Parameter
+{
+    const char *name;
+    SortKernel kernel;
+    const std::vector<int> *input;
+    std::function<std::string(const TuningConfig &)> show;
+    std::vector<std::function<void(TuningConfig &)>> candidates;
+};
+
+template <typename T, typename Set>
+std::vector<std::function<void(TuningConfig &)>> valuesOf(std::initializer_list<T> values, Set set)
+{
+    std::vector<std::function<void(TuningConfig &)>> candidates;
+    for (T value : values)
+    {
+        candidates.push_back([=](TuningConfig &config) { set(config, value); });
+    }
+    return candidates;
+}
+
+} // namespace
+
+const TuningConfig &tuning()
+{
+    return active();
+}
+
+void setTuning(const TuningConfig &config)
+{
+    active() = config;
+}
+
+std::string describeTuning(const TuningConfig &config)
+{
+    return "cutoff " + std::to_string(config.quicksortCutoff) + ", block " + std::to_string(config.quicksortBlock) +
+           ", min run " + std::to_string(config.mergeMinRun) + ", " + mergeKernelName(config.mergeKernel) +
+           " merge, " + std::to_string(config.radixDigitBits) + "-bit digits, grain " +
+           std::to_string(config.parallelGrain);
+}
+
+std::string tuningPath()
+{
+    const char *path = std::getenv("SORTSIMPLE_TUNING");
+    if (path && *path)
+    {
+        return path;
+    }
+#ifdef _WIN32
+    const char *base = std::getenv("APPDATA");
+    fs::path directory = base ? fs::path(base) : fs::path(".");
+#else
+    const char *config = std::getenv("XDG_CONFIG_HOME");
+    const char *home = std::getenv("HOME");
+    fs::path directory = config && *config ? fs::path(config) : home ? fs::path(home) / ".config" : fs::path(".");
+#endif
+    return (directory / "sortsimple" / "tuning.conf").string();
+}
+
+std::string machineSignature()
+{
+    std::string model;
+#ifdef __linux__
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; model.empty() && std::getline(cpuinfo, line);)
+    {
+        std::size_t colon = line.find(':');
+        if (line.compare(0, 10, "model name") == 0 && colon != std::string::npos)
+        {
+            model = trim(line.substr(colon + 1));
+        }
+    }
+#endif
+    if (model.empty())
+    {
+        model = "unknown processor";
+    }
+    return model + ", " + std::to_string(std::thread::hardware_concurrency()) + " threads" +
+           (cpuHasAvx2() ? ", AVX2" : "");
+}
+
+bool loadTuning(const std::string &path, TuningConfig &config, std::string *error)
+{
+    auto fail = [&](const std::string &message) {
+        if (error)
+        {
+            *error = message;
+        }
+        return false;
+    };
+    std::ifstream in(path);
+    if (!in)
+    {
+        return fail("cannot read " + path);
+    }
+
+    TuningConfig loaded;
+    bool sameMachine = false;
+    int number = 0;
+    for (std::string line; std::getline(in, line);)
+    {
+        ++number;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+        std::size_t equals = line.find('=');
+        std::string key = trim(line.substr(0, equals));
+        std::string value = equals == std::string::npos ? std::string() : trim(line.substr(equals + 1));
+        std::size_t bits = 0;
+        bool ok = true;
+        if (equals == std::string::npos)
+        {
+            ok = false;
+        }
+        else if (key == "machine")
+        {
+            sameMachine = value == machineSignature();
+        }
+        else if (key == "quicksort.cutoff")
+        {
+            ok = parseSize(value, 2, 1024, loaded.quicksortCutoff);
+        }
+        else if (key == "quicksort.block")
+        {
+            ok = parseSize(value, 1, 128, loaded.quicksortBlock);
+        }
+        else if (key == "merge.minrun")
+        {
+            ok = parseSize(value, 1, 1024, loaded.mergeMinRun);
+        }
+        else if (key == "merge.kernel")
+        {
+            ok = false;
+            for (MergeKernel kernel : {MergeKernel::Scalar, MergeKernel::Bitonic8, MergeKernel::Bitonic16})
+            {
+                if (value == mergeKernelName(kernel))
+                {
+                    loaded.mergeKernel = kernel;
+                    ok = true;
+                }
+            }
+        }
+        else if (key == "radix.digitbits")
+        {
+            ok = parseSize(value, 1, 16, bits);
+            loaded.radixDigitBits = static_cast<unsigned>(bits);
+        }
+        else if (key == "parallel.grain")
+        {
+            ok = parseSize(value, 1, std::size_t(1) << 40, loaded.parallelGrain);
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            return fail(path + ":" + std::to_string(number) + ": cannot use \"" + line + "\"");
+        }
+    }
+    if (!sameMachine)
+    {
+        return fail(path + " was tuned on another machine; run autotune again");
+    }
+    config = loaded;
+    return true;
+}
+
+bool saveTuning(const std::string &path, const TuningConfig &config, std::string *error)
+{
+    std::error_code ignored;
+    if (fs::path(path).has_parent_path())
+    {
+        fs::create_directories(fs::path(path).parent_path(), ignored);
+    }
+    std::ofstream out(path);
+    out << "# Kernel parameters measured by SortSimpleCli autotune\n"
+        << "machine = " << machineSignature() << "\n"
+        << "quicksort.cutoff = " << config.quicksortCutoff << "\n"
+        << "quicksort.block = " << config.quicksortBlock << "\n"
+        << "merge.minrun = " << config.mergeMinRun << "\n"
+        << "merge.kernel = " << mergeKernelName(config.mergeKernel) << "\n"
+        << "radix.digitbits = " << config.radixDigitBits << "\n"
+        << "parallel.grain = " << config.parallelGrain << "\n";
+    out.close();
+    if (!out)
+    {
+        if (error)
+        {
+            *error = "cannot write " + path;
+        }
+        return false;
+    }
+    return true;
+}
+
+TuningReport autotune(std::size_t n, int repeats, const std::function<void(const TuningTrial &)> &progress)
+{
+    std::mt19937 rng(20240601);
+    std::vector<int> random(n), narrow(n), work(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        random[k] = static_cast<int>(rng());
+        narrow[k] = static_cast<int>(rng() & 0xFFFF);  // Counting sort range
+    }
+    auto time = [&](SortKernel kernel, const std::vector<int> &input) {
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r)
+        {
+            std::copy(input.begin(), input.end(), work.begin());
+            auto start = std::chrono::steady_clock::now();
+            runKernel(kernel, work.data(), n);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+
+    const std::vector<Parameter> parameters = {
+        {"quicksort.cutoff", SortKernel::BlockQuicksort, &random,
+         [](const TuningConfig &c) { return std::to_string(c.quicksortCutoff); },
+         valuesOf<std::size_t>({8, 12, 16, 24, 32}, [](TuningConfig &c, std::size_t v) { c.quicksortCutoff = v; })},
+        {"quicksort.block", SortKernel::BlockQuicksort, &random,
+         [](const TuningConfig &c) { return std::to_string(c.quicksortBlock); },
+         valuesOf<std::size_t>({32, 64, 128}, [](TuningConfig &c, std::size_t v) { c.quicksortBlock = v; })},
+        {"merge.minrun", SortKernel::BottomUpMerge, &random,
+         [](const TuningConfig &c) { return std::to_string(c.mergeMinRun); },
+         valuesOf<std::size_t>({8, 16, 24, 32, 64}, [](TuningConfig &c, std::size_t v) { c.mergeMinRun = v; })},
+        {"merge.kernel", SortKernel::BottomUpMerge, &random,
+         [](const TuningConfig &c) { return std::string(mergeKernelName(c.mergeKernel)); },
+         valuesOf({MergeKernel::Scalar, MergeKernel::Bitonic8, MergeKernel::Bitonic16},
+                  [](TuningConfig &c, MergeKernel v) { c.mergeKernel = v; })},
+        {"radix.digitbits", SortKernel::LsdRadix, &random,
+         [](const TuningConfig &c) { return std::to_string(c.radixDigitBits); },
+         valuesOf<unsigned>({8, 11, 16}, [](TuningConfig &c, unsigned v) { c.radixDigitBits = v; })},
+        {"parallel.grain", SortKernel::CountingSort, &narrow,
+         [](const TuningConfig &c) { return std::to_string(c.parallelGrain); },
+         valuesOf<std::size_t>({1 << 12, 1 << 14, 1 << 16, 1 << 18},
+                               [](TuningConfig &c, std::size_t v) { c.parallelGrain = v; })},
+    };
+
+    TuningReport report;
+    TuningConfig best;
+    for (const Parameter &parameter : parameters)
+    {
+        auto record = [&](const TuningConfig &config, double ms, bool kept) {
+            report.trials.push_back({parameter.name, parameter.show(config), ms, kept});
+            if (progress)
+            {
+                progress(report.trials.back());
+            }
+        };
+        setTuning(best);
+        time(parameter.kernel, *parameter.input);  // Warms the caches and the allocator
+        double bestMs = time(parameter.kernel, *parameter.input);
+        record(best, bestMs, true);
+        std::vector<std::string> measured = {parameter.show(best)};
+        for (const auto &apply : parameter.candidates)
+        {
+            TuningConfig candidate = best;
+            apply(candidate);
+            if (std::find(measured.begin(), measured.end(), parameter.show(candidate)) != measured.end())
+            {
+                continue;
+            }
+            measured.push_back(parameter.show(candidate));
+            setTuning(candidate);
+            double ms = time(parameter.kernel, *parameter.input);
+            bool kept = ms < 0.98 * bestMs;
+            if (kept)
+            {
+                best = candidate;
+                bestMs = ms;
+            }
+            record(candidate, ms, kept);
+        }
+    }
+
+    for (SortKernel kernel : {SortKernel::BlockQuicksort, SortKernel::BottomUpMerge, SortKernel::LsdRadix,
+                              SortKernel::CountingSort})
+    {
+        const std::vector<int> &input = kernel == SortKernel::CountingSort ? narrow : random;
+        TuningSpeedup speedup;
+        speedup.kernel = kernelName(kernel);
+        setTuning(TuningConfig());
+        speedup.defaultMs = time(kernel, input);
+        setTuning(best);
+        speedup.tunedMs = time(kernel, input);
+        report.speedups.push_back(speedup);
+    }
+    report.config = best;
+    return report;
+}
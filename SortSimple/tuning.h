@@ -0,0 +1,77 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "bitonicmerge.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Parameters whose best values depend on the machine. runKernel() and the
+// parallel counting and bucket sorts take them from tuning(); kernels called
+// with explicit options use those instead.
+struct TuningConfig
+{
+    std::size_t quicksortCutoff = 16;  // QuicksortOptions::smallCutoff
+    std::size_t quicksortBlock = 64;   // QuicksortOptions::blockSize
+    std::size_t mergeMinRun = 32;      // MergeSortOptions::minRun
+    MergeKernel mergeKernel = MergeKernel::Bitonic8;
+    unsigned radixDigitBits = 8;       // 8, 11 and 16 have kernels compiled for their width
+    std::size_t parallelGrain = std::size_t(1) << 16;  // Keys per thread worth starting one for
+};
+
+// The active parameters. On first use they are read from tuningPath() if
+// that file was tuned on this machine; otherwise they are the defaults.
+const TuningConfig &tuning();
+
+// Replaces the active parameters; not while kernels run on other threads
+void setTuning(const TuningConfig &config);
+
+// The parameters on one line, for reports and for keys of results that
+// depend on them
+std::string describeTuning(const TuningConfig &config);
+
+// $SORTSIMPLE_TUNING if set, otherwise sortsimple/tuning.conf in the user's
+// configuration directory
+std::string tuningPath();
+
+// The processor model, thread count and vector support, written into a
+// config so one tuned elsewhere is not used here
+std::string machineSignature();
+
+// "key = value" lines; # starts a comment. Loading fails for a file tuned
+// on another machine, and leaves `config` unchanged on any failure.
+bool loadTuning(const std::string &path, TuningConfig &config, std::string *error = nullptr);
+bool saveTuning(const std::string &path, const TuningConfig &config, std::string *error = nullptr);
+
+struct TuningTrial
+{
+    std::string parameter;
+    std::string value;
+    double ms = 0;
+    bool kept = false;  // Best so far when it was measured
+};
+
+struct TuningSpeedup
+{
+    std::string kernel;
+    double defaultMs = 0;
+    double tunedMs = 0;
+};
+
+struct TuningReport
+{
+    TuningConfig config;
+    std::vector<TuningTrial> trials;
+    std::vector<TuningSpeedup> speedups;  // Each affected kernel, defaults against the tuned values
+};
+
+// Times every candidate value of each parameter in turn on n random keys,
+// with the other parameters at their best so far, best of `repeats` runs.
+// A candidate has to beat the current value by 2% to replace it, so noise
+// does not move a parameter away from its default. `progress` sees every
+// trial as it finishes. The active parameters are the tuned ones afterwards.
+TuningReport autotune(std::size_t n, int repeats = 3,
+                      const std::function<void(const TuningTrial &)> &progress = nullptr);
+
+#endif // TUNING_H